@@ -25,14 +25,36 @@ void Unit::connect(const UnitId& destinationId)
 }
 void Unit::postMessage(const Message& msg)
 {
-    mMessages.push_back(msg);
+    mMessages.push_back(msg.data);
 }
 std::vector<Message> Unit::activate(Context& ctx)
 {
-    auto result = process(ctx, mMessages);
+    Inbox inbox;
+    for(const auto& m : mMessages)
+    {
+        inbox.push_back(&m);
+    }
+
+    MessageArena arena;
+    std::vector<std::uint32_t> emitted;
+    Outbox out(arena, emitted);
+    process(ctx, inbox, out);
     mMessages.clear();
+
+    std::vector<Message> result;
+    for(auto slot : emitted)
+    {
+        for(auto d : mOutputs)
+        {
+            result.push_back({arena.get(slot), d});
+        }
+    }
     return result;
 }
+const std::vector<UnitId>& Unit::getOutputs() const
+{
+    return mOutputs;
+}
 std::size_t Unit::getNumConnections() const
 {
     return mOutputs.size();
@@ -41,11 +63,70 @@ void Unit::removeConnection(const std::size_t index)
 {
     mOutputs.erase(mOutputs.begin() + index);
 }
+std::uint32_t MessageArena::acquire()
+{
+    if(mFree.empty())
+    {
+        mPayloads.emplace_back();
+        mRefs.push_back(1);
+        return static_cast<std::uint32_t>(mPayloads.size() - 1);
+    }
+
+    auto slot = mFree.back();
+    mFree.pop_back();
+    mPayloads[slot].clear();
+    mRefs[slot] = 1;
+    return slot;
+}
+Data& MessageArena::get(const std::uint32_t slot)
+{
+    return mPayloads[slot];
+}
+void MessageArena::addRef(const std::uint32_t slot, const std::uint32_t count)
+{
+    mRefs[slot] += count;
+}
+void MessageArena::release(const std::uint32_t slot)
+{
+    if(--mRefs[slot] == 0)
+    {
+        mFree.push_back(slot);
+    }
+}
+void MessageArena::reset()
+{
+    mFree.clear();
+    for(std::uint32_t i = 0; i < mPayloads.size(); ++i)
+    {
+        mRefs[i] = 0;
+        mFree.push_back(i);
+    }
+}
+Outbox::Outbox(MessageArena& arena, std::vector<std::uint32_t>& emitted)
+    : mArena(arena)
+    , mEmitted(emitted)
+{
+}
+Data& Outbox::emit()
+{
+    mEmitted.push_back(mArena.acquire());
+    return mArena.get(mEmitted.back());
+}
+void Outbox::emit(const Data& data)
+{
+    emit() = data;
+}
 Context::Context(const dng::Image& surface, TaskContext& taskCtx)
     : mSurface(surface)
     , mTaskCtx(taskCtx)
 {
 }
+Context::Context(const dng::Image& surface, const PackedSurface& packedSurface, TaskContext& taskCtx)
+    : mSurface(surface)
+    , mPackedSurface(&packedSurface)
+    , mTaskCtx(taskCtx)
+{
+}
 bool Context::isDone() const
 {
     return mTaskCtx.isDone();
@@ -82,7 +163,7 @@ void Context::onClick(const dng::Point& pt)
 }
 void Context::setProjection(const std::uint64_t key, const dng::Point& pt, const dng::Image& value)
 {
-    mProjections[key] = {pt, value};
+    mProjections[key] = {pt, &value};
 }
 dng::Image Context::read(const dng::Point& pos, const dng::Size& sz)
 {
@@ -106,17 +187,61 @@ dng::Image Context::read(const dng::Point& pos, const dng::Size& sz)
             continue;
         }
 
-        dng::Size projSize{static_cast<std::uint16_t>(x.second.second.width()), static_cast<std::uint16_t>(x.second.second.height())};
+        dng::Size projSize{static_cast<std::uint16_t>(x.second.second->width()), static_cast<std::uint16_t>(x.second.second->height())};
         if(projRelativeX + projSize.x > sz.x || projRelativeY + projSize.y > sz.y)
         {
             continue;
         }
 
-        boost::gil::copy_pixels(boost::gil::view(x.second.second), boost::gil::subimage_view(boost::gil::view(result), projRelativeX, projRelativeY, projSize.x, projSize.y));
+        boost::gil::copy_pixels(boost::gil::const_view(*x.second.second), boost::gil::subimage_view(boost::gil::view(result), projRelativeX, projRelativeY, projSize.x, projSize.y));
     }
 
     return result;
 }
+void Context::readBits(const dng::Point& pos, const dng::Size& sz, Data& out)
+{
+    if(!mPackedSurface)
+    {
+        mPackedSurface = &mOwnPackedSurface.emplace(mSurface);
+    }
+
+    const auto begin = out.size();
+    mPackedSurface->read(pos, sz, out);
+
+    //Projections are small, they are written over the gathered rows bit by bit
+    for(auto& x : mProjections)
+    {
+        auto& projPos = x.second.first;
+        auto projRelativeX = projPos.x - static_cast<int>(pos.x);
+        auto projRelativeY = projPos.y - static_cast<int>(pos.y);
+
+        if(projRelativeX < 0 || projRelativeY < 0)
+        {
+            continue;
+        }
+
+        auto view = boost::gil::const_view(*x.second.second);
+        if(projRelativeX + view.width() > sz.x || projRelativeY + view.height() > sz.y)
+        {
+            continue;
+        }
+
+        for(int y = 0; y < view.height(); ++y)
+        {
+            auto bit = begin + ((projRelativeY + y) * sz.x + projRelativeX) * PackedSurface::BitsPerPixel;
+            for(auto p = view.row_begin(y); p != view.row_end(y); ++p)
+            {
+                for(std::uint8_t channel : {boost::gil::at_c<0>(*p), boost::gil::at_c<1>(*p), boost::gil::at_c<2>(*p)})
+                {
+                    for(int i = 7; i >= 0; --i)
+                    {
+                        out[bit++] = (channel >> i) & 1;
+                    }
+                }
+            }
+        }
+    }
+}
 
 template<class T>
 void mutateIncDec(T& val)
@@ -152,6 +277,11 @@ void CursorManipulator::mutate()
 {
 }
 
+bool CursorManipulator::isStateful() const
+{
+    return true;
+}
+
 void CursorManipulator::printDetails(std::stringstream& str) const
 {
     str << "CursorManipulator - Pos: " << mPos;
@@ -165,13 +295,13 @@ dng::Point calcPos(const dng::Point& pt, const int xOffset, const int yOffset, c
     return {static_cast<uint16_t>(xPos), static_cast<uint16_t>(yPos)};
 }
 
-std::vector<Message> CursorManipulator::process(Context& ctx, const std::vector<Message>& messages)
+void CursorManipulator::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
     int xOffset = 0;
     int yOffset = 0;
     for(const auto& m : messages)
     {
-        DataReader<std::uint8_t, 3> reader(m.data);
+        DataReader<std::uint8_t, 3> reader(*m);
         for(auto val : reader)
         {
             switch(val)
@@ -200,8 +330,6 @@ std::vector<Message> CursorManipulator::process(Context& ctx, const std::vector<
 
     mPos = calcPos(mPos, xOffset, yOffset, ctx);
     ctx.setProjection(mId, mPos, sProjection);
-
-    return {};
 }
 
 dng::Image createCursorProjection()
@@ -264,13 +392,18 @@ void ScreenReader::mutate()
     }
 }
 
-std::vector<Message> ScreenReader::process(Context& ctx, const std::vector<Message>& messages)
+bool ScreenReader::isStateful() const
+{
+    return true;
+}
+
+void ScreenReader::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
     int xOffset = 0;
     int yOffset = 0;
     for(const auto& m : messages)
     {
-        DataReader<std::uint8_t, 2> reader(m.data);
+        DataReader<std::uint8_t, 2> reader(*m);
         for(auto val : reader)
         {
             switch(val)
@@ -299,32 +432,10 @@ std::vector<Message> ScreenReader::process(Context& ctx, const std::vector<Messa
 
     if(mOutputs.empty())
     {
-        return {};
+        return;
     }
 
-    using namespace boost::gil;
-    auto img = ctx.read(mBottomLeftPos, mSize);
-
-    struct PixelInserter{
-        DataWritter<unsigned char>* writter;
-        PixelInserter(DataWritter<unsigned char>* s) : writter(s) {}
-        void operator()(boost::gil::rgb8_pixel_t p) const {
-                (*writter)(boost::gil::at_c<0>(p));
-                (*writter)(boost::gil::at_c<1>(p));
-                (*writter)(boost::gil::at_c<2>(p));
-        }
-    };
-
-    Data out;
-    DataWritter<unsigned char> writter(out);
-    for_each_pixel(const_view(img), PixelInserter(&writter));
-
-    std::vector<Message> result;
-    for(auto d : mOutputs)
-    {
-        result.push_back({out, d});
-    }
-    return result;
+    ctx.readBits(mBottomLeftPos, mSize, out.emit());
 }
 
 std::shared_ptr<Unit> ScreenReader::createRandom(const UnitId id)
@@ -362,14 +473,9 @@ void ConstantGenerator::mutate()
     }
 }
 
-std::vector<Message> ConstantGenerator::process(Context& ctx, const std::vector<Message>& messages)
+void ConstantGenerator::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
-    std::vector<Message> result;
-    for(auto d : mOutputs)
-    {
-        result.push_back({mConstant, d});
-    }
-    return result;
+    out.emit(mConstant);
 }
 
 std::shared_ptr<Unit> ConstantGenerator::createRandom(const UnitId id)
@@ -403,22 +509,16 @@ void RandomGenerator::printDetails(std::stringstream& str) const
     str << "RandomGenerator - Length: " << mLen << ", Chance: " << mChance;
 }
 
-std::vector<Message> RandomGenerator::process(Context& ctx, const std::vector<Message>& messages)
+void RandomGenerator::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
-    std::vector<Message> result;
     if(Rng::genProbability(mChance))
     {
-        Data data;
+        auto& data = out.emit();
         for(int i = 0; i < mLen; ++i)
         {
             data.push_back(Rng::genProbability(0.5) ? 1 : 0);
         }
-        for(auto d : mOutputs)
-        {
-            result.push_back({data, d});
-        }
     }
-    return result;
 }
 
 std::shared_ptr<Unit> RandomGenerator::createRandom(const UnitId id)
@@ -463,19 +563,19 @@ void PhasicGenerator::mutate()
     }
 }
 
-std::vector<Message> PhasicGenerator::process(Context& ctx, const std::vector<Message>& messages)
+bool PhasicGenerator::isStateful() const
+{
+    return true;
+}
+
+void PhasicGenerator::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
-    std::vector<Message> result;
     mStep++;
     if(mStep >= mPhase)
     {
         mStep = 0;
-        for(auto d : mOutputs)
-        {
-            result.push_back({mConstant, d});
-        }
+        out.emit(mConstant);
     }
-    return result;
 }
 
 std::shared_ptr<Unit> PhasicGenerator::createRandom(const UnitId id)
@@ -503,6 +603,11 @@ void Storage::mutate()
 {
 }
 
+bool Storage::isStateful() const
+{
+    return true;
+}
+
 void Storage::printDetails(std::stringstream& str) const
 {
     if(mSlot.size() > 0)
@@ -515,23 +620,19 @@ void Storage::printDetails(std::stringstream& str) const
     }
 }
 
-std::vector<Message> Storage::process(Context& ctx, const std::vector<Message>& messages)
+void Storage::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
-    std::vector<Message> result;
-    for(const auto& m : messages)
+    for(const auto m : messages)
     {
         //If 1 is recieved - releases, if 0 is recieved - clears
         //Otherwise stores
-        if(m.data.size() == 1)
+        if(m->size() == 1)
         {
-            if((m.data)[0])
+            if((*m)[0])
             {
                 if(mSlot.size() > 0)
                 {
-                    for(auto d : mOutputs)
-                    {
-                        result.push_back({mSlot, d});
-                    }
+                    out.emit(mSlot);
                 }
             }
             else
@@ -541,11 +642,9 @@ std::vector<Message> Storage::process(Context& ctx, const std::vector<Message>&
         }
         else
         {
-            mSlot = m.data;
+            mSlot = *m;
         }
     }
-
-    return result;
 }
 
 std::shared_ptr<Unit> Storage::createRandom(const UnitId id)
@@ -583,37 +682,27 @@ void Extractor::mutate()
     }
 }
 
-std::vector<Message> Extractor::process(Context& ctx, const std::vector<Message>& messages)
+void Extractor::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
-    std::vector<Message> result;
     const auto len = mBegin - mEnd;
-    for(const auto& m : messages)
+    for(const auto m : messages)
     {
-        if(m.data.size() < mBegin || len == 0)
+        if(m->size() < mBegin || len == 0)
         {
-            for(auto d : mOutputs)
-            {
-                result.push_back({m.data, d});
-            }
+            out.emit(*m);
             continue;
         }
 
-        auto minEnd = std::min(mEnd, m.data.size());
+        auto minEnd = std::min(mEnd, m->size());
         auto cutLen = minEnd - mBegin;
-        Data cut(cutLen);
+        auto& cut = out.emit();
+        cut.resize(cutLen);
 
         for(std::size_t i = 0; i < cutLen; ++i)
         {
-            (cut)[i] = (m.data)[mBegin + i];
-        }
-
-        for(auto d : mOutputs)
-        {
-            result.push_back({cut, d});
+            (cut)[i] = (*m)[mBegin + i];
         }
     }
-
-    return result;
 }
 
 std::shared_ptr<Unit> Extractor::createRandom(const UnitId id)
@@ -643,27 +732,14 @@ void Combiner::printDetails(std::stringstream& str) const
 {
     str << "Combiner";
 }
-std::vector<Message> Combiner::process(Context& ctx, const std::vector<Message>& messages)
+void Combiner::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
-    std::vector<Message> result;
-    Data combined;
+    auto& combined = out.emit();
 
     for(std::size_t i = 0; i < messages.size(); i ++)
     {
-        auto& a = messages[i];
-
-        for(std::size_t j = 0; j < a.data.size(); ++j)
-        {
-            combined.push_back((a.data)[j]);
-        }
-    }
-
-    for(auto d : mOutputs)
-    {
-        result.push_back({combined, d});
+        appendBits(combined, *messages[i]);
     }
-
-    return result;
 }
 
 std::shared_ptr<Unit> Combiner::createRandom(const UnitId id)
@@ -702,31 +778,18 @@ void Filter::mutate()
     }
 }
 
-std::vector<Message> Filter::process(Context& ctx, const std::vector<Message>& messages)
+void Filter::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
-    std::vector<Message> result;
-    for(const auto& m : messages)
+    for(const auto m : messages)
     {
-        auto filtered = m.data;
-
-        std::size_t j = 0;
-        for(std::size_t i = 0; i < filtered.size(); ++i)
-        {
-            (filtered)[i] &= mBitmask[j];
-            j++;
-            if(j == mBitmask.size())
-            {
-                j = 0;
-            }
-        }
+        //Mask repeats over the message
+        thread_local Data mask;
+        tileBits(mBitmask, m->size(), mask);
 
-        for(auto d : mOutputs)
-        {
-            result.push_back({filtered, d});
-        }
+        auto& filtered = out.emit();
+        filtered = *m;
+        filtered &= mask;
     }
-
-    return result;
 }
 
 std::shared_ptr<Unit> Filter::createRandom(const UnitId id)
@@ -765,52 +828,34 @@ std::shared_ptr<Unit> Matcher::createRandom(const UnitId id)
     return result;
 }
 
-std::vector<Message> Matcher::process(Context& ctx, const std::vector<Message>& messages)
+void Matcher::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
     static Data signalTrue(1);
     (signalTrue)[0] = true;
     static Data signalFalse(1);
     (signalFalse)[0] = false;
 
-    std::vector<Message> result;
     if(messages.empty())
     {
-        return {};
+        return;
     }
     for(std::size_t i = 0; i < messages.size() - 1; i += 2)
     {
-        auto& a = messages[i];
-        auto& b = messages[i + 1];
-
-        auto minSize = std::min(a.data.size(), b.data.size());
-        auto maxSize = std::max(a.data.size(), b.data.size());
+        auto& a = *messages[i];
+        auto& b = *messages[i + 1];
 
-        std::size_t matches = 0;
-        for(std::size_t i = 0; i < minSize; ++i)
-        {
-            if((a.data)[i] == (b.data)[i])
-            {
-                matches++;
-            }
-        }
+        auto maxSize = std::max(a.size(), b.size());
+        auto matches = countMatchingBits(a, b);
 
         if(static_cast<double>(matches) / maxSize > mThreshold)
         {
-            for(auto d : mOutputs)
-            {
-                result.push_back({signalTrue, d});
-            }
+            out.emit(signalTrue);
         }
         else
         {
-            for(auto d : mOutputs)
-            {
-                result.push_back({signalFalse, d});
-            }
+            out.emit(signalFalse);
         }
     }
-
-    return result;
 }
 //---------------------------------------------------------------------------------------
 LogicalOp::LogicalOp(const UnitId id, const Type t)
@@ -840,85 +885,63 @@ std::shared_ptr<Unit> LogicalOp::createRandom(const UnitId id)
     return result;
 }
 
-bool logOp(const bool a, const bool b, LogicalOp::Type type)
+void logOp(Data& a, const Data& b, LogicalOp::Type type)
 {
     if(type == LogicalOp::Type::And)
     {
-        return a && b;
+        a &= b;
     }
-    if(type == LogicalOp::Type::Or)
+    else if(type == LogicalOp::Type::Or)
     {
-        return a || b;
+        a |= b;
     }
-    if(type == LogicalOp::Type::Xor)
+    else if(type == LogicalOp::Type::Xor)
     {
-        return a != b;
+        a ^= b;
+    }
+    else
+    {
+        a.reset();
     }
-
-    return false;
 }
 
-std::vector<Message> LogicalOp::process(Context& ctx, const std::vector<Message>& messages)
+void LogicalOp::process(Context& ctx, const Inbox& messages, Outbox& out)
 {
-    std::vector<Message> result;
     if(mType != Type::Not)
     {
         if(messages.empty())
         {
-            return {};
+            return;
         }
         for(std::size_t i = 0; i < messages.size() - 1; i += 2)
         {
-            auto& a = messages[i];
-            auto& b = messages[i + 1];
+            auto& a = *messages[i];
+            auto& b = *messages[i + 1];
 
-            auto maxSize = std::max(a.data.size(), b.data.size());
-            auto minSize = std::min(a.data.size(), b.data.size());
+            auto maxSize = std::max(a.size(), b.size());
+            auto minSize = std::min(a.size(), b.size());
             if(minSize == 0)
             {
                 continue;
             }
-            Data combined(maxSize);
-
-            std::size_t posa = 0;
-            std::size_t posb = 0;
-            for(std::size_t i = 0; i < maxSize; ++i)
-            {
-                (combined)[i] = logOp((a.data)[posa], (b.data)[posb], mType);
-
-                posa++;
-                if(posa == a.data.size())
-                {
-                    posa = 0;
-                }
+            //The shorter operand repeats up to the length of the longer one
+            thread_local Data other;
+            tileBits(b, maxSize, other);
 
-                posb++;
-                if(posb == b.data.size())
-                {
-                    posb = 0;
-                }
-            }
-
-            for(auto d : mOutputs)
-            {
-                result.push_back({combined, d});
-            }
+            auto& combined = out.emit();
+            tileBits(a, maxSize, combined);
+            logOp(combined, other, mType);
         }
     }
     else
     {
-        for(const auto& m : messages)
+        for(const auto m : messages)
         {
-            auto cloned = (m.data);
+            auto& cloned = out.emit();
+            cloned = *m;
 
             cloned.flip();
-
-            for(auto d : mOutputs)
-            {
-                result.push_back({cloned, d});
-            }
         }
     }
-    return result;
 }
 }
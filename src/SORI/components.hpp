@@ -1,10 +1,13 @@
 #pragma once
 #include <vector>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <boost/mpl/vector.hpp>
 #include "data.hpp"
+#include "surface.hpp"
 #include "task.hpp"
+#include <optional>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/base_object.hpp>
 #include <boost/serialization/assume_abstract.hpp>
@@ -18,27 +21,70 @@ namespace sori
 
 using UnitId = std::size_t;
 
+class PopFormat;
+
 struct Message
 {
     Data data;
     UnitId destination;
 };
 
+using Inbox = std::vector<const Data*>;
+
+//Payload slots reused across activations. A slot returns to the free list
+//when the last reference is released, its bit storage is kept for the next payload.
+class MessageArena
+{
+public:
+   std::uint32_t acquire();
+   Data& get(const std::uint32_t slot);
+   void addRef(const std::uint32_t slot, const std::uint32_t count);
+   void release(const std::uint32_t slot);
+   void reset();
+
+private:
+   std::deque<Data> mPayloads;
+   std::vector<std::uint32_t> mRefs;
+   std::vector<std::uint32_t> mFree;
+};
+
+//Payloads produced by one activation, each one is shared by all outputs of the unit
+class Outbox
+{
+public:
+   Outbox(MessageArena& arena, std::vector<std::uint32_t>& emitted);
+
+   Data& emit();
+   void emit(const Data& data);
+
+private:
+   MessageArena& mArena;
+   std::vector<std::uint32_t>& mEmitted;
+};
+
 class Context
 {
 public:
    Context(const dng::Image& surface, TaskContext& taskCtx);
+   //Reads from an already packed surface, it has to outlive the context
+   Context(const dng::Image& surface, const PackedSurface& packedSurface, TaskContext& taskCtx);
    bool isDone() const;
    int getScore() const;
    dng::Size getSize() const;
 
    void onClick(const dng::Point& pt);
+   //The projection is not copied, it has to outlive the context
    void setProjection(const std::uint64_t key, const dng::Point& pos, const dng::Image& value);
    dng::Image read(const dng::Point& pos, const dng::Size& sz);
+   //Same as read, but appends the pixels to out in the ScreenReader message layout
+   void readBits(const dng::Point& pos, const dng::Size& sz, Data& out);
 
 private:
    const dng::Image& mSurface;
-   std::map<std::uint64_t, std::pair<dng::Point, dng::Image>> mProjections;
+   //Packed on the first readBits, so drawing before the first read is still visible
+   std::optional<PackedSurface> mOwnPackedSurface;
+   const PackedSurface* mPackedSurface = nullptr;
+   std::map<std::uint64_t, std::pair<dng::Point, const dng::Image*>> mProjections;
    TaskContext& mTaskCtx;
 };
 
@@ -46,6 +92,8 @@ class Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
+   friend class Pop;
    Unit(const UnitId id_);
    virtual ~Unit(){}
 
@@ -55,11 +103,16 @@ public:
    void connect(const UnitId& destinationId);
    void removeConnection(const std::size_t index);
    void removeConnections(const UnitId outCmpId);
+   const std::vector<UnitId>& getOutputs() const;
+
+   //Standalone activation with one message per output, Pop::run routes payloads itself
    void postMessage(const Message& msg);
    std::vector<Message> activate(Context& ctx);
 
    virtual std::shared_ptr<Unit> clone(const UnitId newId) const = 0;
    virtual void mutate() = 0;
+   //Units that change their own fields while processing, they are copied before a shared instance runs
+   virtual bool isStateful() const {return false;}
 
    template<class Archive>
    void serialize(Archive & ar, const unsigned int version)
@@ -72,11 +125,11 @@ public:
 
 protected:
    Unit(){}
-   virtual std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) = 0;
+   virtual void process(Context& ctx, const Inbox& messages, Outbox& out) = 0;
    virtual void printDetails(std::stringstream& s) const = 0;
 
    std::vector<UnitId> mOutputs;
-   std::vector<Message> mMessages;
+   std::vector<Data> mMessages;
    UnitId mId = 0;
 };
 
@@ -87,9 +140,11 @@ class CursorManipulator : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    CursorManipulator(const UnitId id);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
+   bool isStateful() const override;
 
    static std::shared_ptr<Unit> createRandom(const UnitId id);
 
@@ -103,7 +158,7 @@ public:
 
 private:
    CursorManipulator(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    static dng::Image sProjection;
    dng::Point mPos;
@@ -114,9 +169,11 @@ class ScreenReader : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    ScreenReader(const UnitId id, const dng::Size& sz);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
+   bool isStateful() const override;
 
    static std::shared_ptr<Unit> createRandom(const UnitId id);
 
@@ -132,7 +189,7 @@ public:
 
 private:
    ScreenReader(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    dng::Point mBottomLeftPos;
    dng::Size mSize;
@@ -143,6 +200,7 @@ class ConstantGenerator : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    ConstantGenerator(const UnitId id);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
@@ -158,7 +216,7 @@ public:
 
 private:
    ConstantGenerator(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    Data mConstant;
 };
@@ -168,6 +226,7 @@ class RandomGenerator : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    RandomGenerator(const UnitId id);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
@@ -184,7 +243,7 @@ public:
 
 private:
    RandomGenerator(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    double mChance = 0.0;
    std::size_t mLen = 0;
@@ -195,9 +254,11 @@ class PhasicGenerator : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    PhasicGenerator(const UnitId id);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
+   bool isStateful() const override;
 
    static std::shared_ptr<Unit> createRandom(const UnitId id);
 
@@ -212,7 +273,7 @@ public:
 
 private:
    PhasicGenerator(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    std::uint8_t mStep = 0;
    std::uint8_t mPhase = 0;
@@ -224,9 +285,11 @@ class Storage : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    Storage(const UnitId id);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
+   bool isStateful() const override;
 
    static std::shared_ptr<Unit> createRandom(const UnitId id);
 
@@ -239,7 +302,7 @@ public:
 
 private:
    Storage(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    Data mSlot;
 };
@@ -249,6 +312,7 @@ class Extractor : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    Extractor(const UnitId id, const std::size_t begin, const std::size_t end);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
@@ -265,7 +329,7 @@ public:
 
 private:
    Extractor(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    std::size_t mBegin = 0;
    std::size_t mEnd = 0;
@@ -276,6 +340,7 @@ class Combiner : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    Combiner(const UnitId id);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
@@ -289,7 +354,7 @@ public:
    }
 private:
    Combiner(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
 };
 
@@ -298,6 +363,7 @@ class Filter : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    Filter(const UnitId id, const Data& bitmask);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
@@ -313,7 +379,7 @@ public:
 
 private:
    Filter(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    Data mBitmask;
 };
@@ -323,6 +389,7 @@ class Matcher : public Unit
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
    Matcher(const UnitId id, const double threshold);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
@@ -338,7 +405,7 @@ public:
 
 private:
    Matcher() { }
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    double mThreshold = 0.0;
 };
@@ -356,6 +423,7 @@ public:
    };
 
    friend class boost::serialization::access;
+   friend class PopFormat;
    LogicalOp(const UnitId id, const Type t);
    std::shared_ptr<Unit> clone(const UnitId newId) const override;
    void mutate() override;
@@ -370,7 +438,7 @@ public:
    }
 private:
    LogicalOp(){}
-   std::vector<Message> process(Context& ctx, const std::vector<Message>& messages) override;
+   void process(Context& ctx, const Inbox& messages, Outbox& out) override;
    void printDetails(std::stringstream& str) const override;
    Type mType = Type::And;
 };
@@ -1,4 +1,6 @@
 #include "data.hpp"
+#include <vector>
+#include <iterator>
 
 namespace sori
 {
@@ -8,4 +10,71 @@ std::shared_ptr<Data> cloneData(const std::shared_ptr<Data>& other)
     return std::make_shared<Data>(*other);
 }
 
+void appendBits(Data& dst, const Data& src)
+{
+    thread_local std::vector<Data::block_type> blocks;
+    blocks.clear();
+    boost::to_block_range(src, std::back_inserter(blocks));
+
+    //Unused bits of the last block are always zero, they are cut off again by resize
+    const auto size = dst.size() + src.size();
+    dst.append(blocks.begin(), blocks.end());
+    dst.resize(size);
+}
+
+void appendBitRange(Data& dst, const Data::block_type* blocks, const std::size_t first, const std::size_t count)
+{
+    constexpr std::size_t BitsPerBlock = Data::bits_per_block;
+
+    thread_local std::vector<Data::block_type> gathered;
+    gathered.clear();
+
+    const std::size_t end = first + count;
+    const std::size_t shift = first % BitsPerBlock;
+    for(std::size_t b = first / BitsPerBlock; b * BitsPerBlock < end; ++b)
+    {
+        auto block = blocks[b] >> shift;
+        if(shift != 0 && (b + 1) * BitsPerBlock < end)
+        {
+            block |= blocks[b + 1] << (BitsPerBlock - shift);
+        }
+        gathered.push_back(block);
+    }
+
+    const auto size = dst.size() + count;
+    dst.append(gathered.begin(), gathered.end());
+    dst.resize(size);
+}
+
+void tileBits(const Data& pattern, const std::size_t size, Data& out)
+{
+    out = pattern;
+    if(pattern.empty())
+    {
+        out.resize(size);
+        return;
+    }
+
+    while(out.size() < size)
+    {
+        appendBits(out, out);
+    }
+    out.resize(size);
+}
+
+std::size_t countMatchingBits(const Data& a, const Data& b)
+{
+    thread_local Data x;
+    thread_local Data y;
+
+    const auto minSize = std::min(a.size(), b.size());
+    x = a;
+    x.resize(minSize);
+    y = b;
+    y.resize(minSize);
+
+    x ^= y;
+    return minSize - x.count();
+}
+
 }
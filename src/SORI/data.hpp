@@ -9,6 +9,15 @@ using Data = boost::dynamic_bitset<>;
 
 std::shared_ptr<Data> cloneData(const std::shared_ptr<Data>& other);
 
+//Word level helpers, they work on whole blocks of the bitset instead of single bits
+void appendBits(Data& dst, const Data& src);
+//Appends count bits starting at bit first of a block array laid out as in Data
+void appendBitRange(Data& dst, const Data::block_type* blocks, const std::size_t first, const std::size_t count);
+//Repeats pattern until out has exactly size bits
+void tileBits(const Data& pattern, const std::size_t size, Data& out);
+//Number of equal bits over the length of the shorter one
+std::size_t countMatchingBits(const Data& a, const Data& b);
+
 template<class Out, int BitLen = sizeof(Out) * 8>
 class DataReader
 {
@@ -16,6 +25,12 @@ public:
     class Iterator
     {
     public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Out;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Out*;
+        using reference = Out;
+
         Out operator* () const
         {
             Out result;
@@ -3,12 +3,96 @@
 namespace sori
 {
 
+namespace
+{
+
+//Rolls the transaction back unless it was committed, so a failed checkpoint does not leave it open
+class Transaction
+{
+public:
+    Transaction(sqlite::database& db)
+        : mDb(db)
+    {
+        mDb << "BEGIN";
+    }
+
+    ~Transaction()
+    {
+        if(!mCommitted)
+        {
+            try
+            {
+                mDb << "ROLLBACK";
+            }
+            catch(...)
+            {
+            }
+        }
+    }
+
+    void commit()
+    {
+        mDb << "COMMIT";
+        mCommitted = true;
+    }
+
+private:
+    sqlite::database& mDb;
+    bool mCommitted = false;
+};
+
+}
+
 Database::Database(const std::string& filename)
     : mDb(filename)
 {
+    //Checkpoints commit often, with WAL a commit does not wait for a sync and does not block readers
+    mDb << "PRAGMA journal_mode=WAL" >> [](std::string mode) {};
+    mDb << "PRAGMA synchronous=NORMAL";
+
+    Transaction transaction(mDb);
     mDb << "CREATE TABLE IF NOT EXISTS params(name text primary key, value text)";
-    mDb << "CREATE TABLE IF NOT EXISTS pops(id integer, pop blob)";
     mDb << "CREATE TABLE IF NOT EXISTS task_scores(name text, score integer)";
+
+    //The units of a pop do not change once it is created, so its graph is written once.
+    //Its state holds what runs change and is written by every checkpoint
+    mDb << "CREATE TABLE IF NOT EXISTS pop_graphs(id integer primary key, graph blob)";
+    mDb << "CREATE TABLE IF NOT EXISTS pop_states(id integer primary key, pos integer, state blob)";
+
+    //Older databases keep whole pops by position only, which becomes their id
+    int numLegacyTables = 0;
+    mDb << "SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'pops'" >> numLegacyTables;
+    if(numLegacyTables != 0)
+    {
+        auto insGraph = mDb << "INSERT OR IGNORE INTO pop_graphs VALUES(?, ?)";
+        auto insState = mDb << "INSERT OR IGNORE INTO pop_states VALUES(?, ?, ?)";
+        mDb << "SELECT id, pop FROM pops" >> [&](sqlite3_int64 id, std::vector<std::uint8_t> blob) {
+            auto pop = popFromBinary(blob);
+            std::vector<std::uint8_t> state;
+            PopFormat::writeState(pop, state);
+
+            insGraph << id << popToBinary(pop);
+            insGraph++;
+            insState << id << id << state;
+            insState++;
+        };
+        mDb << "DROP TABLE pops";
+    }
+    transaction.commit();
+
+    mDb << "SELECT id FROM pop_states" >> [this](sqlite3_int64 id) {
+        mSavedPops.insert(static_cast<PopId>(id));
+    };
+}
+
+sqlite::database_binder& Database::prepare(std::optional<sqlite::database_binder>& statement, const std::string& sql)
+{
+    if(!statement)
+    {
+        statement.emplace(mDb << sql);
+    }
+
+    return *statement;
 }
 
 std::string Database::loadParameterStr(const std::string& name)
@@ -21,16 +105,44 @@ std::string Database::loadParameterStr(const std::string& name)
 
 void Database::saveParameterStr(const std::string& name, const std::string& value)
 {
-    mDb << "INSERT OR REPLACE INTO params VALUES(?, ?)" << name << value;
+    auto& ps = prepare(mSaveParameter, "INSERT OR REPLACE INTO params VALUES(?, ?)");
+    ps << name << value;
+    ps++;
 }
 
-std::list<Pop> Database::loadPops()
+std::vector<Pop> Database::loadPops()
 {
-    std::list<Pop> result;
-    mDb << "SELECT pop FROM pops ORDER BY id" >> [&result](std::vector<std::uint8_t> p) {
-        result.push_back(popFromBinary(p));
+    //Plain sqlite statement, the blobs are decoded where sqlite keeps them instead of being copied out first
+    auto connection = mDb.connection();
+    sqlite3_stmt* raw = nullptr;
+    const char* sql = "SELECT s.id, g.graph, s.state FROM pop_states s JOIN pop_graphs g ON g.id = s.id ORDER BY s.pos";
+    if(sqlite3_prepare_v2(connection.get(), sql, -1, &raw, nullptr) != SQLITE_OK)
+    {
+        throw std::runtime_error(sqlite3_errmsg(connection.get()));
+    }
+    std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)> statement(raw, sqlite3_finalize);
+
+    auto column = [raw](const int col)
+    {
+        const auto blob = static_cast<const std::uint8_t*>(sqlite3_column_blob(raw, col));
+        return std::span<const std::uint8_t>(blob, static_cast<std::size_t>(sqlite3_column_bytes(raw, col)));
     };
 
+    std::vector<Pop> result;
+    int rc = SQLITE_ROW;
+    while((rc = sqlite3_step(raw)) == SQLITE_ROW)
+    {
+        const auto id = static_cast<PopId>(sqlite3_column_int64(raw, 0));
+
+        result.push_back(popFromBinary(column(1)));
+        popStateFromBinary(result.back(), column(2));
+        result.back().setId(id);
+    }
+    if(rc != SQLITE_DONE)
+    {
+        throw std::runtime_error(sqlite3_errmsg(connection.get()));
+    }
+
     return result;
 }
 
@@ -45,24 +157,63 @@ TaskScores Database::loadScores()
     return result;
 }
 
-void Database::savePops(const std::list<Pop>& pops)
+void Database::savePops(const std::vector<Pop>& pops)
 {
-    mDb << "BEGIN";
-    mDb << "DELETE FROM pops";
-    auto ps = mDb << "INSERT INTO pops VALUES(?, ?)";
-    int i = 0;
-    for(const auto& p : pops)
+    std::set<PopId> saved;
+    Transaction transaction(mDb);
+
+    try
     {
-        ps << i << popToBinary(p);
-        ++i;
-        ps++;
+        std::vector<std::uint8_t> state;
+        for(std::size_t pos = 0; pos < pops.size(); ++pos)
+        {
+            const auto& p = pops[pos];
+            if(!mSavedPops.contains(p.getId()))
+            {
+                auto& ps = prepare(mWriteGraph, "INSERT OR IGNORE INTO pop_graphs VALUES(?, ?)");
+                ps << p.getId() << popToBinary(p);
+                ps++;
+            }
+
+            state.clear();
+            PopFormat::writeState(p, state);
+            auto& ps = prepare(mWriteState, "INSERT OR REPLACE INTO pop_states VALUES(?, ?, ?)");
+            ps << p.getId() << pos << state;
+            ps++;
+
+            saved.insert(p.getId());
+        }
+
+        for(auto id : mSavedPops)
+        {
+            if(!saved.contains(id))
+            {
+                auto& deleteState = prepare(mDeleteState, "DELETE FROM pop_states WHERE id = ?");
+                deleteState << id;
+                deleteState++;
+                auto& deleteGraph = prepare(mDeleteGraph, "DELETE FROM pop_graphs WHERE id = ?");
+                deleteGraph << id;
+                deleteGraph++;
+            }
+        }
     }
-    mDb << "COMMIT";
+    catch(...)
+    {
+        //A statement that failed half way keeps its bound values, they are prepared again next time
+        mWriteGraph.reset();
+        mWriteState.reset();
+        mDeleteState.reset();
+        mDeleteGraph.reset();
+        throw;
+    }
+    transaction.commit();
+
+    mSavedPops = std::move(saved);
 }
 
 void Database::saveScores(const TaskScores& scores)
 {
-    mDb << "BEGIN";
+    Transaction transaction(mDb);
     mDb << "DELETE FROM task_scores";
     auto ps = mDb << "INSERT INTO task_scores VALUES(?, ?)";
     for(const auto& t : scores)
@@ -70,7 +221,7 @@ void Database::saveScores(const TaskScores& scores)
         ps << t.first << t.second;
         ps++;
     }
-    mDb << "COMMIT";
+    transaction.commit();
 }
 
 }
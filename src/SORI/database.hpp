@@ -1,4 +1,6 @@
 #pragma once
+#include <optional>
+#include <set>
 #include <string>
 #include <sstream>
 #include "pop.hpp"
@@ -23,7 +25,24 @@ public:
         return result;
     }
 
-    std::list<Pop> loadPops();
+    //For parameters added later, older databases do not have them
+    template<class T>
+    T loadParameter(const std::string& name, const T def)
+    {
+        auto str = loadParameterStr(name);
+        if(str.empty())
+        {
+            return def;
+        }
+
+        std::stringstream s(str);
+        T result;
+        s >> result;
+
+        return result;
+    }
+
+    std::vector<Pop> loadPops();
     TaskScores loadScores();
 
     template<class T>
@@ -32,14 +51,25 @@ public:
         saveParameterStr(name, std::to_string(t));
     }
 
-    void savePops(const std::list<Pop>& pops);
+    void savePops(const std::vector<Pop>& pops);
     void saveScores(const TaskScores& scores);
 
 private:
     std::string loadParameterStr(const std::string& name);
     void saveParameterStr(const std::string& name, const std::string& value);
+    sqlite::database_binder& prepare(std::optional<sqlite::database_binder>& statement, const std::string& sql);
 
     sqlite::database mDb;
+
+    //Pops in the database, a checkpoint writes the graphs of the others and removes the ones gone
+    std::set<PopId> mSavedPops;
+
+    //Prepared on first use and kept for the following checkpoints
+    std::optional<sqlite::database_binder> mSaveParameter;
+    std::optional<sqlite::database_binder> mWriteGraph;
+    std::optional<sqlite::database_binder> mWriteState;
+    std::optional<sqlite::database_binder> mDeleteGraph;
+    std::optional<sqlite::database_binder> mDeleteState;
 };
 
 }
@@ -3,6 +3,21 @@
 namespace sori
 {
 
+static dng::Image drawSurface(const dng::Size& sz, const TaskContext& ctx)
+{
+    //Limitation: static drawing only, fine for now
+    dng::Image surface(sz.x, sz.y);
+    ctx.draw(surface);
+    return surface;
+}
+
+RenderedTask::RenderedTask(const dng::Size& sz, const ITask& task)
+    : context(task.createContext(sz))
+    , surface(drawSurface(sz, *context))
+    , packedSurface(surface)
+{
+}
+
 Environment::Environment(const dng::Size& sz, const ITask& task, const std::size_t energyLimit)
     : mSize(sz)
     , mTask(task)
@@ -13,10 +28,14 @@ Environment::Environment(const dng::Size& sz, const ITask& task, const std::size
 void Environment::run(Pop& pop)
 {
     auto ctx = mTask.createContext(mSize);
-    //Limitation: static drawing only, fine for now
-    dng::Image surface(mSize.x, mSize.y);
-    ctx->draw(surface);
+    auto surface = drawSurface(mSize, *ctx);
     pop.run(mEnergyLimit, surface, *ctx);
 }
 
+void Environment::run(Pop& pop, const RenderedTask& rendered)
+{
+    auto ctx = rendered.context->clone();
+    pop.run(mEnergyLimit, rendered.surface, rendered.packedSurface, *ctx);
+}
+
 }
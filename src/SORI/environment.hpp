@@ -2,16 +2,29 @@
 
 #include "pop.hpp"
 #include "task.hpp"
+#include "surface.hpp"
 
 namespace sori
 {
 
+//Task instance drawn and packed once, then shared read-only by every pop run on it
+struct RenderedTask
+{
+    RenderedTask(const dng::Size& sz, const ITask& task);
+
+    //Never run itself, each pop gets a clone
+    std::unique_ptr<TaskContext> context;
+    dng::Image surface;
+    PackedSurface packedSurface;
+};
+
 class Environment
 {
 public:
     Environment(const dng::Size& sz, const ITask& task, const std::size_t energyLimit);
 
     void run(Pop& pop);
+    void run(Pop& pop, const RenderedTask& rendered);
 
 private:
     const dng::Size& mSize;
@@ -1,13 +1,15 @@
 #include "pop.hpp"
 #include "gacommon/rng.hpp"
 #include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/stream.hpp>
 #include <boost/mpl/for_each.hpp>
 #include <set>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <limits>
+#include <typeinfo>
 
 BOOST_CLASS_EXPORT_IMPLEMENT(sori::CursorManipulator);
 BOOST_CLASS_EXPORT_IMPLEMENT(sori::ScreenReader);
@@ -50,6 +52,7 @@ void Pop::addRandomUnit()
                mUnits.push_back(decltype(arg)::type::createRandom(genId()));
             }
         });
+    mRouteStart.clear();
 }
 
 void Pop::addRandomConnection()
@@ -58,6 +61,7 @@ void Pop::addRandomConnection()
     auto toPos = Rng::genChoise(mUnits.size());
 
     mUnits[fromPos]->connect(mUnits[toPos]->getId());
+    mRouteStart.clear();
 }
 
 UnitId Pop::genId() const
@@ -65,6 +69,21 @@ UnitId Pop::genId() const
     return mNextId++;
 }
 
+Unit& Pop::detachUnit(const std::size_t pos)
+{
+    auto& unit = mUnits[pos];
+    if(unit.use_count() != 1)
+    {
+        unit = unit->clone(unit->getId());
+    }
+    else
+    {
+        //Pairs with the release of the last other owner, it may have been reading the unit on another thread
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *unit;
+}
+
 Pop Pop::cloneMutated() const
 {
     constexpr double DESTROY_UNIT_CHANCE = 0.01;
@@ -90,27 +109,31 @@ Pop Pop::cloneMutated() const
             continue;
         }
 
-        auto newUnit = unit->clone(unit->getId());
+        //Untouched units stay shared with this pop
         if(Rng::genProbability(MUTATE_UNIT_CHANCE))
         {
+            auto newUnit = unit->clone(unit->getId());
             newUnit->mutate();
+            pop.mUnits.push_back(newUnit);
+        }
+        else
+        {
+            pop.mUnits.push_back(unit);
         }
-
-        pop.mUnits.push_back(newUnit);
     }
 
-    for(auto& unit : pop.mUnits)
+    for(std::size_t i = 0; i < pop.mUnits.size(); ++i)
     {
         while(Rng::genProbability(ADD_CONNECTION_CHANCE))
         {
-            unit->connect(pop.mUnits[Rng::genChoise(pop.mUnits.size())]->getId());
+            pop.detachUnit(i).connect(pop.mUnits[Rng::genChoise(pop.mUnits.size())]->getId());
         }
         while(Rng::genProbability(REMOVE_CONNECTION_CHANCE))
         {
-            auto outs = unit->getNumConnections();
+            auto outs = pop.mUnits[i]->getNumConnections();
             if(outs != 0)
             {
-                unit->removeConnection(Rng::genChoise(outs));
+                pop.detachUnit(i).removeConnection(Rng::genChoise(outs));
             }
         }
     }
@@ -134,13 +157,76 @@ Fitness Pop::getFitness() const
     return mFitness;
 }
 
-std::size_t getMessageCost(const Message& c)
+PopId Pop::getId() const
+{
+    return mId;
+}
+
+void Pop::setId(const PopId id)
+{
+    mId = id;
+}
+
+std::size_t getMessageCost(const Data& d)
 {
     // 1 energy cost per 10 bits
-    return c.data.size() / 10;
+    return d.size() / 10;
+}
+
+static constexpr std::uint32_t NoRoute = std::numeric_limits<std::uint32_t>::max();
+
+void Pop::buildRoutes()
+{
+    std::vector<std::pair<UnitId, std::uint32_t>> ids;
+    ids.reserve(mUnits.size());
+    for(std::uint32_t i = 0; i < mUnits.size(); ++i)
+    {
+        ids.push_back({mUnits[i]->getId(), i});
+    }
+    //Stable so that the last unit wins for duplicate ids, same as the old id map
+    std::stable_sort(ids.begin(), ids.end(), [](auto& a, auto& b){return a.first < b.first;});
+
+    mRouteStart.clear();
+    mRoutes.clear();
+    for(auto& unit : mUnits)
+    {
+        mRouteStart.push_back(mRoutes.size());
+        for(auto dest : unit->getOutputs())
+        {
+            auto pos = std::upper_bound(ids.begin(), ids.end(), dest, [](auto v, auto& x){return v < x.first;});
+            mRoutes.push_back(pos != ids.begin() && std::prev(pos)->first == dest ? std::prev(pos)->second : NoRoute);
+        }
+    }
+    mRouteStart.push_back(mRoutes.size());
+}
+
+namespace
+{
+
+//Message storage shared by all pops run on a thread
+struct MessageBus
+{
+    MessageArena arena;
+    std::vector<std::vector<std::uint32_t>> inboxes;
+    Inbox inbox;
+    std::vector<std::uint32_t> emitted;
+};
+
 }
 
 void Pop::run(const std::size_t energyLimit, const dng::Image& surface, TaskContext& taskContext)
+{
+    Context ctx(surface, taskContext);
+    run(energyLimit, ctx);
+}
+
+void Pop::run(const std::size_t energyLimit, const dng::Image& surface, const PackedSurface& packedSurface, TaskContext& taskContext)
+{
+    Context ctx(surface, packedSurface, taskContext);
+    run(energyLimit, ctx);
+}
+
+void Pop::run(const std::size_t energyLimit, Context& ctx)
 {
     if(mUnits.empty())
     {
@@ -149,45 +235,95 @@ void Pop::run(const std::size_t energyLimit, const dng::Image& surface, TaskCont
         return ;
     }
 
-    Context ctx(surface, taskContext);
-    std::unordered_map<UnitId, std::shared_ptr<Unit>> units;
-    for(auto& unit : mUnits)
+    if(mRouteStart.size() != mUnits.size() + 1)
+    {
+        buildRoutes();
+    }
+
+    thread_local MessageBus bus;
+    bus.arena.reset();
+    bus.inboxes.resize(mUnits.size());
+    mPendingMessages.resize(mUnits.size());
+    for(std::size_t i = 0; i < mUnits.size(); ++i)
     {
-        units[unit->getId()] = unit;
+        auto& inbox = bus.inboxes[i];
+        inbox.clear();
+        for(const auto& data : mPendingMessages[i])
+        {
+            inbox.push_back(bus.arena.acquire());
+            bus.arena.get(inbox.back()) = data;
+        }
+        mPendingMessages[i].clear();
     }
 
+    //Undelivered messages stay with the pop until the next run
+    auto finish = [&](const int score, const std::size_t energyLeft)
+    {
+        for(std::size_t i = 0; i < mUnits.size(); ++i)
+        {
+            for(auto slot : bus.inboxes[i])
+            {
+                mPendingMessages[i].push_back(bus.arena.get(slot));
+            }
+        }
+        mFitness.score = score;
+        mFitness.energyLeft = energyLeft;
+    };
+
     //Discourage wide pops with many unused comps by setting their minimum energy spent as 1 per component
     std::size_t energySpent = mUnits.size();
     while(true)
     {
         while(mUnitPos != mUnits.size())
         {
-            auto& unit = mUnits[mUnitPos];
-            auto delivery = unit->activate(ctx);
-            mUnitPos++;
+            auto& unit = mUnits[mUnitPos]->isStateful() ? detachUnit(mUnitPos) : *mUnits[mUnitPos];
+            auto& slots = bus.inboxes[mUnitPos];
 
-            for(const auto& msg : delivery)
+            bus.inbox.clear();
+            for(auto slot : slots)
             {
-                energySpent += getMessageCost(msg);
-                auto dest = units.find(msg.destination);
-                if(dest != units.end())
-                {
-                    dest->second->postMessage(msg);
-                }
+                bus.inbox.push_back(&bus.arena.get(slot));
+            }
+            bus.emitted.clear();
+            Outbox out(bus.arena, bus.emitted);
+            unit.process(ctx, bus.inbox, out);
+
+            for(auto slot : slots)
+            {
+                bus.arena.release(slot);
+            }
+            slots.clear();
+
+            const auto routeBegin = mRouteStart[mUnitPos];
+            const auto routeEnd = mRouteStart[mUnitPos + 1];
+            mUnitPos++;
 
-                if(ctx.isDone())
+            for(std::size_t e = 0; e < bus.emitted.size(); ++e)
+            {
+                const auto slot = bus.emitted[e];
+                const auto cost = getMessageCost(bus.arena.get(slot));
+                for(auto r = routeBegin; r != routeEnd; ++r)
                 {
-                    // Done
-                    mFitness.score = ctx.getScore();
-                    mFitness.energyLeft = energyLimit - energySpent;
-                    return ;
+                    energySpent += cost;
+                    if(mRoutes[r] != NoRoute)
+                    {
+                        bus.inboxes[mRoutes[r]].push_back(slot);
+                        bus.arena.addRef(slot, 1);
+                    }
+
+                    if(ctx.isDone())
+                    {
+                        // Done
+                        finish(ctx.getScore(), energyLimit - energySpent);
+                        return ;
+                    }
                 }
+                bus.arena.release(slot);
             }
             if(energySpent >= energyLimit)
             {
                 // Dead
-                mFitness.score = ctx.getScore();
-                mFitness.energyLeft = 0;
+                finish(ctx.getScore(), 0);
                 return ;
             }
 
@@ -211,9 +347,9 @@ std::string Pop::print() const
 
 void savePop(const std::string& filename, const Pop& pop)
 {
+    auto bytes = popToBinary(pop);
     std::ofstream stream(filename, std::ios_base::binary | std::ios_base::trunc);
-    boost::archive::binary_oarchive ar(stream);
-    ar & pop;
+    stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
 }
 
 Pop loadPop(const std::string& filename)
@@ -221,21 +357,20 @@ Pop loadPop(const std::string& filename)
     std::ifstream stream(filename, std::ios_base::binary);
     if(stream)
     {
-        boost::archive::binary_iarchive ar(stream);
-        Pop result;
-        ar & result;
-        return result;
+        std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+        return popFromBinary(bytes);
     }
     throw std::runtime_error("File not found: " + filename);
 }
 
-Pop popFromBinary(const std::vector<std::uint8_t>& in)
+Pop popFromBinary(std::span<const std::uint8_t> in)
 {
-    std::string str;;
-    str.resize(in.size());
-    std::copy(in.begin(), in.end(), str.begin());
+    if(PopFormat::isCompact(in))
+    {
+        return PopFormat::read(in);
+    }
 
-    boost::iostreams::array_source source{str.data(), str.size()};
+    boost::iostreams::array_source source{reinterpret_cast<const char*>(in.data()), in.size()};
     boost::iostreams::stream<boost::iostreams::array_source> is{source};
     boost::archive::binary_iarchive ar(is);
     Pop result;
@@ -245,19 +380,53 @@ Pop popFromBinary(const std::vector<std::uint8_t>& in)
 
 std::vector<std::uint8_t> popToBinary(const Pop& pop)
 {
-    std::string serial_str;
+    std::vector<std::uint8_t> result;
+    PopFormat::write(pop, result);
+
+    return result;
+}
+
+void popStateFromBinary(Pop& pop, std::span<const std::uint8_t> in)
+{
+    if(PopFormat::isCompactState(in))
     {
-        boost::iostreams::back_insert_device<std::string> inserter(serial_str);
-        boost::iostreams::stream<boost::iostreams::back_insert_device<std::string> > s(inserter);
-        boost::archive::binary_oarchive ar(s);
-        ar & pop;
+        PopFormat::readState(pop, in);
+        return;
     }
 
-    std::vector<std::uint8_t> result;
-    result.resize(serial_str.size());
-    std::copy(serial_str.begin(), serial_str.end(), result.begin());
+    Fitness fitness;
+    std::size_t unitPos = 0;
+    std::vector<std::vector<Data>> pendingMessages;
+    std::vector<std::size_t> positions;
+    std::vector<std::shared_ptr<Unit>> units;
+    {
+        boost::iostreams::array_source source{reinterpret_cast<const char*>(in.data()), in.size()};
+        boost::iostreams::stream<boost::iostreams::array_source> is{source};
+        boost::archive::binary_iarchive ar(is);
+        ar & fitness.score & fitness.energyLeft & unitPos & pendingMessages & positions & units;
+    }
 
-    return result;
+    //Units are replaced at the end, so a state that does not match leaves the pop as it was
+    bool matches = unitPos <= pop.mUnits.size() && positions.size() == units.size() &&
+        (pendingMessages.empty() || pendingMessages.size() == pop.mUnits.size());
+    for(std::size_t i = 0; matches && i < positions.size(); ++i)
+    {
+        const auto pos = positions[i];
+        matches = pos < pop.mUnits.size() && units[i] && units[i]->getId() == pop.mUnits[pos]->getId() &&
+            typeid(*units[i]) == typeid(*pop.mUnits[pos]);
+    }
+    if(!matches)
+    {
+        throw std::runtime_error("Pop state does not match the pop");
+    }
+
+    pop.mFitness = fitness;
+    pop.mUnitPos = unitPos;
+    pop.mPendingMessages = std::move(pendingMessages);
+    for(std::size_t i = 0; i < positions.size(); ++i)
+    {
+        pop.mUnits[positions[i]] = std::move(units[i]);
+    }
 }
 
 }
@@ -2,7 +2,9 @@
 #include "gacommon/IPlayground.hpp"
 #include "components.hpp"
 #include "task.hpp"
+#include "pop_format.hpp"
 #include <optional>
+#include <span>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/serialization/vector.hpp>
@@ -27,10 +29,14 @@ struct Fitness
     }
 };
 
+using PopId = std::uint64_t;
+
 class Pop
 {
 public:
    friend class boost::serialization::access;
+   friend class PopFormat;
+   friend void popStateFromBinary(Pop& pop, std::span<const std::uint8_t> in);
 
    static Pop createMinimal();
    Pop cloneMutated() const;
@@ -38,7 +44,14 @@ public:
    void setFitness(const Fitness);
    Fitness getFitness() const;
 
+   //Stable identity given by Sori, it is not part of the serialized pop. Only runs change a pop
+   //once it has an id, so a checkpoint writes its units once and its PopFormat state every time
+   PopId getId() const;
+   void setId(const PopId id);
+
    void run(const std::size_t energyLimit, const dng::Image& surface, TaskContext& taskContext);
+   //Same, with the surface packed once by the caller and shared between pops
+   void run(const std::size_t energyLimit, const dng::Image& surface, const PackedSurface& packedSurface, TaskContext& taskContext);
 
    template<class Archive>
    void serialize(Archive & ar, const unsigned int version)
@@ -59,22 +72,36 @@ private:
        mUnits.push_back(std::make_shared<Unit>(std::forward<params>(args)...));
    }
 
+   void run(const std::size_t energyLimit, Context& ctx);
    void addRandomUnit();
    void addRandomConnection();
+   void buildRoutes();
 
    Unit& getUnitById(const UnitId unitId);
+   Unit& detachUnit(const std::size_t pos);
    UnitId genId() const;
 
    Fitness mFitness;
+   PopId mId = 0;
    mutable std::uint64_t mNextId = 0;
 
    std::size_t mUnitPos = 0;
+   //Units may be shared with the parent pop, see detachUnit
    std::vector<std::shared_ptr<Unit>> mUnits;
+   //Messages left undelivered by the last run, indexed as mUnits
+   std::vector<std::vector<Data>> mPendingMessages;
+
+   //Destinations of unit i as indices into mUnits: mRoutes[mRouteStart[i]..mRouteStart[i + 1])
+   std::vector<std::uint32_t> mRouteStart;
+   std::vector<std::uint32_t> mRoutes;
 };
 
 void savePop(const std::string& filename, const Pop& pop);
 Pop loadPop(const std::string& filename);
-Pop popFromBinary(const std::vector<std::uint8_t>& in);
+//Reads the compact format and the boost archives written before it
+Pop popFromBinary(std::span<const std::uint8_t> in);
 std::vector<uint8_t> popToBinary(const Pop& pop);
+//Applies a state as written by PopFormat::writeState, or as the boost archive written before it
+void popStateFromBinary(Pop& pop, std::span<const std::uint8_t> in);
 
 }
@@ -0,0 +1,327 @@
+#include "pop_format.hpp"
+#include "pop.hpp"
+#include <bit>
+#include <cstring>
+#include <typeinfo>
+#include <boost/mpl/for_each.hpp>
+
+namespace sori
+{
+
+static constexpr std::uint8_t Magic[] = {'S', 'P', 'O', 'P'};
+static constexpr std::uint8_t StateMagic[] = {'S', 'P', 'S', 'T'};
+
+BlobWriter::BlobWriter(std::vector<std::uint8_t>& out)
+    : mOut(out)
+{
+}
+
+void BlobWriter::writeVarint(std::uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        mOut.push_back(static_cast<std::uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    mOut.push_back(static_cast<std::uint8_t>(value));
+}
+
+void BlobWriter::writeDouble(const double value)
+{
+    auto bits = std::bit_cast<std::uint64_t>(value);
+    for(int i = 0; i < 8; ++i)
+    {
+        mOut.push_back(static_cast<std::uint8_t>(bits >> (8 * i)));
+    }
+}
+
+void BlobWriter::writeBytes(const std::uint8_t* bytes, const std::size_t size)
+{
+    mOut.insert(mOut.end(), bytes, bytes + size);
+}
+
+BlobWriter& BlobWriter::operator & (const Data& data)
+{
+    thread_local std::vector<Data::block_type> blocks;
+    blocks.clear();
+    boost::to_block_range(data, std::back_inserter(blocks));
+
+    //Unused bits of the last block are always zero, only the bytes holding bits are written
+    writeVarint(data.size());
+    const auto numBytes = (data.size() + 7) / 8;
+    for(std::size_t i = 0; i < numBytes; ++i)
+    {
+        mOut.push_back(static_cast<std::uint8_t>(blocks[i / sizeof(Data::block_type)] >> (8 * (i % sizeof(Data::block_type)))));
+    }
+
+    return *this;
+}
+
+BlobReader::BlobReader(std::span<const std::uint8_t> in)
+    : mIn(in)
+{
+}
+
+void BlobReader::check(const std::size_t size) const
+{
+    if(size > mIn.size() - mPos)
+    {
+        throw std::runtime_error("Pop blob is truncated");
+    }
+}
+
+std::uint64_t BlobReader::readVarint()
+{
+    std::uint64_t result = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        check(1);
+        const auto byte = mIn[mPos++];
+        result |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0)
+        {
+            return result;
+        }
+    }
+
+    throw std::runtime_error("Pop blob has a broken varint");
+}
+
+double BlobReader::readDouble()
+{
+    auto bytes = readBytes(8);
+    std::uint64_t bits = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        bits |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+    }
+
+    return std::bit_cast<double>(bits);
+}
+
+std::span<const std::uint8_t> BlobReader::readBytes(const std::size_t size)
+{
+    check(size);
+    auto result = mIn.subspan(mPos, size);
+    mPos += size;
+
+    return result;
+}
+
+std::size_t BlobReader::getPosition() const
+{
+    return mPos;
+}
+
+BlobReader& BlobReader::operator & (Data& data)
+{
+    const auto numBits = readVarint();
+    auto bytes = readBytes((numBits + 7) / 8);
+
+    data.clear();
+    for(std::size_t i = 0; i < bytes.size(); i += sizeof(Data::block_type))
+    {
+        Data::block_type block = 0;
+        for(std::size_t b = 0; b < sizeof(Data::block_type) && i + b < bytes.size(); ++b)
+        {
+            block |= static_cast<Data::block_type>(bytes[i + b]) << (8 * b);
+        }
+        data.append(block);
+    }
+    data.resize(numBits);
+
+    return *this;
+}
+
+struct PopFormat::UnitFormat
+{
+    const std::type_info* type;
+    void (*write)(BlobWriter& out, Unit& unit);
+    std::shared_ptr<Unit> (*read)(BlobReader& in);
+};
+
+const std::vector<PopFormat::UnitFormat>& PopFormat::getUnitFormats()
+{
+    static const std::vector<UnitFormat> formats = []()
+    {
+        std::vector<UnitFormat> result;
+        boost::mpl::for_each<AllUnitTypes, boost::mpl::make_identity<boost::mpl::_1>>([&result](auto arg) {
+            using Type = typename decltype(arg)::type;
+            result.push_back({
+                &typeid(Type),
+                [](BlobWriter& out, Unit& unit) {static_cast<Type&>(unit).serialize(out, 0);},
+                [](BlobReader& in) {
+                    std::shared_ptr<Type> unit(new Type());
+                    unit->serialize(in, 0);
+                    return std::shared_ptr<Unit>(unit);
+                }});
+        });
+        return result;
+    }();
+
+    return formats;
+}
+
+bool PopFormat::isCompact(std::span<const std::uint8_t> blob)
+{
+    return blob.size() >= sizeof(Magic) && std::memcmp(blob.data(), Magic, sizeof(Magic)) == 0;
+}
+
+void PopFormat::writeUnit(BlobWriter& writer, const Unit& unit)
+{
+    const auto& formats = getUnitFormats();
+
+    std::size_t tag = 0;
+    while(tag != formats.size() && *formats[tag].type != typeid(unit))
+    {
+        ++tag;
+    }
+    if(tag == formats.size())
+    {
+        throw std::runtime_error("Unit type is not in AllUnitTypes");
+    }
+
+    //Fields are length prefixed, so a reader can skip the ones added by later versions
+    thread_local std::vector<std::uint8_t> fields;
+    fields.clear();
+    BlobWriter fieldWriter(fields);
+    formats[tag].write(fieldWriter, const_cast<Unit&>(unit));
+
+    writer.writeVarint(tag);
+    writer.writeVarint(fields.size());
+    writer.writeBytes(fields.data(), fields.size());
+}
+
+std::shared_ptr<Unit> PopFormat::readUnit(BlobReader& reader)
+{
+    const auto& formats = getUnitFormats();
+
+    const auto tag = reader.readVarint();
+    if(tag >= formats.size())
+    {
+        throw std::runtime_error("Unknown unit type " + std::to_string(tag));
+    }
+
+    BlobReader fieldReader(reader.readBytes(reader.readVarint()));
+    return formats[tag].read(fieldReader);
+}
+
+void PopFormat::write(const Pop& pop, std::vector<std::uint8_t>& out)
+{
+    BlobWriter writer(out);
+    writer.writeBytes(Magic, sizeof(Magic));
+    writer.writeVarint(Version);
+    writer & pop.mFitness.score & pop.mFitness.energyLeft & pop.mNextId & pop.mUnitPos;
+
+    writer.writeVarint(pop.mUnits.size());
+    for(const auto& unit : pop.mUnits)
+    {
+        writeUnit(writer, *unit);
+    }
+}
+
+Pop PopFormat::read(std::span<const std::uint8_t> blob)
+{
+    if(!isCompact(blob))
+    {
+        throw std::runtime_error("Not a compact pop");
+    }
+
+    BlobReader reader(blob);
+    reader.readBytes(sizeof(Magic));
+    const auto version = reader.readVarint();
+    if(version > Version)
+    {
+        throw std::runtime_error("Pop format version " + std::to_string(version) + " is newer than " + std::to_string(Version));
+    }
+
+    Pop result;
+    reader & result.mFitness.score & result.mFitness.energyLeft & result.mNextId & result.mUnitPos;
+
+    const auto numUnits = reader.readVarint();
+    result.mUnits.reserve(std::min<std::uint64_t>(numUnits, blob.size()));
+    for(std::uint64_t i = 0; i < numUnits; ++i)
+    {
+        result.mUnits.push_back(readUnit(reader));
+    }
+
+    return result;
+}
+
+bool PopFormat::isCompactState(std::span<const std::uint8_t> blob)
+{
+    return blob.size() >= sizeof(StateMagic) && std::memcmp(blob.data(), StateMagic, sizeof(StateMagic)) == 0;
+}
+
+void PopFormat::writeState(const Pop& pop, std::vector<std::uint8_t>& out)
+{
+    BlobWriter writer(out);
+    writer.writeBytes(StateMagic, sizeof(StateMagic));
+    writer.writeVarint(Version);
+    writer & pop.mFitness.score & pop.mFitness.energyLeft & pop.mUnitPos & pop.mPendingMessages;
+
+    std::size_t numStateful = 0;
+    for(const auto& unit : pop.mUnits)
+    {
+        numStateful += unit->isStateful() ? 1 : 0;
+    }
+
+    writer.writeVarint(numStateful);
+    for(std::size_t pos = 0; pos < pop.mUnits.size(); ++pos)
+    {
+        if(pop.mUnits[pos]->isStateful())
+        {
+            writer.writeVarint(pos);
+            writeUnit(writer, *pop.mUnits[pos]);
+        }
+    }
+}
+
+void PopFormat::readState(Pop& pop, std::span<const std::uint8_t> blob)
+{
+    if(!isCompactState(blob))
+    {
+        throw std::runtime_error("Not a compact pop state");
+    }
+
+    BlobReader reader(blob);
+    reader.readBytes(sizeof(StateMagic));
+    const auto version = reader.readVarint();
+    if(version > Version)
+    {
+        throw std::runtime_error("Pop state version " + std::to_string(version) + " is newer than " + std::to_string(Version));
+    }
+
+    Fitness fitness;
+    std::size_t unitPos = 0;
+    std::vector<std::vector<Data>> pendingMessages;
+    reader & fitness.score & fitness.energyLeft & unitPos & pendingMessages;
+    if(unitPos > pop.mUnits.size() || (!pendingMessages.empty() && pendingMessages.size() != pop.mUnits.size()))
+    {
+        throw std::runtime_error("Pop state does not match the pop");
+    }
+
+    //Units are replaced at the end, so a state that does not match leaves the pop as it was
+    std::vector<std::pair<std::size_t, std::shared_ptr<Unit>>> units;
+    const auto numStateful = reader.readVarint();
+    for(std::uint64_t i = 0; i < numStateful; ++i)
+    {
+        const auto pos = reader.readVarint();
+        auto unit = readUnit(reader);
+        if(pos >= pop.mUnits.size() || unit->getId() != pop.mUnits[pos]->getId() || typeid(*unit) != typeid(*pop.mUnits[pos]))
+        {
+            throw std::runtime_error("Pop state does not match the pop");
+        }
+        units.emplace_back(pos, std::move(unit));
+    }
+
+    pop.mFitness = fitness;
+    pop.mUnitPos = unitPos;
+    pop.mPendingMessages = std::move(pendingMessages);
+    for(auto& [pos, unit] : units)
+    {
+        pop.mUnits[pos] = std::move(unit);
+    }
+}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "data.hpp"
+
+namespace sori
+{
+
+class Pop;
+class Unit;
+
+//Archives for the compact pop format. They run the same serialize members as boost does,
+//integers are written as varints and Data as its bit count followed by the bits packed in bytes
+class BlobWriter
+{
+public:
+   explicit BlobWriter(std::vector<std::uint8_t>& out);
+
+   template<class T>
+   BlobWriter& operator & (const T& value)
+   {
+      if constexpr (std::is_enum_v<T>)
+      {
+         writeVarint(static_cast<std::uint64_t>(value));
+      }
+      else if constexpr (std::is_floating_point_v<T>)
+      {
+         writeDouble(value);
+      }
+      else if constexpr (std::is_signed_v<T>)
+      {
+         //Zigzag, so small negative values stay short
+         const auto v = static_cast<std::int64_t>(value);
+         writeVarint((static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63));
+      }
+      else if constexpr (std::is_integral_v<T>)
+      {
+         writeVarint(value);
+      }
+      else
+      {
+         const_cast<T&>(value).serialize(*this, 0);
+      }
+
+      return *this;
+   }
+
+   template<class T>
+   BlobWriter& operator & (const std::vector<T>& values)
+   {
+      writeVarint(values.size());
+      for(const auto& v : values)
+      {
+         *this & v;
+      }
+
+      return *this;
+   }
+
+   BlobWriter& operator & (const Data& data);
+
+   void writeVarint(std::uint64_t value);
+   void writeDouble(const double value);
+   void writeBytes(const std::uint8_t* bytes, const std::size_t size);
+
+private:
+   std::vector<std::uint8_t>& mOut;
+};
+
+//Reads in place from the given bytes, which have to outlive the reader
+class BlobReader
+{
+public:
+   explicit BlobReader(std::span<const std::uint8_t> in);
+
+   template<class T>
+   BlobReader& operator & (T& value)
+   {
+      if constexpr (std::is_enum_v<T>)
+      {
+         value = static_cast<T>(readVarint());
+      }
+      else if constexpr (std::is_floating_point_v<T>)
+      {
+         value = readDouble();
+      }
+      else if constexpr (std::is_signed_v<T>)
+      {
+         const auto v = readVarint();
+         value = static_cast<T>(static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1));
+      }
+      else if constexpr (std::is_integral_v<T>)
+      {
+         value = static_cast<T>(readVarint());
+      }
+      else
+      {
+         value.serialize(*this, 0);
+      }
+
+      return *this;
+   }
+
+   template<class T>
+   BlobReader& operator & (std::vector<T>& values)
+   {
+      const auto size = readVarint();
+      //Every element takes at least a byte, a bigger size can only come from a corrupted blob
+      check(size);
+      values.resize(size);
+      for(auto& v : values)
+      {
+         *this & v;
+      }
+
+      return *this;
+   }
+
+   BlobReader& operator & (Data& data);
+
+   std::uint64_t readVarint();
+   double readDouble();
+   std::span<const std::uint8_t> readBytes(const std::size_t size);
+   std::size_t getPosition() const;
+
+private:
+   void check(const std::size_t size) const;
+
+   std::span<const std::uint8_t> mIn;
+   std::size_t mPos = 0;
+};
+
+//Versioned pop layout: magic, version, fitness, next unit id, unit position and the units.
+//Every unit is its type tag, the length of its fields and the fields
+class PopFormat
+{
+public:
+   static constexpr std::uint32_t Version = 1;
+
+   //False for the boost archives written before this format
+   static bool isCompact(std::span<const std::uint8_t> blob);
+   static void write(const Pop& pop, std::vector<std::uint8_t>& out);
+   static Pop read(std::span<const std::uint8_t> blob);
+
+   //What a run changes in a pop: fitness, unit position, pending messages and the stateful units.
+   //Applied to the pop it was written from, as read back by read
+   static bool isCompactState(std::span<const std::uint8_t> blob);
+   static void writeState(const Pop& pop, std::vector<std::uint8_t>& out);
+   static void readState(Pop& pop, std::span<const std::uint8_t> blob);
+
+private:
+   struct UnitFormat;
+   static void writeUnit(BlobWriter& writer, const Unit& unit);
+   static std::shared_ptr<Unit> readUnit(BlobReader& reader);
+   //Indexed by type tag, which is the position of the type in AllUnitTypes, so new types go to its end
+   static const std::vector<UnitFormat>& getUnitFormats();
+};
+
+}
@@ -10,6 +10,7 @@ Sori::Sori(const Config& cfg, ITaskManager& taskManager)
   for(std::size_t i = 0; i < mCfg.populationSize; ++i)
   {
      mPopulation.push_back(Pop::createMinimal());
+     mPopulation.back().setId(mNextPopId++);
   }
 }
 
@@ -21,10 +22,18 @@ Sori::Sori(ITaskManager& taskManager, Database& db)
     mCfg.numThreads = db.loadParameter<std::size_t>("num_threads");
     mCfg.populationSize = db.loadParameter<std::size_t>("population_size");
     mCfg.survivalRate = db.loadParameter<double>("survival_rate");
+    //Older databases keep it as a count, where nonzero shares
+    mCfg.shareTaskInstances = db.loadParameter<bool>("share_task_instances", db.loadParameter<std::size_t>("shared_task_instances", 0) != 0);
+    mCfg.contextsPerTask = db.loadParameter<std::size_t>("contexts_per_task", 1);
+    mCfg.tasksPerGeneration = db.loadParameter<std::size_t>("tasks_per_generation", 1);
     mGeneration = db.loadParameter<std::size_t>("generation");
     mCurrentEnergyLimit = db.loadParameter<std::size_t>("current_energy_limit");
     mGlobalTaskScores = db.loadScores();
     mPopulation = db.loadPops();
+    for(const auto& p : mPopulation)
+    {
+        mNextPopId = std::max(mNextPopId, p.getId() + 1);
+    }
 }
 
 void Sori::reconfigure(const Config& cfg)
@@ -39,16 +48,34 @@ void Sori::setStatistics(IStatistics& stats)
 
 void Sori::checkpoint(Database& db)
 {
-    db.saveParameter("env_size_x", mCfg.environmentSize.x);
-    db.saveParameter("env_size_y", mCfg.environmentSize.y);
-    db.saveParameter("num_threads", mCfg.numThreads);
-    db.saveParameter("population_size", mCfg.populationSize);
-    db.saveParameter("survival_rate", mCfg.survivalRate);
-    db.saveParameter("generation", mGeneration);
-    db.saveParameter("current_energy_limit", mCurrentEnergyLimit);
+    auto scope = mTimings.measure(gacommon::Phase::Checkpoint);
+
+    writeSnapshot({mCfg, mGeneration, mCurrentEnergyLimit, mGlobalTaskScores, mPopulation}, db);
+}
+
+Snapshot Sori::makeSnapshot()
+{
+    auto scope = mTimings.measure(gacommon::Phase::Checkpoint);
 
-    db.saveScores(mGlobalTaskScores);
-    db.savePops(mPopulation);
+    return {mCfg, mGeneration, mCurrentEnergyLimit, mGlobalTaskScores, mPopulation};
+}
+
+void Sori::writeSnapshot(const Snapshot& snapshot, Database& db)
+{
+    const auto& cfg = snapshot.cfg;
+    db.saveParameter("env_size_x", cfg.environmentSize.x);
+    db.saveParameter("env_size_y", cfg.environmentSize.y);
+    db.saveParameter("num_threads", cfg.numThreads);
+    db.saveParameter("population_size", cfg.populationSize);
+    db.saveParameter("survival_rate", cfg.survivalRate);
+    db.saveParameter("share_task_instances", cfg.shareTaskInstances);
+    db.saveParameter("contexts_per_task", cfg.contextsPerTask);
+    db.saveParameter("tasks_per_generation", cfg.tasksPerGeneration);
+    db.saveParameter("generation", snapshot.generation);
+    db.saveParameter("current_energy_limit", snapshot.energyLimit);
+
+    db.saveScores(snapshot.taskScores);
+    db.savePops(snapshot.population);
 }
 
 Config Sori::getConfig() const
@@ -72,105 +99,188 @@ int Sori::getLastTaskScore(const std::string& taskName) const
     throw std::runtime_error("No such task " + taskName);
 }
 
-const std::list<Pop>& Sori::getPopulation() const
+const std::vector<Pop>& Sori::getPopulation() const
 {
     return mPopulation;
 }
 
+const gacommon::Timings& Sori::getTimings() const
+{
+    return mTimings;
+}
+
 void Sori::step()
 {
+   mTimings.beginGeneration();
    select();
    populate();
    evaluate();
+   mTimings.endGeneration(mGeneration, mPool.get());
+   if(mStats)
+   {
+       (*mStats).get().onGenerationTimings(mTimings.getLast());
+   }
    mGeneration++;
 }
 void Sori::select()
 {
+   auto scope = mTimings.measure(gacommon::Phase::Select);
+
    //Expected to be sorted after evaluation
-   std::list<Pop> selected;
+   std::vector<Pop> selected;
+   const std::size_t numSelected = getNumSelected();
+   selected.reserve(mCfg.populationSize);
 
-   for(std::size_t i = 0; i < std::max(1, static_cast<int>(mCfg.populationSize * mCfg.survivalRate)); ++i)
+   for(std::size_t i = 0; i < numSelected; ++i)
    {
-       selected.splice(selected.end(), mPopulation, selectTournament(mPopulation));
+       //Take the winner out so it is not picked twice
+       auto pos = selectTournament(mPopulation);
+       selected.push_back(std::move(mPopulation[pos]));
+       if(pos != mPopulation.size() - 1)
+       {
+           mPopulation[pos] = std::move(mPopulation.back());
+       }
+       mPopulation.pop_back();
    }
 
-   mPopulation = selected;
+   mPopulation = std::move(selected);
 }
 
 void Sori::populate()
 {
-   std::vector<std::list<Pop>::iterator> sources;
-   for(auto iter = mPopulation.begin(); iter != mPopulation.end(); ++iter)
-   {
-       sources.push_back(iter);
-   }
+   auto scope = mTimings.measure(gacommon::Phase::Repopulate);
+
+   const std::size_t numSources = mPopulation.size();
+   mPopulation.reserve(mCfg.populationSize + numSources);
 
    while (mPopulation.size() < mCfg.populationSize)
    {
        //Each of the selected individuums pass equal amount of offspring
        //even if it means go above pop limit
-       for(const auto& s : sources)
+       for(std::size_t i = 0; i < numSources; ++i)
        {
-           mPopulation.push_back(s->cloneMutated());
+           mPopulation.push_back(mPopulation[i].cloneMutated());
+           mPopulation.back().setId(mNextPopId++);
        }
    }
 }
 
 void Sori::evaluate()
 {
-   auto& task = mTaskManager.pickNextTask(mGlobalTaskScores);
+   auto tasks = mTaskManager.pickNextTasks(mGlobalTaskScores, std::max<std::size_t>(1, mCfg.tasksPerGeneration));
+   const std::size_t numContexts = std::max<std::size_t>(1, mCfg.contextsPerTask);
+   const std::size_t numRuns = tasks.size() * numContexts;
+
+   //Fitness of run r of pop p is results[p * numRuns + r], runs are grouped by task
+   std::vector<Fitness> results(mPopulation.size() * numRuns);
 
-   std::vector<std::thread> threads;
-   for(std::size_t i = 0; i < mCfg.numThreads; ++i)
+   gacommon::ensureThreadPool(mPool, mCfg.numThreads);
    {
-       threads.push_back(std::thread([this, i, &task](){
-           Environment ev(mCfg.environmentSize, task, mCurrentEnergyLimit);
-           auto iter = mPopulation.begin();
-           for(std::size_t popidx = 0; popidx < mPopulation.size(); ++popidx, ++iter)
+       auto scope = mTimings.measure(gacommon::Phase::Evaluate);
+
+       //Every pop runs context c of a task on the same instance, so the pops are scored alike
+       //and no pop sees an instance twice
+       const std::size_t numShared = mCfg.shareTaskInstances ? numContexts : 0;
+       std::vector<std::unique_ptr<RenderedTask>> rendered(tasks.size() * numShared);
+       mPool->parallelFor(rendered.size(), [this, &tasks, &rendered, numShared](const std::size_t i){
+           rendered[i] = std::make_unique<RenderedTask>(mCfg.environmentSize, *tasks[i / numShared]);
+       });
+
+       mPool->parallelFor(mPopulation.size(), [&, this](const std::size_t popidx){
+           auto& pop = mPopulation[popidx];
+           if(mCfg.testMode && mCfg.numThreads == 1)
+           {
+               savePop("LastRunPop", pop);
+           }
+
+           Fitness total;
+           for(std::size_t t = 0; t < tasks.size(); ++t)
            {
-               if((popidx % mCfg.numThreads) == i)
+               Environment ev(mCfg.environmentSize, *tasks[t], mCurrentEnergyLimit);
+               for(std::size_t c = 0; c < numContexts; ++c)
                {
-                   if(mCfg.testMode && mCfg.numThreads == 1)
+                   if(rendered.empty())
+                   {
+                       ev.run(pop);
+                   }
+                   else
                    {
-                       savePop("LastRunPop", *iter);
+                       ev.run(pop, *rendered[t * numShared + c]);
                    }
-                   ev.run(*iter);
+
+                   auto fitness = pop.getFitness();
+                   results[popidx * numRuns + t * numContexts + c] = fitness;
+                   total.score += fitness.score;
+                   total.energyLeft += fitness.energyLeft;
                }
            }
-       }));
+           pop.setFitness({total.score / static_cast<int>(numRuns), total.energyLeft / numRuns});
+       });
+       mTimings.addEvaluations(mPopulation.size() * numRuns);
    }
 
-   for(auto& t : threads)
+   //Per task summaries, the pops are still in the order of results
+   bool solved = true;
+   for(std::size_t t = 0; t < tasks.size(); ++t)
    {
-       t.join();
-   }
+       TaskResult taskResult;
+       taskResult.numContexts = numContexts;
+       int totalMean = 0;
+       int totalMin = 0;
+       for(std::size_t p = 0; p < mPopulation.size(); ++p)
+       {
+           auto first = results.begin() + p * numRuns + t * numContexts;
+           auto sum = std::accumulate(first, first + numContexts, 0, [](const int score, const auto& f){return score + f.score;});
+           auto min = std::min_element(first, first + numContexts, [](auto& x, auto& y){return x.score < y.score;})->score;
+           const int mean = sum / static_cast<int>(numContexts);
 
-   mPopulation.sort([](auto& x, auto& y){return x.getFitness() > y.getFitness();});
-   const auto maxScore = mPopulation.begin()->getFitness().score;
-   if(mStats)
-   {
-       auto totalScore = std::accumulate(mPopulation.begin(), mPopulation.end(), 0, [](const int score, const auto& pop){return score + pop.getFitness().score;});
-       (*mStats).get().onStepResult(task.getName(), mGeneration, mCurrentEnergyLimit, maxScore, totalScore / mPopulation.size());
+           taskResult.maxMeanScore = p == 0 ? mean : std::max(taskResult.maxMeanScore, mean);
+           taskResult.maxMinScore = p == 0 ? min : std::max(taskResult.maxMinScore, min);
+           totalMean += mean;
+           totalMin += min;
+       }
+       taskResult.avgMeanScore = totalMean / static_cast<int>(mPopulation.size());
+       taskResult.avgMinScore = totalMin / static_cast<int>(mPopulation.size());
+
+       auto& task = *tasks[t];
+       if(mStats)
+       {
+           (*mStats).get().onTaskResult(task.getName(), mGeneration, taskResult);
+           //Keyed by generation, so only the first task goes to the step log
+           if(t == 0)
+           {
+               (*mStats).get().onStepResult(task.getName(), mGeneration, mCurrentEnergyLimit, taskResult.maxMeanScore, taskResult.avgMeanScore);
+           }
+       }
+       solved = solved && taskResult.maxMeanScore >= task.getSolvedScore();
+       mGlobalTaskScores[task.getName()] = taskResult.maxMeanScore;
    }
-   if(maxScore < task.getSolvedScore())
+   if(!solved)
    {
        mCurrentEnergyLimit += 10;
    }
-   mGlobalTaskScores[task.getName()] = maxScore;
+
+   {
+       auto scope = mTimings.measure(gacommon::Phase::Sort);
+       std::stable_sort(mPopulation.begin(), mPopulation.end(), [](auto& x, auto& y){return x.getFitness() > y.getFitness();});
+   }
+}
+
+std::size_t Sori::getNumSelected() const
+{
+   return std::max(1, static_cast<int>(mCfg.populationSize * mCfg.survivalRate));
 }
 
-std::list<Pop>::iterator Sori::selectTournament(std::list<Pop>& pops)
+std::size_t Sori::selectTournament(const std::vector<Pop>& pops)
 {
     const int NUM_PARTICIPANTS = 8;
     const double PARTICIPANT_CHANCE = 0.5;
 
-    std::vector<std::pair<std::list<Pop>::iterator, sori::Fitness>> candidates;
+    std::vector<std::pair<std::size_t, sori::Fitness>> candidates;
     for(int i = 0; i < NUM_PARTICIPANTS; ++i)
     {
         auto pos = Rng::genChoise(pops.size());
-        auto candidate = pops.begin();
-        std::advance(candidate, pos);
-        candidates.push_back({candidate, candidate->getFitness()});
+        candidates.push_back({pos, pops[pos].getFitness()});
     }
 
     std::sort(candidates.begin(), candidates.end(), [](auto x, auto y){return x.second > y.second;});
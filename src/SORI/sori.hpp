@@ -1,10 +1,11 @@
 #pragma once
 
-#include <list>
+#include <vector>
 #include <map>
-#include <thread>
 #include "gacommon/IPlayground.hpp"
 #include "gacommon/rng.hpp"
+#include "gacommon/thread_pool.hpp"
+#include "gacommon/timings.hpp"
 #include "task.hpp"
 #include "pop.hpp"
 #include "environment.hpp"
@@ -22,6 +23,23 @@ struct Config
 
    std::size_t numThreads = 4;
    dng::Size environmentSize = {500, 364};
+   //Draws contextsPerTask instances of every task per generation and runs all pops on them,
+   //otherwise a new instance is drawn for every run
+   bool shareTaskInstances = false;
+   //Every pop is scored by the mean over contextsPerTask runs on each of tasksPerGeneration tasks
+   std::size_t contextsPerTask = 1;
+   std::size_t tasksPerGeneration = 1;
+};
+
+//State written by a checkpoint, taken between generations. The pops share their units with the live
+//population, which copies a unit before changing it, so a snapshot can be written while Sori steps
+struct Snapshot
+{
+   Config cfg;
+   std::size_t generation;
+   std::size_t energyLimit;
+   TaskScores taskScores;
+   std::vector<Pop> population;
 };
 
 class Sori
@@ -39,26 +57,33 @@ public:
    std::size_t getEnergyLimit() const;
    std::size_t getGeneration() const;
    Config getConfig() const;
-   const std::list<Pop>& getPopulation() const;
+   const std::vector<Pop>& getPopulation() const;
    int getLastTaskScore(const std::string& taskName) const;
+   const gacommon::Timings& getTimings() const;
 
    void checkpoint(Database& db);
+   Snapshot makeSnapshot();
+   static void writeSnapshot(const Snapshot& snapshot, Database& db);
 
 private:
    void select();
    void populate();
    void evaluate();
 
-   std::list<Pop>::iterator selectTournament(std::list<Pop>& pops);
+   std::size_t getNumSelected() const;
+   std::size_t selectTournament(const std::vector<Pop>& pops);
 
    Config mCfg;
-   std::list<Pop> mPopulation;
+   std::vector<Pop> mPopulation;
    ITaskManager& mTaskManager;
    TaskScores mGlobalTaskScores;
    std::size_t mGeneration = 1;
    std::size_t mCurrentEnergyLimit = 100;
+   PopId mNextPopId = 0;
 
    std::optional<std::reference_wrapper<IStatistics>> mStats;
+   std::unique_ptr<gacommon::ThreadPool> mPool;
+   gacommon::Timings mTimings;
 };
 
 }
@@ -1,15 +1,29 @@
 #pragma once
 #include <string>
+#include "gacommon/timings.hpp"
 
 namespace sori
 {
 
+//Scores of one task in a generation. Every pop is run on numContexts contexts of the task,
+//its mean and min over them are then summarized over the population
+struct TaskResult
+{
+    std::size_t numContexts = 0;
+    int maxMeanScore = 0;
+    int avgMeanScore = 0;
+    int maxMinScore = 0;
+    int avgMinScore = 0;
+};
+
 class IStatistics
 {
 public:
     virtual ~IStatistics(){}
 
     virtual void onStepResult(const std::string& taskName, const std::size_t genNumber, const std::size_t energyLimit, const int maxScore, const int avgScore) = 0;
+    virtual void onGenerationTimings(const gacommon::GenerationTimings& timings) = 0;
+    virtual void onTaskResult(const std::string& taskName, const std::size_t genNumber, const TaskResult& result) = 0;
 };
 
 }
@@ -0,0 +1,70 @@
+#include "surface.hpp"
+#include <array>
+
+namespace sori
+{
+
+static_assert(Data::bits_per_block % 8 == 0);
+
+namespace
+{
+
+//Bit i of a packed block is bit (7 - i) of the channel byte
+std::array<std::uint8_t, 256> createReverseTable()
+{
+    std::array<std::uint8_t, 256> result;
+    for(unsigned int i = 0; i < 256; ++i)
+    {
+        std::uint8_t r = 0;
+        for(int b = 0; b < 8; ++b)
+        {
+            r |= ((i >> b) & 1) << (7 - b);
+        }
+        result[i] = r;
+    }
+
+    return result;
+}
+
+const std::array<std::uint8_t, 256> sReverse = createReverseTable();
+
+}
+
+PackedSurface::PackedSurface(const dng::Image& surface)
+    : mWidth(surface.width())
+    , mHeight(surface.height())
+    , mBlocksPerRow((mWidth * BitsPerPixel + Data::bits_per_block - 1) / Data::bits_per_block)
+    , mBlocks(mBlocksPerRow * mHeight, 0)
+{
+    constexpr std::size_t BytesPerBlock = Data::bits_per_block / 8;
+
+    auto view = boost::gil::const_view(surface);
+    for(std::size_t y = 0; y < mHeight; ++y)
+    {
+        auto* row = &mBlocks[y * mBlocksPerRow];
+        std::size_t byte = 0;
+        for(auto p = view.row_begin(y); p != view.row_end(y); ++p)
+        {
+            for(std::uint8_t channel : {boost::gil::at_c<0>(*p), boost::gil::at_c<1>(*p), boost::gil::at_c<2>(*p)})
+            {
+                row[byte / BytesPerBlock] |= static_cast<Data::block_type>(sReverse[channel]) << (8 * (byte % BytesPerBlock));
+                byte++;
+            }
+        }
+    }
+}
+
+dng::Size PackedSurface::getSize() const
+{
+    return {static_cast<std::uint16_t>(mWidth), static_cast<std::uint16_t>(mHeight)};
+}
+
+void PackedSurface::read(const dng::Point& pos, const dng::Size& sz, Data& out) const
+{
+    for(std::size_t y = pos.y; y < static_cast<std::size_t>(pos.y) + sz.y; ++y)
+    {
+        appendBitRange(out, &mBlocks[y * mBlocksPerRow], pos.x * BitsPerPixel, sz.x * BitsPerPixel);
+    }
+}
+
+}
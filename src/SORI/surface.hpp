@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include "data.hpp"
+#include "dng/primitives.hpp"
+
+namespace sori
+{
+
+//Surface stored in the bit layout of ScreenReader messages: pixels row by row,
+//each of them as R, G, B channels with the most significant bit first
+class PackedSurface
+{
+public:
+    static constexpr std::size_t BitsPerPixel = 24;
+
+    explicit PackedSurface(const dng::Image& surface);
+
+    dng::Size getSize() const;
+
+    //Appends the rectangle to out row by row, the rectangle must lie inside the surface
+    void read(const dng::Point& pos, const dng::Size& sz, Data& out) const;
+
+private:
+    std::size_t mWidth = 0;
+    std::size_t mHeight = 0;
+    std::size_t mBlocksPerRow = 0;
+    std::vector<Data::block_type> mBlocks;
+};
+
+}
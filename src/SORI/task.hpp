@@ -1,6 +1,9 @@
 #pragma once
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
+#include <algorithm>
 #include "dng/primitives.hpp"
 
 namespace sori
@@ -14,6 +17,8 @@ public:
     virtual void onClick(const dng::Point& pos) = 0;
     virtual int getScore() const = 0;
     virtual void draw(dng::Image& surface) const = 0;
+    //Copy of the current state, lets many pops run on one drawn instance
+    virtual std::unique_ptr<TaskContext> clone() const = 0;
     virtual ~TaskContext() {}
 };
 
@@ -34,6 +39,22 @@ public:
     virtual ~ITaskManager() {}
 
     virtual ITask& pickNextTask(const TaskScores& taskScores) = 0;
+
+    //Up to num distinct tasks, the first one is picked as pickNextTask does
+    virtual std::vector<ITask*> pickNextTasks(const TaskScores& taskScores, const std::size_t num)
+    {
+        std::vector<ITask*> result;
+        for(std::size_t i = 0; i < num; ++i)
+        {
+            auto task = &pickNextTask(taskScores);
+            if(std::find(result.begin(), result.end(), task) == result.end())
+            {
+                result.push_back(task);
+            }
+        }
+
+        return result;
+    }
 };
 
 }
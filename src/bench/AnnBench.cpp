@@ -0,0 +1,95 @@
+#include "benchmarks.hpp"
+#include "neat/genom.hpp"
+#include "gacommon/rng.hpp"
+#include <iostream>
+#include <iomanip>
+
+namespace bench
+{
+
+namespace
+{
+
+//Construction path used before createAnn2 compiled genomes directly
+std::unique_ptr<gacommon::NeuroNet2> createAnnById(const neat::v2::Genom& g)
+{
+    std::vector<gacommon::NodeId> inputNodes(g.getNodeCount(neat::v2::Genom::NodeType::Input));
+    std::vector<gacommon::NodeId> outputNodes(g.getNodeCount(neat::v2::Genom::NodeType::Output));
+    std::vector<gacommon::NeuroNet2::HiddenNodeDef> hiddenNodes(g.getNodeCount(neat::v2::Genom::NodeType::Hidden));
+    std::vector<gacommon::NeuroNet2::ConnectionDef> connections(g.getComplexity());
+
+    std::transform(g.beginNodes(neat::v2::Genom::NodeType::Input), g.endNodes(neat::v2::Genom::NodeType::Input),
+        inputNodes.begin(), [](auto x){return x.id;});
+    std::transform(g.beginNodes(neat::v2::Genom::NodeType::Output), g.endNodes(neat::v2::Genom::NodeType::Output),
+        outputNodes.begin(), [](auto x){return x.id;});
+    std::transform(g.beginNodes(neat::v2::Genom::NodeType::Hidden), g.endNodes(neat::v2::Genom::NodeType::Hidden),
+        hiddenNodes.begin(), [](auto x){return gacommon::NeuroNet2::HiddenNodeDef{x.id, x.acType, 0.0};});
+    std::transform(g.begin(), g.end(),
+        connections.begin(), [](auto x){return gacommon::NeuroNet2::ConnectionDef{x.srcNodeId, x.dstNodeId, x.weight};});
+
+    return std::make_unique<gacommon::NeuroNet2>(inputNodes, outputNodes, hiddenNodes, connections);
+}
+
+//Grows a genome with complexity close to the target: a fifth of it goes to hidden nodes, the rest to random links
+neat::v2::Genom createGenom(const std::size_t complexity, neat::InnovationHistory& history)
+{
+    const neat::NodeId numInputs = 3;
+    const neat::NodeId numOutputs = 2;
+
+    auto g = neat::v2::Genom::createMinimal(numInputs, numOutputs, history, true);
+    while(g.getNodeCount(neat::v2::Genom::NodeType::Hidden) < complexity / 5)
+    {
+        neat::v2::mutateAddNode(g, history);
+    }
+
+    std::vector<neat::NodeId> srcs;
+    std::vector<neat::NodeId> dsts;
+    for(auto iter = g.beginNodes(neat::v2::Genom::NodeType::All); iter != g.endNodes(neat::v2::Genom::NodeType::All); ++iter)
+    {
+        srcs.push_back(iter->id);
+    }
+    auto dstTypes = static_cast<neat::v2::Genom::NodeType>(neat::v2::Genom::NodeType::Output | neat::v2::Genom::NodeType::Hidden);
+    for(auto iter = g.beginNodes(dstTypes); iter != g.endNodes(dstTypes); ++iter)
+    {
+        dsts.push_back(iter->id);
+    }
+
+    while(g.getComplexity() < complexity)
+    {
+        auto src = srcs[Rng::genChoise(srcs.size())];
+        auto dst = dsts[Rng::genChoise(dsts.size())];
+        if(!g.isConnected(src, dst))
+        {
+            g.connect(src, dst, history, Rng::genWeight());
+        }
+    }
+
+    return g;
+}
+
+}
+
+void runAnnBench()
+{
+    Rng::seed(1);
+
+    std::cout << std::setw(12) << "complexity" << std::setw(16) << "by id, ns" << std::setw(16) << "direct, ns" << std::setw(10) << "speedup" << "\n";
+
+    for(std::size_t complexity : {10, 100, 1000})
+    {
+        neat::InnovationHistory history;
+        auto g = createGenom(complexity, history);
+
+        const std::size_t numIterations = 2000000 / complexity;
+        std::size_t sink = 0;
+
+        auto byId = measure(numIterations, [&]{sink += static_cast<bool>(createAnnById(g));});
+        auto direct = measure(numIterations, [&]{sink += static_cast<bool>(neat::v2::createAnn2(g));});
+
+        std::cout << std::setw(12) << g.getComplexity() << std::setw(16) << std::fixed << std::setprecision(0) << byId
+                  << std::setw(16) << direct << std::setw(9) << std::setprecision(2) << byId / direct << "x"
+                  << (sink == 0 ? " " : "") << "\n";
+    }
+}
+
+}
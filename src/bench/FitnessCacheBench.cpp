@@ -0,0 +1,94 @@
+#include "benchmarks.hpp"
+#include "neat/neat.hpp"
+#include "playgrounds/LogicalPG.hpp"
+#include <iostream>
+#include <iomanip>
+
+namespace bench
+{
+
+namespace
+{
+
+//Same evaluator with the cache switched off
+class UncachedEvaluator : public gacommon::IFitnessEvaluator
+{
+public:
+    UncachedEvaluator(gacommon::IFitnessEvaluator& impl)
+        : mImpl(impl)
+    {
+    }
+
+    gacommon::Fitness evaluate(gacommon::IAgent& agent) override
+    {
+        return mImpl.evaluate(agent);
+    }
+
+private:
+    gacommon::IFitnessEvaluator& mImpl;
+};
+
+struct CacheRun
+{
+    double evaluateMs = 0;
+    std::size_t numEvaluations = 0;
+    std::size_t lookups = 0;
+    std::size_t hits = 0;
+};
+
+CacheRun runNeat(gacommon::IFitnessEvaluator& eval, const std::size_t numGenerations)
+{
+    neat::Config cfg;
+    cfg.numInputs = 6;
+    cfg.numOutputs = 2;
+    cfg.numThreads = 1;
+    cfg.populationCfg.size = 150;
+    cfg.populationCfg.mCompatibilityFactor = 5.0;
+    cfg.populationCfg.minterspecieCrossoverPercentage = 1;
+    cfg.populationCfg.mC1_C2 = 1;
+    cfg.populationCfg.mC3 = 0.3;
+    cfg.mutationCfg.perturbationChance = 0.9;
+    cfg.mutationCfg.addNodeMutationChance = 0.05;
+    cfg.mutationCfg.changeNodeMutationChance = 0.2;
+    cfg.mutationCfg.addConnectionMutationChance = 0.1;
+    cfg.mutationCfg.removeConnectionMutationChance = 0.1;
+    cfg.mutationCfg.removeNodeMutationChance = 0.05;
+    cfg.mutationCfg.weightsMutationChance = 0.8;
+    neat::Neat n(cfg, neat::EvolutionStrategyType::Blend, eval);
+
+    CacheRun result;
+    for(std::size_t i = 0; i < numGenerations; ++i)
+    {
+        n.step();
+        auto timings = n.getTimings().getLast();
+        result.evaluateMs += std::chrono::duration<double, std::milli>(timings.get(gacommon::Phase::Evaluate)).count();
+        result.numEvaluations += timings.numEvaluations;
+        result.lookups += timings.cacheLookups;
+        result.hits += timings.cacheHits;
+    }
+
+    return result;
+}
+
+}
+
+void runFitnessCacheBench()
+{
+    const std::size_t numGenerations = 50;
+    pgs::LogicalPG pg;
+    UncachedEvaluator uncached(pg.getFitnessEvaluator());
+
+    std::cout << std::fixed;
+    std::cout << "NEAT on LogicalPG, 150 pops, " << numGenerations << " generations, average per generation\n";
+    std::cout << std::setw(10) << "cache" << std::setw(16) << "evaluate, ms" << std::setw(16) << "evaluations" << std::setw(16) << "hit rate" << "\n";
+    for(gacommon::IFitnessEvaluator* eval : {static_cast<gacommon::IFitnessEvaluator*>(&uncached), &pg.getFitnessEvaluator()})
+    {
+        auto r = runNeat(*eval, numGenerations);
+        std::cout << std::setw(10) << (eval == &uncached ? "off" : "on") << std::setprecision(2)
+                  << std::setw(16) << r.evaluateMs / numGenerations << std::setprecision(1)
+                  << std::setw(16) << static_cast<double>(r.numEvaluations) / numGenerations
+                  << std::setw(15) << (r.lookups ? 100.0 * r.hits / r.lookups : 0.0) << "%\n";
+    }
+}
+
+}
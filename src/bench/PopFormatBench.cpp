@@ -0,0 +1,105 @@
+#include "benchmarks.hpp"
+#include "SORI/database.hpp"
+#include "gacommon/rng.hpp"
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+namespace bench
+{
+
+namespace
+{
+
+//Pop as the boost archive written before the compact format
+std::vector<std::uint8_t> toArchive(const sori::Pop& pop)
+{
+    std::stringstream stream;
+    {
+        boost::archive::binary_oarchive ar(stream);
+        ar & pop;
+    }
+    auto str = stream.str();
+    return {str.begin(), str.end()};
+}
+
+std::string makeDatabase(const std::string& name, const std::vector<sori::Pop>& pops, const std::vector<std::vector<std::uint8_t>>& blobs)
+{
+    const auto path = (std::filesystem::temp_directory_path() / name).string();
+    for(auto suffix : {"", "-wal", "-shm"})
+    {
+        std::filesystem::remove(path + suffix);
+    }
+
+    //Creates the tables
+    sori::Database schema(path);
+    sqlite::database db(path);
+    db << "BEGIN";
+    auto insGraph = db << "INSERT INTO pop_graphs VALUES(?, ?)";
+    auto insState = db << "INSERT INTO pop_states VALUES(?, ?, ?)";
+    for(std::size_t i = 0; i < blobs.size(); ++i)
+    {
+        std::vector<std::uint8_t> state;
+        sori::PopFormat::writeState(pops[i], state);
+
+        insGraph << i << blobs[i];
+        insGraph++;
+        insState << i << i << state;
+        insState++;
+    }
+    db << "COMMIT";
+
+    return path;
+}
+
+}
+
+void runPopFormatBench()
+{
+    const std::size_t numPops = 10000;
+
+    //Lineages of mutated clones, like a population after many generations
+    Rng::seed(1);
+    std::vector<sori::Pop> pops;
+    pops.push_back(sori::Pop::createMinimal());
+    while(pops.size() < numPops)
+    {
+        pops.push_back(pops[Rng::genChoise(pops.size())].cloneMutated());
+    }
+
+    std::vector<std::vector<std::uint8_t>> archives;
+    std::vector<std::vector<std::uint8_t>> compacts;
+    auto archiveNs = measure(numPops, [&, i = std::size_t(0)]() mutable {archives.push_back(toArchive(pops[i++]));});
+    auto compactNs = measure(numPops, [&, i = std::size_t(0)]() mutable {compacts.push_back(sori::popToBinary(pops[i++]));});
+
+    std::size_t archiveBytes = 0;
+    std::size_t compactBytes = 0;
+    for(std::size_t i = 0; i < numPops; ++i)
+    {
+        archiveBytes += archives[i].size();
+        compactBytes += compacts[i].size();
+    }
+
+    auto archivePath = makeDatabase("sori_bench_archive.db", pops, archives);
+    auto compactPath = makeDatabase("sori_bench_compact.db", pops, compacts);
+    auto loadMs = [numPops](const std::string& path)
+    {
+        return measure(1, [&]()
+        {
+            sori::Database db(path);
+            if(db.loadPops().size() != numPops)
+            {
+                throw std::runtime_error("Pops are missing");
+            }
+        }) / 1e6;
+    };
+
+    std::cout << numPops << " pops\n";
+    std::cout << std::setw(10) << "format" << std::setw(14) << "encode, us" << std::setw(14) << "bytes/pop" << std::setw(14) << "load db, ms" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(10) << "boost" << std::setw(14) << archiveNs / 1000 << std::setw(14) << archiveBytes / numPops << std::setw(14) << loadMs(archivePath) << "\n";
+    std::cout << std::setw(10) << "compact" << std::setw(14) << compactNs / 1000 << std::setw(14) << compactBytes / numPops << std::setw(14) << loadMs(compactPath) << "\n";
+}
+
+}
@@ -0,0 +1,100 @@
+#include "benchmarks.hpp"
+#include "dng/drawing.hpp"
+#include "dng/geometry.hpp"
+#include "gacommon/rng.hpp"
+#include <iostream>
+#include <iomanip>
+
+namespace bench
+{
+
+namespace
+{
+
+//Polygon fill as it was before the scanline rasterizer: every bounding box point tested with within
+void fillPolygonReference(dng::Image& target, const dng::polygon_t& poly, const dng::Color color)
+{
+    std::vector<dng::bgpoint_t> points;
+    boost::geometry::model::box<dng::bgpoint_t> b;
+    boost::geometry::envelope(poly, b);
+    auto min_corner = b.min_corner();
+    auto max_corner = b.max_corner();
+    for (double x = min_corner.get<0>(); x <= max_corner.get<0>(); ++x) {
+        for (double y = min_corner.get<1>(); y <= max_corner.get<1>(); ++y) {
+            dng::bgpoint_t p(x, y);
+            if (boost::geometry::within(p, poly)) {
+                points.push_back(p);
+            }
+        }
+    }
+
+    auto v = boost::gil::view(target);
+    for(auto p : points)
+    {
+        auto x = p.get<0>();
+        auto y = p.get<1>();
+        if(x < 0 || x >= v.width() || y < 0 || y >= v.height())
+        {
+            continue;
+        }
+        v(x, y) = color;
+    }
+}
+
+std::size_t countDifferentPixels(const dng::Image& a, const dng::Image& b)
+{
+    std::size_t result = 0;
+    auto va = boost::gil::const_view(a);
+    auto vb = boost::gil::const_view(b);
+    for(int y = 0; y < va.height(); ++y)
+    {
+        for(int x = 0; x < va.width(); ++x)
+        {
+            result += va(x, y) != vb(x, y);
+        }
+    }
+    return result;
+}
+
+template<class MakePolygon>
+void benchShape(const std::string& name, MakePolygon makePolygon)
+{
+    //Same surface and shape sizes as the object detection tasks
+    const dng::Size envSize{500, 364};
+    const std::size_t numShapes = 50;
+
+    std::vector<dng::polygon_t> polygons;
+    for(std::size_t i = 0; i < numShapes; ++i)
+    {
+        dng::Size sz{static_cast<uint16_t>(Rng::gen32() % 100 + 10), static_cast<uint16_t>(Rng::gen32() % 100 + 10)};
+        polygons.push_back(makePolygon(dng::genCoordsToFit(envSize, sz), sz));
+    }
+
+    dng::Image reference(envSize.x, envSize.y);
+    dng::Image scanline(envSize.x, envSize.y);
+    dng::fill(reference, dng::colors::Black);
+    dng::fill(scanline, dng::colors::Black);
+
+    auto referenceNs = measure(polygons.size(), [&, i = std::size_t(0)]() mutable {fillPolygonReference(reference, polygons[i++], dng::colors::Blue);});
+    auto scanlineNs = measure(polygons.size(), [&, i = std::size_t(0)]() mutable {dng::fillPolygon(scanline, polygons[i++], dng::colors::Blue);});
+
+    std::cout << std::setw(10) << name << std::fixed << std::setprecision(1)
+              << std::setw(16) << referenceNs / 1000 << std::setw(16) << scanlineNs / 1000
+              << std::setprecision(2) << std::setw(9) << referenceNs / scanlineNs << "x"
+              << std::setw(16) << countDifferentPixels(reference, scanline) << "\n";
+}
+
+}
+
+void runRenderBench()
+{
+    Rng::seed(1);
+
+    std::cout << "500x364 surface, average per shape\n";
+    std::cout << std::setw(10) << "shape" << std::setw(16) << "reference, us" << std::setw(16) << "scanline, us" << std::setw(10) << "" << std::setw(16) << "pixels differ" << "\n";
+    benchShape("Hex", dng::makeHexPolygon);
+    benchShape("Triangle", dng::makeTrianglePolygon);
+    benchShape("Circle", dng::makeCirclePolygon);
+}
+
+}
@@ -0,0 +1,106 @@
+#include "benchmarks.hpp"
+#include "neat/population.hpp"
+#include "gacommon/rng.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+namespace bench
+{
+
+void runSnapshotBench()
+{
+    Rng::seed(1);
+
+    const neat::NodeId numInputs = 8;
+    const neat::NodeId numOutputs = 4;
+    neat::Population::Config cfg{10000, 3.0, 0.0, 1.0, 2.0};
+
+    neat::v2::MutationConfig mutationCfg;
+    mutationCfg.addConnectionMutationChance = 1.0;
+    mutationCfg.addNodeMutationChance = 0.5;
+
+    neat::InnovationHistory history;
+    auto population = neat::Population::createInitialPopulation(numInputs, numOutputs, cfg, history);
+    for(auto& s : population)
+    {
+        for(auto& p : s.population)
+        {
+            for(int j = 0; j < 20; ++j)
+            {
+                p.genotype.mutate(mutationCfg, history);
+            }
+        }
+    }
+
+    const auto legacyPath = (std::filesystem::temp_directory_path() / "neat_bench_legacy.state").string();
+    const auto snapshotPath = (std::filesystem::temp_directory_path() / "neat_bench_snapshot.state").string();
+
+    //Stream format as Neat::saveState wrote it before snapshots
+    auto legacySaveNs = measure(1, [&]
+    {
+        std::ofstream ofile(legacyPath, std::ios::binary | std::ios::trunc);
+        ofile << std::size_t(1);
+        history.saveState(ofile);
+        population.saveState(ofile);
+    });
+    auto snapshotSaveNs = measure(1, [&]{neat::PopulationSnapshot::write(snapshotPath, 1, history, &population, numInputs, numOutputs);});
+
+    std::size_t numLoaded = 0;
+    auto legacyLoadNs = measure(1, [&]
+    {
+        std::ifstream ifile(legacyPath, std::ios::binary);
+        std::size_t generation = 0;
+        ifile >> generation;
+        neat::InnovationHistory h;
+        h.loadState(ifile);
+        neat::Population p(cfg);
+        p.loadState(ifile, h, numInputs, numOutputs);
+        numLoaded = p.size();
+    });
+    std::cout << "\n";
+
+    std::size_t numMapped = 0;
+    auto snapshotLoadNs = measure(1, [&]
+    {
+        neat::PopulationSnapshot snapshot(snapshotPath);
+        std::vector<std::pair<neat::NodeId, neat::NodeId>> innovations;
+        for(auto& i : snapshot.getInnovations())
+        {
+            innovations.emplace_back(i.from, i.to);
+        }
+        neat::InnovationHistory h;
+        h.assign(std::move(innovations));
+        neat::Population p(cfg);
+        p.loadState(snapshot, h);
+        numMapped = p.size();
+    });
+
+    //Only maps the file and walks the genes, as a tool inspecting a save would
+    std::size_t numGenes = 0;
+    auto snapshotViewNs = measure(1, [&]
+    {
+        neat::PopulationSnapshot snapshot(snapshotPath);
+        for(auto& s : snapshot.getSpecies())
+        {
+            for(auto& p : snapshot.getPops(s))
+            {
+                numGenes += snapshot.getGenes(p).size();
+            }
+        }
+    });
+
+    std::cout << population.size() << " pops, " << history.size() << " innovations, " << numGenes << " genes\n";
+    std::cout << std::setw(10) << "format" << std::setw(14) << "save, ms" << std::setw(14) << "load, ms" << std::setw(14) << "bytes" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(10) << "stream" << std::setw(14) << legacySaveNs / 1e6 << std::setw(14) << legacyLoadNs / 1e6 << std::setw(14) << std::filesystem::file_size(legacyPath) << "\n";
+    std::cout << std::setw(10) << "snapshot" << std::setw(14) << snapshotSaveNs / 1e6 << std::setw(14) << snapshotLoadNs / 1e6 << std::setw(14) << std::filesystem::file_size(snapshotPath) << "\n";
+    std::cout << std::setw(10) << "view" << std::setw(14) << "" << std::setw(14) << snapshotViewNs / 1e6 << "\n";
+    if(numLoaded != population.size() || numMapped != population.size())
+    {
+        std::cout << "MISMATCH\n";
+    }
+}
+
+}
@@ -0,0 +1,129 @@
+#include "benchmarks.hpp"
+#include "neat/population.hpp"
+#include "gacommon/rng.hpp"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+namespace bench
+{
+
+namespace
+{
+
+//Speciation as it was before the sketch pre-filter and the parallel pass
+void respeciateReference(std::vector<neat::Specie>& species, const std::vector<neat::v2::Genom>& genoms, const double compatibilityFactor)
+{
+    for(auto& s : species)
+    {
+        s.population.clear();
+    }
+
+    for(auto& g : genoms)
+    {
+        std::size_t best = species.size();
+        double bestDistance = compatibilityFactor;
+        for(std::size_t i = 0; i < species.size(); ++i)
+        {
+            auto distance = neat::v2::Genom::calculateDivergence(g, species[i].representor->genotype, 1.0, 0.0);
+            if(distance < bestDistance)
+            {
+                best = i;
+                bestDistance = distance;
+            }
+        }
+
+        if(best == species.size())
+        {
+            neat::Specie s;
+            s.id = species.back().id + 1;
+            s.representor = neat::Pop{0, g};
+            s.population.push_back({0, g});
+            species.push_back(s);
+        }
+        else
+        {
+            species[best].population.push_back({0, g});
+        }
+    }
+
+    species.erase(std::remove_if(species.begin(), species.end(), [](auto& x){return x.population.empty();}), species.end());
+}
+
+bool isSameSpeciation(const std::vector<neat::Specie>& a, const std::vector<neat::Specie>& b)
+{
+    if(a.size() != b.size())
+    {
+        return false;
+    }
+
+    for(std::size_t i = 0; i < a.size(); ++i)
+    {
+        if(a[i].id != b[i].id || a[i].population.size() != b[i].population.size())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+void runSpeciationBench()
+{
+    Rng::seed(1);
+
+    const std::size_t numFounders = 60;
+    const std::size_t numGenoms = 1000;
+    const double compatibilityFactor = 12.0;
+
+    neat::v2::MutationConfig cfg;
+    cfg.addConnectionMutationChance = 1.0;
+    cfg.addNodeMutationChance = 0.5;
+
+    neat::InnovationHistory history;
+    std::vector<neat::Specie> species;
+    for(std::size_t i = 0; i < numFounders; ++i)
+    {
+        auto g = neat::v2::Genom::createMinimal(8, 4, history, true);
+        for(int j = 0; j < 30; ++j)
+        {
+            g.mutate(cfg, history);
+        }
+
+        neat::Specie s;
+        s.id = i;
+        s.representor = neat::Pop{0, g};
+        species.push_back(s);
+    }
+
+    std::vector<neat::v2::Genom> genoms;
+    for(std::size_t i = 0; i < numGenoms; ++i)
+    {
+        auto g = species[i % numFounders].representor->genotype;
+        for(int j = 0; j < 3; ++j)
+        {
+            g.mutate(cfg, history);
+        }
+        genoms.push_back(g);
+    }
+
+    gacommon::ThreadPool pool(std::thread::hardware_concurrency());
+    std::vector<neat::Specie> reference;
+    std::vector<neat::Specie> sequential;
+    std::vector<neat::Specie> parallel;
+
+    auto referenceNs = measure(20, [&]{reference = species; respeciateReference(reference, genoms, compatibilityFactor);});
+    auto sequentialNs = measure(20, [&]{sequential = species; neat::Speciation::respeciate(sequential, genoms, compatibilityFactor, 1.0, 0.0);});
+    auto parallelNs = measure(20, [&]{parallel = species; neat::Speciation::respeciate(parallel, genoms, compatibilityFactor, 1.0, 0.0, &pool);});
+
+    std::cout << numGenoms << " genoms, " << reference.size() << " species, " << pool.getNumThreads() << " threads\n";
+    std::cout << std::fixed << std::setprecision(0)
+              << std::setw(16) << "reference, us" << std::setw(16) << "prefilter, us" << std::setw(16) << "parallel, us" << "\n"
+              << std::setw(16) << referenceNs / 1000 << std::setw(16) << sequentialNs / 1000 << std::setw(16) << parallelNs / 1000
+              << std::setprecision(2) << std::setw(9) << referenceNs / parallelNs << "x"
+              << (isSameSpeciation(reference, sequential) && isSameSpeciation(reference, parallel) ? "" : "  MISMATCH") << "\n";
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+namespace bench
+{
+
+//Average nanoseconds per call of f over numIterations
+template<class F>
+double measure(const std::size_t numIterations, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < numIterations; ++i)
+    {
+        f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / numIterations;
+}
+
+void runAnnBench();
+void runSpeciationBench();
+void runRenderBench();
+void runPopFormatBench();
+void runSnapshotBench();
+void runFitnessCacheBench();
+
+}
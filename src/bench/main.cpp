@@ -0,0 +1,38 @@
+#include "benchmarks.hpp"
+#include <iostream>
+#include <functional>
+#include <map>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    const std::map<std::string, std::function<void()>> benchmarks = {
+        {"ann", bench::runAnnBench},
+        {"speciation", bench::runSpeciationBench},
+        {"render", bench::runRenderBench},
+        {"popformat", bench::runPopFormatBench},
+        {"snapshot", bench::runSnapshotBench},
+        {"fitnesscache", bench::runFitnessCacheBench},
+    };
+
+    if (argc != 2 || (benchmarks.count(argv[1]) == 0 && std::string(argv[1]) != "all")) {
+        std::cerr << "Usage: " << argv[0] << " <all";
+        for(auto& b : benchmarks)
+        {
+            std::cerr << "|" << b.first;
+        }
+        std::cerr << ">\n";
+        return EXIT_FAILURE;
+    }
+
+    for(auto& b : benchmarks)
+    {
+        if(b.first == argv[1] || std::string(argv[1]) == "all")
+        {
+            std::cout << "== " << b.first << "\n";
+            b.second();
+        }
+    }
+
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include "drawing.hpp"
 #include "gacommon/rng.hpp"
 #include <boost/gil/algorithm.hpp>
+#include <algorithm>
+#include <cmath>
 
 namespace dng
 {
@@ -44,38 +46,134 @@ Color genBgColor()
     return Color(Rng::gen32() % 127, Rng::gen32() % 127, Rng::gen32() % 127);
 }
 
-std::vector<bgpoint_t> points_within_polygon(const polygon_t& poly)
+namespace
 {
-    std::vector<bgpoint_t> points;
-    boost::geometry::model::box<bgpoint_t> b;
-    boost::geometry::envelope(poly, b);
-    auto min_corner = b.min_corner();
-    auto max_corner = b.max_corner();
-    for (double x = min_corner.get<0>(); x <= max_corner.get<0>(); ++x) {
-        for (double y = min_corner.get<1>(); y <= max_corner.get<1>(); ++y) {
-            bgpoint_t p(x, y);
-            if (boost::geometry::within(p, poly)) {
-                points.push_back(p);
-            }
-        }
-    }
-    return points;
+
+struct Edge
+{
+    double yLow;
+    double yHigh;
+    double xAtLow;
+    double dxdy;
+};
+
+bool within(const polygon_t& poly, const int x, const int y)
+{
+    return boost::geometry::within(bgpoint_t(x, y), poly);
+}
+
 }
 
+//Scanline fill of the integer points strictly inside the polygon, same set as boost::geometry::within gives.
+//Span ends are only approximated by the edge crossings, so they are settled with within itself.
 void fillPolygon(Image& target, const polygon_t& poly, const Color color)
 {
-    auto points = points_within_polygon(poly);
+    const auto& ring = poly.outer();
+    if(ring.size() < 3)
+    {
+        return;
+    }
+
+    thread_local std::vector<Edge> edges;
+    thread_local std::vector<double> vertexRows;
+    thread_local std::vector<double> crossings;
+    thread_local std::vector<Edge> active;
+    edges.clear();
+    active.clear();
+    vertexRows.clear();
+
+    double minX = ring[0].get<0>();
+    double maxX = minX;
+    double minY = ring[0].get<1>();
+    double maxY = minY;
+    for(std::size_t i = 0; i < ring.size(); ++i)
+    {
+        const auto& a = ring[i];
+        const auto& b = ring[(i + 1) % ring.size()];
+        minX = std::min(minX, a.get<0>());
+        maxX = std::max(maxX, a.get<0>());
+        minY = std::min(minY, a.get<1>());
+        maxY = std::max(maxY, a.get<1>());
+
+        if(a.get<1>() == std::floor(a.get<1>()))
+        {
+            vertexRows.push_back(a.get<1>());
+        }
+        if(a.get<1>() == b.get<1>())
+        {
+            continue;
+        }
+
+        const auto& low = a.get<1>() < b.get<1>() ? a : b;
+        const auto& high = a.get<1>() < b.get<1>() ? b : a;
+        edges.push_back({low.get<1>(), high.get<1>(), low.get<0>(), (high.get<0>() - low.get<0>()) / (high.get<1>() - low.get<1>())});
+    }
+    std::sort(edges.begin(), edges.end(), [](auto& x, auto& y){return x.yLow < y.yLow;});
+    std::sort(vertexRows.begin(), vertexRows.end());
+
     auto v = boost::gil::view(target);
-    for(auto p : points)
+    const int firstRow = std::max(0, static_cast<int>(std::ceil(minY)));
+    const int lastRow = std::min(static_cast<int>(v.height()) - 1, static_cast<int>(std::floor(maxY)));
+    const int firstCol = std::max(0, static_cast<int>(std::ceil(minX)));
+    const int lastCol = std::min(static_cast<int>(v.width()) - 1, static_cast<int>(std::floor(maxX)));
+
+    std::size_t nextEdge = 0;
+    for(int y = firstRow; y <= lastRow; ++y)
     {
-        auto x = p.get<0>();
-        auto y = p.get<1>();
-        if(x < 0 || x >= v.width() || y < 0 || y >= v.height())
+        while(nextEdge != edges.size() && edges[nextEdge].yLow <= y)
+        {
+            active.push_back(edges[nextEdge++]);
+        }
+        std::erase_if(active, [y](auto& e){return e.yHigh <= y;});
+
+        auto row = v.row_begin(y);
+        //Rows through a vertex may run along an edge, where nothing is within
+        if(std::binary_search(vertexRows.begin(), vertexRows.end(), static_cast<double>(y)))
         {
-            std::cout << "Trying to draw wrong pixel: " << x << " " << y << std::endl;
+            for(int x = firstCol; x <= lastCol; ++x)
+            {
+                if(within(poly, x, y))
+                {
+                    row[x] = color;
+                }
+            }
             continue;
         }
-        v(x, y) = color;
+
+        crossings.clear();
+        for(auto& e : active)
+        {
+            crossings.push_back(e.xAtLow + (y - e.yLow) * e.dxdy);
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        for(std::size_t i = 0; i + 1 < crossings.size(); i += 2)
+        {
+            int begin = std::max(firstCol, static_cast<int>(std::floor(crossings[i])) + 1);
+            int end = std::min(lastCol, static_cast<int>(std::ceil(crossings[i + 1])) - 1);
+
+            while(begin > firstCol && within(poly, begin - 1, y))
+            {
+                begin--;
+            }
+            while(begin <= end && !within(poly, begin, y))
+            {
+                begin++;
+            }
+            while(end < lastCol && within(poly, end + 1, y))
+            {
+                end++;
+            }
+            while(end >= begin && !within(poly, end, y))
+            {
+                end--;
+            }
+
+            if(begin <= end)
+            {
+                std::fill(row + begin, row + end + 1, color);
+            }
+        }
     }
 }
 
@@ -11,6 +11,11 @@ namespace bg = boost::geometry;
 using bgpoint_t = bg::model::point<double, 2, bg::cs::cartesian>;
 using polygon_t = bg::model::polygon<bgpoint_t>;
 
+//Outlines of the polygon shapes, a shape contains the points strictly inside its outline
+polygon_t makeHexPolygon(const Point& pt, const Size& sz);
+polygon_t makeTrianglePolygon(const Point& pt, const Size& sz);
+polygon_t makeCirclePolygon(const Point& pt, const Size& sz);
+
 void fillRect(Image& target, const Point& pos, const Size& sz, const Color color);
 void fillPolygon(Image& target, const polygon_t& poly, const Color color);
 void fill(Image& target, const Color color);
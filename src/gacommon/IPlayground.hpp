@@ -1,8 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 #include <variant>
+#include <stdexcept>
 
 namespace gacommon
 {
@@ -42,11 +47,165 @@ struct BitmapIO
 
 using IOElement = std::variant<ValueIO, ChoiceIO, BitmapIO>;
 
+//IO elements flattened into one buffer of doubles in the order they are defined. Value takes one slot, Choice one per option,
+//one hot in the inputs and scores in the outputs, and Bitmap one per cell. It is the layout neural networks read and write.
+//Built once per IO definition, so evaluators can fill reused buffers in place instead of constructing elements per challenge
+class IOSchema
+{
+public:
+   IOSchema(const std::vector<IOElement>& inputs, const std::vector<IOElement>& outputs)
+   : mInputs(inputs)
+   , mOutputs(outputs)
+   , mInputOffsets(computeOffsets(inputs))
+   , mOutputOffsets(computeOffsets(outputs))
+   , mDefaultOutputs(mOutputOffsets.back())
+   {
+      toFlat(mOutputs, mDefaultOutputs.data());
+   }
+
+   //Doubles in one flat set
+   std::size_t getNumInputs() const {return mInputOffsets.back();}
+   std::size_t getNumOutputs() const {return mOutputOffsets.back();}
+
+   const std::vector<IOElement>& getInputs() const {return mInputs;}
+   const std::vector<IOElement>& getOutputs() const {return mOutputs;}
+   //Outputs as the definition has them, for agents that do not write all of them
+   std::span<const double> getDefaultOutputs() const {return mDefaultOutputs;}
+
+   void setValue(double* inputs, const std::size_t idx, const double value) const
+   {
+      inputs[mInputOffsets[idx]] = value;
+   }
+
+   void setChoice(double* inputs, const std::size_t idx, const std::size_t selection) const
+   {
+      std::fill(inputs + mInputOffsets[idx], inputs + mInputOffsets[idx + 1], 0.0);
+      inputs[mInputOffsets[idx] + selection] = 1.0;
+   }
+
+   double getValue(const double* outputs, const std::size_t idx) const
+   {
+      return outputs[mOutputOffsets[idx]];
+   }
+
+   std::size_t getChoice(const double* outputs, const std::size_t idx) const
+   {
+      auto begin = outputs + mOutputOffsets[idx];
+      return std::max_element(begin, outputs + mOutputOffsets[idx + 1]) - begin;
+   }
+
+   //Conversions between elements and a flat set, in either direction
+   static void toFlat(const std::vector<IOElement>& elements, double* flat)
+   {
+      for(auto& e : elements)
+      {
+         if(auto v = std::get_if<ValueIO>(&e))
+         {
+            *flat++ = v->value;
+         }
+         else if(auto c = std::get_if<ChoiceIO>(&e))
+         {
+            std::fill(flat, flat + c->options, 0.0);
+            flat[c->selection] = 1.0;
+            flat += c->options;
+         }
+         else
+         {
+            flat = std::copy(std::get<BitmapIO>(e).map.begin(), std::get<BitmapIO>(e).map.end(), flat);
+         }
+      }
+   }
+
+   static void fromFlat(const double* flat, std::vector<IOElement>& elements)
+   {
+      for(auto& e : elements)
+      {
+         if(auto v = std::get_if<ValueIO>(&e))
+         {
+            v->value = *flat++;
+         }
+         else if(auto c = std::get_if<ChoiceIO>(&e))
+         {
+            c->selection = std::max_element(flat, flat + c->options) - flat;
+            flat += c->options;
+         }
+         else
+         {
+            for(auto& b : std::get<BitmapIO>(e).map)
+            {
+               b = static_cast<std::uint8_t>(*flat++);
+            }
+         }
+      }
+   }
+
+private:
+   static std::vector<std::size_t> computeOffsets(const std::vector<IOElement>& elements)
+   {
+      std::vector<std::size_t> result(1, 0);
+      for(auto& e : elements)
+      {
+         if(std::holds_alternative<ValueIO>(e))
+         {
+            result.push_back(result.back() + 1);
+         }
+         else if(auto c = std::get_if<ChoiceIO>(&e))
+         {
+            result.push_back(result.back() + c->options);
+         }
+         else
+         {
+            result.push_back(result.back() + std::get<BitmapIO>(e).map.size());
+         }
+      }
+
+      return result;
+   }
+
+   std::vector<IOElement> mInputs;
+   std::vector<IOElement> mOutputs;
+   //One past the last is the size of a flat set
+   std::vector<std::size_t> mInputOffsets;
+   std::vector<std::size_t> mOutputOffsets;
+   std::vector<double> mDefaultOutputs;
+};
+
 class IAgent
 {
 public:
    virtual void reset() = 0;
    virtual void run(const std::vector<IOElement>& inputs, std::vector<IOElement>& output) = 0;
+   //Runs every input set from a reset state, outputs must be prefilled with the expected layout
+   virtual void runBatch(const std::vector<std::vector<IOElement>>& inputs, std::vector<std::vector<IOElement>>& outputs)
+   {
+      for(std::size_t i = 0; i < inputs.size(); ++i)
+      {
+         reset();
+         run(inputs[i], outputs[i]);
+      }
+   }
+   //Same on numSamples consecutive flat sets laid out by schema. Agents working on elements get them converted here,
+   //every sample starts from the default outputs
+   virtual void runFlat(const IOSchema& schema, std::span<const double> inputs, std::span<double> outputs, const std::size_t numSamples)
+   {
+      if(inputs.size() != numSamples * schema.getNumInputs() || outputs.size() != numSamples * schema.getNumOutputs())
+      {
+         throw std::runtime_error("Flat IO size does not match the schema");
+      }
+
+      auto sampleInputs = schema.getInputs();
+      auto sampleOutputs = schema.getOutputs();
+      for(std::size_t i = 0; i < numSamples; ++i)
+      {
+         IOSchema::fromFlat(inputs.data() + i * schema.getNumInputs(), sampleInputs);
+         IOSchema::fromFlat(schema.getDefaultOutputs().data(), sampleOutputs);
+
+         reset();
+         run(sampleInputs, sampleOutputs);
+
+         IOSchema::toFlat(sampleOutputs, outputs.data() + i * schema.getNumOutputs());
+      }
+   }
    virtual void toBinaryStream(std::ofstream& stream) const = 0;
    virtual ~IAgent(){}
 };
@@ -56,6 +215,24 @@ class IFitnessEvaluator
 public:
     virtual Fitness evaluate(IAgent& agent) = 0;
 
+    //Evaluators built of independent challenges with non-negative scores can score a part of them,
+    //fitness is then the sum over [first, last). Scoring a part draws no random numbers, so it can be
+    //deferred without changing a run. Zero challenges means they can not.
+    virtual std::size_t getNumChallenges() const {return 0;}
+    virtual Fitness evaluateChallenges(IAgent& agent, const std::size_t first, const std::size_t last)
+    {
+       throw std::logic_error("Evaluator can not score a part of its challenges");
+    }
+    //Best possible sum over [first, last)
+    virtual Fitness getMaxChallengesScore(const std::size_t first, const std::size_t last) const
+    {
+       throw std::logic_error("Evaluator can not score a part of its challenges");
+    }
+
+    //Evaluators whose fitness only depends on the agent and the challenges return an id of the challenge set,
+    //which changes whenever the challenges do. Fitness is then cached per genome. Empty means it can not be
+    virtual std::optional<std::uint64_t> getChallengeSetId() const {return std::nullopt;}
+
     virtual ~IFitnessEvaluator(){}
 };
 
@@ -1,4 +1,6 @@
 #include "activation.hpp"
+#include <cstdint>
+#include <cstring>
 
 double sigmoid (const double val)
 {
@@ -113,4 +115,204 @@ ActivationFunction getPtr(const ActivationFunctionType type)
     }
 
     throw -1;
-}
\ No newline at end of file
+}
+
+//Float kernels work on 8 lanes with GCC vector extensions. On x86 they are built for AVX2 only, so no
+//8 lane vector crosses a function boundary without AVX, and CPUs without it take the scalar functions
+#if defined(__x86_64__) && defined(__linux__)
+#define ACTIVATION_AVX2_ONLY 1
+#define ACTIVATION_TARGET __attribute__((target("avx2")))
+#else
+#define ACTIVATION_AVX2_ONLY 0
+#define ACTIVATION_TARGET
+#endif
+
+#define ACTIVATION_INLINE ACTIVATION_TARGET __attribute__((always_inline)) inline
+
+namespace
+{
+
+using Vec8f = float __attribute__((vector_size(32)));
+using Vec8i = std::int32_t __attribute__((vector_size(32)));
+
+ACTIVATION_INLINE Vec8f splat(const float val)
+{
+    return Vec8f{} + val;
+}
+
+ACTIVATION_INLINE Vec8f vmin(const Vec8f a, const Vec8f b)
+{
+    return a < b ? a : b;
+}
+
+ACTIVATION_INLINE Vec8f vmax(const Vec8f a, const Vec8f b)
+{
+    return a > b ? a : b;
+}
+
+//Cephes style expf: 2^n * P(r) with |r| <= ln2/2
+ACTIVATION_INLINE Vec8f vexp(Vec8f x)
+{
+    x = vmin(vmax(x, splat(-87.0f)), splat(88.0f));
+
+    const Vec8f t = x * 1.44269504088896341f;
+    const Vec8i n = __builtin_convertvector(t + (t >= 0 ? splat(0.5f) : splat(-0.5f)), Vec8i);
+    const Vec8f fn = __builtin_convertvector(n, Vec8f);
+
+    Vec8f r = x - fn * 0.693359375f;
+    r = r + fn * 2.12194440e-4f;
+
+    Vec8f p = splat(1.9875691500e-4f);
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.0f;
+
+    return p * __builtin_bit_cast(Vec8f, (n + 127) << 23);
+}
+
+ACTIVATION_INLINE Vec8f vtanh(const Vec8f x)
+{
+    const Vec8f e = vexp(vmin(vmax(x, splat(-9.0f)), splat(9.0f)) * 2.0f);
+    return 1.0f - 2.0f / (e + 1.0f);
+}
+
+ACTIVATION_INLINE Vec8f sigmoid8(const Vec8f x)
+{
+    const Vec8f s = 1.0f / (1.0f + vexp(x * -5.0f));
+    return x > 1.5f ? splat(1.0f) : (x < -1.5f ? splat(0.0f) : s);
+}
+
+ACTIVATION_INLINE Vec8f tanh8(const Vec8f x)
+{
+    return vtanh(x);
+}
+
+ACTIVATION_INLINE Vec8f gauss8(const Vec8f x)
+{
+    return vexp(x * x * -5.0f);
+}
+
+ACTIVATION_INLINE Vec8f relu8(const Vec8f x)
+{
+    return vmax(x, splat(0.0f));
+}
+
+ACTIVATION_INLINE Vec8f elu8(const Vec8f x)
+{
+    return x > 0.0f ? x : vexp(x) - 1.0f;
+}
+
+ACTIVATION_INLINE Vec8f lelu8(const Vec8f x)
+{
+    return x > 0.0f ? x : x * 0.005f;
+}
+
+ACTIVATION_INLINE Vec8f selu8(const Vec8f x)
+{
+    const float lam = 1.0507009873554804934193349852946f;
+    const float alpha = 1.6732632423543772848170429916717f;
+
+    return x > 0.0f ? x * lam : (vexp(x) - 1.0f) * (lam * alpha);
+}
+
+ACTIVATION_INLINE Vec8f clamped8(const Vec8f x)
+{
+    return vmin(splat(1.0f), vmax(splat(-1.0f), x));
+}
+
+ACTIVATION_INLINE Vec8f exp8(const Vec8f x)
+{
+    return vexp(x);
+}
+
+ACTIVATION_INLINE Vec8f abs8(const Vec8f x)
+{
+    return x < 0.0f ? -x : x;
+}
+
+ACTIVATION_INLINE Vec8f square8(const Vec8f x)
+{
+    return x * x;
+}
+
+ACTIVATION_INLINE Vec8f cube8(const Vec8f x)
+{
+    return x * x * x;
+}
+
+ACTIVATION_INLINE Vec8f gelu8(const Vec8f x)
+{
+    return x * 0.5f * (1.0f + vtanh((x + x * x * x * 0.044715f) * 0.797884560802865355f));
+}
+
+template<Vec8f (*Kernel)(Vec8f)>
+ACTIVATION_INLINE void applyKernel(float* values, const std::size_t count)
+{
+    std::size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        Vec8f v;
+        std::memcpy(&v, values + i, sizeof(v));
+        v = Kernel(v);
+        std::memcpy(values + i, &v, sizeof(v));
+    }
+
+    if(i < count)
+    {
+        Vec8f v = {};
+        std::memcpy(&v, values + i, (count - i) * sizeof(float));
+        v = Kernel(v);
+        std::memcpy(values + i, &v, (count - i) * sizeof(float));
+    }
+}
+
+ACTIVATION_TARGET
+void activateSpanVector(const ActivationFunctionType type, float* values, const std::size_t count)
+{
+    switch(type)
+    {
+        case ActivationFunctionType::SIGMOID: return applyKernel<sigmoid8>(values, count);
+        case ActivationFunctionType::TANH: return applyKernel<tanh8>(values, count);
+        case ActivationFunctionType::GAUSS: return applyKernel<gauss8>(values, count);
+        case ActivationFunctionType::RELU: return applyKernel<relu8>(values, count);
+        case ActivationFunctionType::ELU: return applyKernel<elu8>(values, count);
+        case ActivationFunctionType::LELU: return applyKernel<lelu8>(values, count);
+        case ActivationFunctionType::SELU: return applyKernel<selu8>(values, count);
+        case ActivationFunctionType::IDENTITY: return;
+        case ActivationFunctionType::CLAMPED: return applyKernel<clamped8>(values, count);
+        case ActivationFunctionType::EXP: return applyKernel<exp8>(values, count);
+        case ActivationFunctionType::ABS: return applyKernel<abs8>(values, count);
+        case ActivationFunctionType::SQUARE: return applyKernel<square8>(values, count);
+        case ActivationFunctionType::CUBE: return applyKernel<cube8>(values, count);
+        case ActivationFunctionType::GELU: return applyKernel<gelu8>(values, count);
+        //No cheap vector form, still one call per span instead of per node
+        case ActivationFunctionType::SIN:
+            std::transform(values, values + count, values, [](float x){return std::sin(x);});
+            return;
+        case ActivationFunctionType::LOG:
+            std::transform(values, values + count, values, [](float x){return std::log(x);});
+            return;
+    }
+
+    throw -1;
+}
+
+}
+
+void activateSpan(const ActivationFunctionType type, float* values, const std::size_t count)
+{
+#if ACTIVATION_AVX2_ONLY
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if(!hasAvx2)
+    {
+        auto func = getPtr(type);
+        std::transform(values, values + count, values, [func](float x){return static_cast<float>(func(x));});
+        return;
+    }
+#endif
+
+    activateSpanVector(type, values, count);
+}
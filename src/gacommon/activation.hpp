@@ -2,6 +2,7 @@
 
 #include <cmath>
 #include <algorithm>
+#include <cstddef>
 
 enum class ActivationFunctionType
 {
@@ -49,4 +50,7 @@ double cube(const double val);
 
 double gelu(const double val);
 
-ActivationFunction getPtr(const ActivationFunctionType type);
\ No newline at end of file
+ActivationFunction getPtr(const ActivationFunctionType type);
+
+//Applies the activation of the given type in place to count values at once
+void activateSpan(const ActivationFunctionType type, float* values, const std::size_t count);
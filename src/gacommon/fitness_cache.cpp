@@ -0,0 +1,61 @@
+#include "fitness_cache.hpp"
+
+namespace gacommon
+{
+
+void FitnessCache::setChallengeSet(const std::optional<std::uint64_t> id)
+{
+   if(id != mChallengeSet)
+   {
+      clear();
+      mChallengeSet = id;
+   }
+}
+
+bool FitnessCache::isEnabled() const
+{
+   return mChallengeSet.has_value();
+}
+
+std::optional<Fitness> FitnessCache::find(const std::uint64_t hash)
+{
+   if(!isEnabled())
+   {
+      return std::nullopt;
+   }
+
+   if(auto iter = mCurrent.find(hash); iter != mCurrent.end())
+   {
+      return iter->second;
+   }
+   if(auto iter = mPrevious.find(hash); iter != mPrevious.end())
+   {
+      //Found entries live one more generation
+      mCurrent.emplace(hash, iter->second);
+      return iter->second;
+   }
+
+   return std::nullopt;
+}
+
+void FitnessCache::store(const std::uint64_t hash, const Fitness fitness)
+{
+   if(isEnabled())
+   {
+      mCurrent[hash] = fitness;
+   }
+}
+
+void FitnessCache::endGeneration()
+{
+   std::swap(mPrevious, mCurrent);
+   mCurrent.clear();
+}
+
+void FitnessCache::clear()
+{
+   mCurrent.clear();
+   mPrevious.clear();
+}
+
+}
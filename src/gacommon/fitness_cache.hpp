@@ -0,0 +1,50 @@
+#pragma once
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include "IPlayground.hpp"
+
+namespace gacommon
+{
+
+//Mixes value into seed, for building structural hashes of genomes
+inline std::uint64_t hashCombine(const std::uint64_t seed, const std::uint64_t value)
+{
+   //splitmix64 finalizer
+   std::uint64_t x = value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+   x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+   x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+   return seed ^ (x ^ (x >> 31));
+}
+
+//Genomes the fitness cache can be keyed by
+template<class T>
+concept StructurallyHashable = requires(const T& t)
+{
+   {t.getStructuralHash()} -> std::convertible_to<std::uint64_t>;
+};
+
+//Fitness of genomes already scored on the current challenge set, keyed by a structural hash of the genome.
+//Entries neither found nor stored during a generation are dropped at its end, so about two generations
+//are kept. Not thread safe, lookups and stores are done around the parallel evaluation.
+class FitnessCache
+{
+public:
+   //Drops everything when the id differs from the last one, an empty id disables the cache
+   void setChallengeSet(const std::optional<std::uint64_t> id);
+   bool isEnabled() const;
+
+   std::optional<Fitness> find(const std::uint64_t hash);
+   void store(const std::uint64_t hash, const Fitness fitness);
+
+   void endGeneration();
+   void clear();
+
+private:
+   std::optional<std::uint64_t> mChallengeSet;
+   std::unordered_map<std::uint64_t, Fitness> mCurrent;
+   std::unordered_map<std::uint64_t, Fitness> mPrevious;
+};
+
+}
@@ -4,9 +4,17 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ptree_fwd.hpp>
 #include <fstream>
+#include <functional>
 #include <algorithm>
-#include <thread>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <optional>
 #include "rng.hpp"
+#include "thread_pool.hpp"
+#include "timings.hpp"
+#include "fitness_cache.hpp"
+#include "racing.hpp"
 
 namespace gacommon
 {
@@ -24,6 +32,10 @@ struct Config
    double survivalRate;
 
    std::size_t numThreads;
+
+   //Share of the challenges every pop runs first, 0 disables racing. The rest is only run for the pops the
+   //next selection needs to tell apart, the others keep their partial fitness. Selection is the same as without racing
+   double racingFirstStage = 0;
 };
 
 template<class Pop>
@@ -49,12 +61,15 @@ public:
 
    void step()
    {
+       mTimings.beginGeneration();
        auto newGen = select();
        repopulate(newGen);
        evaluate();
+       mTimings.endGeneration(mGeneration, mCfg.numThreads == 1 ? nullptr : mPool.get());
        mGeneration++;
    }
 
+   //A selection already drawn is kept, the new config applies from the next one
    void reconfigure(const Config& cfg)
    {
        mCfg = cfg;
@@ -65,8 +80,17 @@ public:
        return mPopulation;
    }
 
+   //Finishes a race first, so every saved fitness is a full one
    void saveState(const std::string& fileName)
    {
+       if(mRace)
+       {
+           ensureKnown(mPopulation.size());
+           sortRaced();
+       }
+
+       auto scope = mTimings.measure(Phase::Checkpoint);
+
        boost::property_tree::ptree ar;
        ar.put("best_fitness", mBestFitness);
        ar.put("generation", mGeneration);
@@ -88,6 +112,8 @@ public:
    void loadState(const std::string& fileName)
    {
        mPopulation.clear();
+       mSelection.reset();
+       mRace.reset();
 
        boost::property_tree::ptree ar;
        boost::property_tree::read_json(fileName, ar);
@@ -105,9 +131,15 @@ public:
        return mGeneration;
    }
 
+   const Timings& getTimings() const
+   {
+       return mTimings;
+   }
+
 private:
    void repopulate(const std::vector<Pop>& selected)
    {
+       auto scope = mTimings.measure(Phase::Repopulate);
        mPopulation.clear();
 
        std::copy(selected.begin(), selected.end(), std::back_inserter(mPopulation));
@@ -147,19 +179,20 @@ private:
        }
    }
 
-   const Pop& selectTournament(const std::vector<Pop>& pops)
+   //Position of the winner in the sorted population
+   std::size_t drawTournament()
    {
         const int NUM_PARTICIPANTS = 8;
         const double PARTICIPANT_CHANCE = 0.5;
 
-        std::vector<std::pair<std::size_t, gacommon::Fitness>> indices;
-        for(int i = 0; i < NUM_PARTICIPANTS; ++i)
+        std::array<std::size_t, NUM_PARTICIPANTS> positions;
+        for(auto& pos : positions)
         {
-            auto pos = Rng::genChoise(pops.size());
-            indices.push_back({pos, pops[pos].fitness});
+            pos = Rng::genChoise(mPopulation.size());
         }
 
-        std::sort(indices.begin(), indices.end(), [](auto x, auto y){return x.second > y.second;});
+        //Lower positions are the fitter participants, ties in fitness are ordered the way the population is
+        std::sort(positions.begin(), positions.end());
 
         while(true)
         {
@@ -167,63 +200,266 @@ private:
             {
                 if(Rng::genProbability(PARTICIPANT_CHANCE))
                 {
-                    return pops[indices[i].first];
+                    ensureKnown(positions[i] + 1);
+                    return positions[i];
                 }
             }
         }
    }
 
    void evaluate()
+   {
+       {
+          auto scope = mTimings.measure(Phase::Evaluate);
+
+          std::vector<std::uint64_t> hashes;
+          auto pending = takeCachedFitness(hashes);
+
+          if(isRacing())
+          {
+               startRace(pending, std::move(hashes));
+          }
+          else
+          {
+               parallelFor(pending.size(), [&](const std::size_t i){
+                   auto agent = createAgent(mPopulation[pending[i]]);
+                   mPopulation[pending[i]].fitness = mFitnessEvaluator.evaluate(*agent);
+               });
+               mTimings.addEvaluations(pending.size());
+
+               if(mCache.isEnabled())
+               {
+                   for(auto popidx : pending)
+                   {
+                       mCache.store(hashes[popidx], mPopulation[popidx].fitness);
+                   }
+               }
+          }
+       }
+
+       //The next selection is drawn here, so a race only finishes the pops it draws
+       if(mRace)
+       {
+          ensureKnown(1);
+          mBestFitness = mRace->order.getFitness(mRace->order.at(0));
+          mSelection = drawSelection();
+
+          std::size_t numUnfinished = 0;
+          for(std::size_t i = 0; i < mRace->order.size(); ++i)
+          {
+              numUnfinished += mRace->order.isFinished(i) ? 0 : 1;
+          }
+          mTimings.addRacingWork(0, numUnfinished * (mRace->numChallenges - mRace->split));
+
+          auto scope = mTimings.measure(Phase::Sort);
+          sortRaced();
+       }
+       else
+       {
+          {
+             auto scope = mTimings.measure(Phase::Sort);
+             std::stable_sort(mPopulation.begin(), mPopulation.end(), [](auto& x, auto& y){return x.fitness > y.fitness;});
+          }
+          mBestFitness = mPopulation[0].fitness;
+          mSelection = drawSelection();
+       }
+       mCache.endGeneration();
+   }
+
+   bool isRacing() const
+   {
+       return mCfg.racingFirstStage > 0 && mFitnessEvaluator.getNumChallenges() > 0;
+   }
+
+   //Runs the first stage on the pending pops, cached pops are finished already
+   void startRace(const std::vector<std::size_t>& pending, std::vector<std::uint64_t> hashes)
+   {
+       const auto numChallenges = mFitnessEvaluator.getNumChallenges();
+       const auto split = std::min(numChallenges, static_cast<std::size_t>(std::ceil(numChallenges * mCfg.racingFirstStage)));
+
+       std::vector<std::unique_ptr<IAgent>> agents(mPopulation.size());
+       parallelFor(pending.size(), [&](const std::size_t i){
+           agents[pending[i]] = createAgent(mPopulation[pending[i]]);
+           mPopulation[pending[i]].fitness = mFitnessEvaluator.evaluateChallenges(*agents[pending[i]], 0, split);
+       });
+       mTimings.addEvaluations(pending.size());
+       mTimings.addRacingWork(pending.size() * split, 0);
+
+       const auto maxRest = mFitnessEvaluator.getMaxChallengesScore(split, numChallenges);
+       std::vector<Fitness> fitness(mPopulation.size());
+       std::vector<Fitness> upperBounds(mPopulation.size());
+       std::vector<bool> finished(mPopulation.size(), true);
+       for(std::size_t i = 0; i < mPopulation.size(); ++i)
+       {
+           fitness[i] = mPopulation[i].fitness;
+       }
+       for(auto popidx : pending)
+       {
+           upperBounds[popidx] = fitness[popidx] + maxRest;
+           finished[popidx] = split == numChallenges;
+           if(finished[popidx] && mCache.isEnabled())
+           {
+               mCache.store(hashes[popidx], fitness[popidx]);
+           }
+       }
+
+       std::vector<std::size_t> slots(mPopulation.size());
+       std::iota(slots.begin(), slots.end(), 0);
+       mRace.emplace(Race{
+           RacedOrder(std::move(fitness), std::move(upperBounds), std::move(finished)),
+           std::move(agents),
+           std::move(slots),
+           std::move(hashes),
+           split,
+           numChallenges
+           });
+   }
+
+   //Finishes unfinished pops until the first count positions of the sorted population are known
+   void ensureKnown(const std::size_t count)
+   {
+       if(!mRace)
+       {
+           return;
+       }
+
+       for(auto next = mRace->order.getNextToFinish(count); !next.empty(); next = mRace->order.getNextToFinish(count))
+       {
+           auto scope = mTimings.measure(Phase::Evaluate);
+           auto& race = *mRace;
+
+           std::vector<Fitness> rest(next.size());
+           parallelFor(next.size(), [&](const std::size_t i){
+               rest[i] = mFitnessEvaluator.evaluateChallenges(*race.agents[next[i]], race.split, race.numChallenges);
+           });
+           for(std::size_t i = 0; i < next.size(); ++i)
+           {
+               auto& pop = mPopulation[race.slots[next[i]]];
+               pop.fitness += rest[i];
+               race.order.finish(next[i], pop.fitness);
+               race.agents[next[i]].reset();
+               if(!race.hashes.empty())
+               {
+                   mCache.store(race.hashes[next[i]], pop.fitness);
+               }
+           }
+           mTimings.addRacingWork(next.size() * (race.numChallenges - race.split), 0);
+       }
+   }
+
+   //Puts the population in the raced order, the known positions hold the pops a full evaluation would put there
+   void sortRaced()
+   {
+       auto& race = *mRace;
+       auto order = race.order.getOrder();
+
+       std::vector<Pop> sorted;
+       sorted.reserve(mPopulation.size());
+       for(auto candidate : order)
+       {
+           sorted.push_back(std::move(mPopulation[race.slots[candidate]]));
+       }
+       for(std::size_t pos = 0; pos < order.size(); ++pos)
+       {
+           race.slots[order[pos]] = pos;
+       }
+
+       mPopulation = std::move(sorted);
+   }
+
+   void parallelFor(const std::size_t count, const std::function<void(std::size_t)>& func)
    {
        if(mCfg.numThreads == 1)
        {
-            for(auto& pop : mPopulation)
-            {
-                auto agent = pop.createAgent(mIo);
-                pop.fitness = mFitnessEvaluator.evaluate(*agent);
-            }
+           for(std::size_t i = 0; i < count; ++i)
+           {
+               func(i);
+           }
        }
        else
        {
-            std::vector<std::thread> threads;
-            for(std::size_t i = 0; i < mCfg.numThreads; ++i)
-            {
-                threads.push_back(std::thread([this, i](){
-                    for(std::size_t popidx = 0; popidx < mPopulation.size(); ++popidx)
-                    {
-                        if(popidx % mCfg.numThreads == i)
-                        {
-                            auto agent = mPopulation[popidx].createAgent(mIo);
-                            mPopulation[popidx].fitness = mFitnessEvaluator.evaluate(*agent);
-                        }
-                    }
-                }));
-            }
+           ensureThreadPool(mPool, mCfg.numThreads);
+           mPool->parallelFor(count, func);
+       }
+   }
 
-            for(auto& t : threads)
-            {
-                t.join();
-            }
+   //Pops found in the cache get their fitness, the indices of the others are returned.
+   //Hashes are filled for all pops when the cache is enabled
+   std::vector<std::size_t> takeCachedFitness(std::vector<std::uint64_t>& hashes)
+   {
+       std::vector<std::size_t> pending;
+       if constexpr(StructurallyHashable<Pop>)
+       {
+           mCache.setChallengeSet(mFitnessEvaluator.getChallengeSetId());
+           if(mCache.isEnabled())
+           {
+               hashes.resize(mPopulation.size());
+               for(std::size_t i = 0; i < mPopulation.size(); ++i)
+               {
+                   hashes[i] = mPopulation[i].getStructuralHash();
+                   if(auto fitness = mCache.find(hashes[i]))
+                   {
+                       mPopulation[i].fitness = *fitness;
+                   }
+                   else
+                   {
+                       pending.push_back(i);
+                   }
+               }
+               mTimings.addCacheLookups(mPopulation.size(), mPopulation.size() - pending.size());
+               return pending;
+           }
        }
 
-       std::sort(mPopulation.begin(), mPopulation.end(), [](auto x, auto y){return x.fitness > y.fitness;});
-       mBestFitness = mPopulation[0].fitness;
+       pending.resize(mPopulation.size());
+       std::iota(pending.begin(), pending.end(), 0);
+       return pending;
    }
 
-   std::vector<Pop> select()
+   auto createAgent(const Pop& pop)
+   {
+       auto scope = mTimings.measure(Phase::BuildAnn);
+       return pop.createAgent(mIo);
+   }
+
+   //Positions in the sorted population of the pops select keeps
+   std::vector<std::size_t> drawSelection()
    {
+       std::vector<std::size_t> result;
+
        //Keep champions, and *survivalRate* selected randomly, weighted by fitness. Never pick same guy
-       std::vector<Pop> result;
-       result.reserve(mCfg.populationSize);
 
        if(mBestFitness != 0)//Keep champions
        {
-          std::copy(mPopulation.begin(), mPopulation.begin() + mCfg.championsKept, std::back_inserter(result));
+          ensureKnown(mCfg.championsKept);
+          for(std::size_t i = 0; i < mCfg.championsKept; ++i)
+          {
+             result.push_back(i);
+          }
        }
 
        while(result.size() < mCfg.populationSize * mCfg.survivalRate)
        {
-          result.push_back(selectTournament(mPopulation));
+          result.push_back(drawTournament());
+       }
+
+       return result;
+   }
+
+   std::vector<Pop> select()
+   {
+       auto scope = mTimings.measure(Phase::Select);
+
+       //Drawn when the population was evaluated, unless it was loaded or not evaluated yet
+       auto positions = mSelection ? std::move(*mSelection) : drawSelection();
+       mSelection.reset();
+       mRace.reset();
+
+       std::vector<Pop> result;
+       result.reserve(mCfg.populationSize);
+       for(auto pos : positions)
+       {
+          result.push_back(mPopulation[pos]);
        }
 
        return result;
@@ -236,6 +472,23 @@ private:
 
    gacommon::Fitness mBestFitness;
    std::size_t mGeneration = 1;
+   std::unique_ptr<ThreadPool> mPool;
+   Timings mTimings;
+   FitnessCache mCache;
+
+   //Pops of an evaluation still racing. Candidates are the pops in the order they were evaluated in,
+   //slots are their positions in the population
+   struct Race
+   {
+      RacedOrder order;
+      std::vector<std::unique_ptr<IAgent>> agents;
+      std::vector<std::size_t> slots;
+      std::vector<std::uint64_t> hashes;
+      std::size_t split;
+      std::size_t numChallenges;
+   };
+   std::optional<Race> mRace;
+   std::optional<std::vector<std::size_t>> mSelection;
 };
 
 }
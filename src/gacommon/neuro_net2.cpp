@@ -1,8 +1,10 @@
 #include "neuro_net2.hpp"
+#include "neuro_net_f32.hpp"
 #include <cmath>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <numeric>
 #include "activation.hpp"
 #include "../logger/Logger.hpp"
 #include <boost/archive/binary_oarchive.hpp>
@@ -59,53 +61,366 @@ NeuroNet2::NeuroNet2(
       }
 
       dst.inputs.push_back({src.id, c.weight});
+   }
+
+   mCons = Matrix(mNodes, connections.size());
+
+   buildSchedule();
+}
+
+NeuroNet2::NeuroNet2(
+   const std::size_t numInputs,
+   const std::size_t numOutputs,
+   const std::vector<ActivationFunctionType>& hiddenTypes,
+   const std::vector<IndexedConnectionDef>& connections
+   )
+{
+   const std::size_t numNodes = numInputs + numOutputs + hiddenTypes.size();
+
+   mNodes.reserve(numNodes);
+   mValues.resize(numNodes, 0);
+   mInputNodes.reserve(numInputs);
+   mOutputNodes.reserve(numOutputs);
+   mHiddenNodes.reserve(hiddenTypes.size());
+
+   for(std::size_t i = 0; i < numInputs; ++i)
+   {
+      mNodes.push_back(Node{static_cast<NodeId>(mNodes.size()), 0.0, 0});
+      mInputNodes.push_back(&mNodes.back());
+   }
+
+   for(std::size_t i = 0; i < numOutputs; ++i)
+   {
+      mNodes.push_back(Node{static_cast<NodeId>(mNodes.size()), 0.0, -1});
+      mOutputNodes.push_back(&mNodes.back());
+   }
+
+   for(auto t : hiddenTypes)
+   {
+      mNodes.push_back(Node{static_cast<NodeId>(mNodes.size()), 0.0, -1, {}, getPtr(t), t});
+      mHiddenNodes.push_back(&mNodes.back());
+   }
+
+   //Counting sort by destination, each node keeps its connections in the given order
+   mCons.colInd.assign(numNodes + 1, 0);
+   mCons.rowInd.resize(connections.size());
+   mCons.weights.resize(connections.size());
 
-      if(src.id != dst.id && (src.depth <= dst.depth || dst.depth == -1))//Otherwise recursive - lets not adapt
+   for(auto& c : connections)
+   {
+      if(c.src >= numNodes || c.dst >= numNodes)
       {
-         int newDepth = src.depth + 1;
-         dst.depth = std::max(newDepth, dst.depth);
+         throw std::runtime_error("Connection refers to a missing node");
       }
-   }
 
-   mCons = Matrix(mNodes, connections.size());
+      if(c.dst < numInputs)
+      {
+         throw std::runtime_error("Connection leads into an input node");
+      }
+
+      mCons.colInd[c.dst + 1]++;
+   }
+   std::partial_sum(mCons.colInd.begin(), mCons.colInd.end(), mCons.colInd.begin());
 
-   std::sort(mHiddenNodes.begin(), mHiddenNodes.end(), [&](auto x, auto y)
+   std::vector<std::uint16_t> next(mCons.colInd.begin(), mCons.colInd.end() - 1);
+   for(auto& c : connections)
    {
-      return x->depth < y->depth;
-   });
+      auto pos = next[c.dst]++;
+      mCons.rowInd[pos] = c.src;
+      mCons.weights[pos] = c.weight;
+   }
+
+   buildSchedule();
 }
 
-void NeuroNet2::activate()
+void NeuroNet2::buildSchedule()
 {
-   //Walk over ordered hidden nodes
-   for(auto node : mHiddenNodes)
+   const std::size_t numNodes = mNodes.size();
+   const std::size_t numInputs = mInputNodes.size();
+
+   //Cycles are the strongly connected components with more than one node or a self loop. Tarjan over the
+   //input lists walks the reversed graph, which has the same components, and emits them sources first
+   const int none = -1;
+   std::vector<int> index(numNodes, none);
+   std::vector<int> low(numNodes, 0);
+   std::vector<int> component(numNodes, none);
+   std::vector<char> onStack(numNodes, 0);
+   std::vector<NodeId> stack;
+   std::vector<NodeId> byComponent;
+   std::vector<std::pair<NodeId, std::uint32_t>> walk;
+   int nextIndex = 0;
+   int numComponents = 0;
+
+   auto visit = [&](const NodeId v)
    {
-      double totalInput = 0;
+      index[v] = low[v] = nextIndex++;
+      stack.push_back(v);
+      onStack[v] = 1;
+      walk.push_back({v, mCons.colInd[v]});
+   };
+
+   for(NodeId root = numInputs; root < numNodes; ++root)
+   {
+      if(index[root] != none)
+      {
+         continue;
+      }
+
+      visit(root);
+      while(!walk.empty())
+      {
+         auto [v, pos] = walk.back();
+         if(pos < mCons.colInd[v + 1])
+         {
+            walk.back().second++;
+            auto w = mCons.rowInd[pos];
+            if(w < numInputs)
+            {
+               continue;
+            }
+            if(index[w] == none)
+            {
+               visit(w);
+            }
+            else if(onStack[w])
+            {
+               low[v] = std::min(low[v], index[w]);
+            }
+            continue;
+         }
+
+         walk.pop_back();
+         if(!walk.empty())
+         {
+            auto parent = walk.back().first;
+            low[parent] = std::min(low[parent], low[v]);
+         }
+
+         if(low[v] == index[v])
+         {
+            NodeId w;
+            do
+            {
+               w = stack.back();
+               stack.pop_back();
+               onStack[w] = 0;
+               component[w] = numComponents;
+               byComponent.push_back(w);
+            }
+            while(w != v);
+            numComponents++;
+         }
+      }
+   }
 
-      auto a = mCons.colInd[node->id];
-      auto b = mCons.colInd[node->id + 1];
-      for(std::uint16_t i = a; i < b; ++i)
+   //A component is one level past the deepest component it reads from
+   for(auto n : mInputNodes)
+   {
+      n->depth = 0;
+   }
+   for(std::size_t first = 0; first < byComponent.size();)
+   {
+      const int c = component[byComponent[first]];
+      std::size_t last = first;
+      int depth = 1;
+      for(; last < byComponent.size() && component[byComponent[last]] == c; ++last)
       {
-         totalInput += mValues[mCons.rowInd[i]] * mCons.weights[i];
+         auto v = byComponent[last];
+         for(std::uint16_t i = mCons.colInd[v]; i < mCons.colInd[v + 1]; ++i)
+         {
+            auto src = mCons.rowInd[i];
+            if(component[src] != c)
+            {
+               depth = std::max(depth, mNodes[src].depth + 1);
+            }
+         }
       }
+      for(std::size_t i = first; i < last; ++i)
+      {
+         mNodes[byComponent[i]].depth = depth;
+      }
+      first = last;
+   }
+
+   auto byDepth = [](auto x, auto y)
+   {
+      return x->depth < y->depth || (x->depth == y->depth && x->id < y->id);
+   };
+   std::sort(mHiddenNodes.begin(), mHiddenNodes.end(), byDepth);
+
+   std::vector<Node*> order(mOutputNodes.begin(), mOutputNodes.end());
+   order.insert(order.end(), mHiddenNodes.begin(), mHiddenNodes.end());
+   std::sort(order.begin(), order.end(), byDepth);
 
-      mValues[node->id] = node->func(totalInput);
+   //Outputs are linear
+   std::vector<char> isOutput(numNodes, 0);
+   for(auto n : mOutputNodes)
+   {
+      isOutput[n->id] = 1;
+   }
+
+   //Connections are packed in evaluation order, reads of the current tick first
+   mSchedule.clear();
+   mSrc.clear();
+   mWeights.clear();
+   mSchedule.reserve(order.size());
+   mSrc.reserve(mCons.rowInd.size());
+   mWeights.reserve(mCons.weights.size());
+   mRecurrent = false;
+   for(auto node : order)
+   {
+      Step step{node->id, isOutput[node->id] ? &identity : node->func, static_cast<std::uint32_t>(mSrc.size()), 0, 0};
+      for(int previous = 0; previous < 2; ++previous)
+      {
+         if(previous)
+         {
+            step.split = static_cast<std::uint32_t>(mSrc.size());
+         }
+         for(std::uint16_t i = mCons.colInd[node->id]; i < mCons.colInd[node->id + 1]; ++i)
+         {
+            auto src = mCons.rowInd[i];
+            if((component[src] == component[node->id]) == static_cast<bool>(previous))
+            {
+               mSrc.push_back(src);
+               mWeights.push_back(mCons.weights[i]);
+            }
+         }
+      }
+      step.end = static_cast<std::uint32_t>(mSrc.size());
+      mRecurrent = mRecurrent || step.split != step.end;
+      mSchedule.push_back(step);
    }
 
-   //Walk over ordered output nodes
-   for(auto node : mOutputNodes)
-   {      
+   mValues.resize(numNodes, 0);
+   mPrevious.assign(numNodes, 0);
+}
+
+template<bool Recurrent>
+void NeuroNet2::tick()
+{
+   for(auto& step : mSchedule)
+   {
       double totalInput = 0;
 
-      for(std::uint16_t i = mCons.colInd[node->id]; i < mCons.colInd[node->id + 1]; ++i)
+      for(std::uint32_t i = step.begin; i < step.split; ++i)
       {
-         totalInput += mValues[mCons.rowInd[i]] * mCons.weights[i];
+         totalInput += mValues[mSrc[i]] * mWeights[i];
+      }
+      if constexpr(Recurrent)
+      {
+         for(std::uint32_t i = step.split; i < step.end; ++i)
+         {
+            totalInput += mPrevious[mSrc[i]] * mWeights[i];
+         }
       }
 
-      mValues[node->id] = totalInput;
+      mValues[step.id] = step.func(totalInput);
    }
+}
+
+void NeuroNet2::activate()
+{
+   if(!mRecurrent)
+   {
+      tick<false>();
+      return;
+   }
+
+   for(std::size_t t = 0; t < mNumTicks; ++t)
+   {
+      std::copy(mValues.begin(), mValues.end(), mPrevious.begin());
+      tick<true>();
+   }
+}
+
+void NeuroNet2::setNumTicks(const std::size_t numTicks)
+{
+   if(numTicks == 0)
+   {
+      throw std::runtime_error("Net needs at least one tick");
+   }
+
+   mNumTicks = numTicks;
+}
+
+bool NeuroNet2::isRecurrent() const
+{
+   return mRecurrent;
 }  
 
+void NeuroNet2::activateBatch(std::span<const double> inputs, std::span<double> outputs, const std::size_t numSamples)
+{
+   const std::size_t numInputs = mInputNodes.size();
+   const std::size_t numOutputs = mOutputNodes.size();
+
+   if(inputs.size() != numSamples * numInputs)
+   {
+      throw std::runtime_error("Batch input size does not match the network");
+   }
+   if(outputs.size() != numSamples * numOutputs)
+   {
+      throw std::runtime_error("Batch output size does not match the network");
+   }
+
+   mBatchValues.assign(mNodes.size() * numSamples, 0.0);
+   mBatchPrevious.assign(mRecurrent ? mBatchValues.size() : 0, 0.0);
+   mBatchSums.resize(numSamples);
+
+   for(std::size_t s = 0; s < numSamples; ++s)
+   {
+      for(std::size_t i = 0; i < numInputs; ++i)
+      {
+         mBatchValues[i * numSamples + s] = inputs[s * numInputs + i];
+      }
+   }
+
+   //Every connection is a contiguous multiply-add over the whole batch
+   auto sumInputs = [&](const std::vector<double>& values, const std::uint32_t begin, const std::uint32_t end)
+   {
+      double* sums = mBatchSums.data();
+      for(std::uint32_t i = begin; i < end; ++i)
+      {
+         const double* src = values.data() + mSrc[i] * numSamples;
+         const double w = mWeights[i];
+         for(std::size_t s = 0; s < numSamples; ++s)
+         {
+            sums[s] += src[s] * w;
+         }
+      }
+   };
+
+   const std::size_t numTicks = mRecurrent ? mNumTicks : 1;
+   for(std::size_t t = 0; t < numTicks; ++t)
+   {
+      if(mRecurrent)
+      {
+         std::copy(mBatchValues.begin(), mBatchValues.end(), mBatchPrevious.begin());
+      }
+
+      for(auto& step : mSchedule)
+      {
+         std::fill(mBatchSums.begin(), mBatchSums.end(), 0.0);
+         sumInputs(mBatchValues, step.begin, step.split);
+         sumInputs(mBatchPrevious, step.split, step.end);
+
+         double* dst = mBatchValues.data() + step.id * numSamples;
+         for(std::size_t s = 0; s < numSamples; ++s)
+         {
+            dst[s] = step.func(mBatchSums[s]);
+         }
+      }
+   }
+
+   for(std::size_t o = 0; o < numOutputs; ++o)
+   {
+      const double* src = mBatchValues.data() + mOutputNodes[o]->id * numSamples;
+      for(std::size_t s = 0; s < numSamples; ++s)
+      {
+         outputs[s * numOutputs + o] = src[s];
+      }
+   }
+}
+
 NeuroNet2::NodeIterator NeuroNet2::begin_input()
 {
    return mValues.begin();
@@ -149,11 +464,11 @@ NetworkTopology NeuroNet2::createTopology() const
    {
       if(std::find_if(mOutputNodes.begin(), mOutputNodes.end(), [&](auto x) {return x->id == n.id;}) != mOutputNodes.end())
       {
-         result.add(maxDepth, n.id, n.inputs);
+         result.add(maxDepth, n.id, getInputs(n.id));
       }
       else
       {
-         result.add(std::min(maxDepth - 1, std::max(n.depth, 0)), n.id, n.inputs);
+         result.add(std::min(maxDepth - 1, std::max(n.depth, 0)), n.id, getInputs(n.id));
       }
    }
 
@@ -183,20 +498,12 @@ std::vector<NetworkTopology::Node> NetworkTopology::getLayer(const std::size_t i
    }
 }
 
-NNAgent::NNAgent(const unsigned int numInputs, const unsigned int numOutputs, std::unique_ptr<NeuroNet2>&& nn)
-: mNn(std::move(nn))
+namespace
 {
 
-}
-
-void NNAgent::reset()
+template<class Iter>
+Iter writeInputs(const std::vector<IOElement>& inputs, Iter iIter)
 {
-   mNn->reset();
-}
-
-void NNAgent::run(const std::vector<IOElement>& inputs, std::vector<IOElement>& output)
-{
-   auto iIter = mNn->begin_input();
    for(auto& i : inputs)
    {
         std::visit([&](auto&& arg) {
@@ -230,9 +537,12 @@ void NNAgent::run(const std::vector<IOElement>& inputs, std::vector<IOElement>&
         }, i);
    }
 
-   mNn->activate();
+   return iIter;
+}
 
-   auto oIter = mNn->begin_output();
+template<class Iter>
+Iter readOutputs(std::vector<IOElement>& output, Iter oIter)
+{
    for(auto& o : output)
    {
         std::visit([&](auto&& arg) {
@@ -262,6 +572,97 @@ void NNAgent::run(const std::vector<IOElement>& inputs, std::vector<IOElement>&
             }
         }, o);
    }
+
+   return oIter;
+}
+
+}
+
+NNAgent::NNAgent(const unsigned int numInputs, const unsigned int numOutputs, std::unique_ptr<NeuroNet2>&& nn, const bool useFloat32)
+: mNn(std::move(nn))
+{
+   if(useFloat32)
+   {
+      mFastNn = std::make_unique<NeuroNetF32>(*mNn);
+   }
+}
+
+NNAgent::~NNAgent() = default;
+
+void NNAgent::reset()
+{
+   mNn->reset();
+   if(mFastNn)
+   {
+      mFastNn->reset();
+   }
+}
+
+void NNAgent::run(const std::vector<IOElement>& inputs, std::vector<IOElement>& output)
+{
+   if(mFastNn)
+   {
+      writeInputs(inputs, mFastNn->begin_input());
+      mFastNn->activate();
+      readOutputs(output, mFastNn->begin_output());
+      return;
+   }
+
+   writeInputs(inputs, mNn->begin_input());
+
+   mNn->activate();
+
+   readOutputs(output, mNn->begin_output());
+}
+
+void NNAgent::runBatch(const std::vector<std::vector<IOElement>>& inputs, std::vector<std::vector<IOElement>>& outputs)
+{
+   if(mFastNn)
+   {
+      return IAgent::runBatch(inputs, outputs);
+   }
+
+   const std::size_t numInputs = std::distance(mNn->begin_input(), mNn->end_input());
+
+   mBatchInputs.resize(inputs.size() * numInputs);
+   auto iIter = mBatchInputs.begin();
+   for(auto& i : inputs)
+   {
+      iIter = writeInputs(i, iIter);
+   }
+
+   mBatchOutputs.resize(inputs.size() * std::distance(mNn->begin_output(), mNn->end_output()));
+   mNn->activateBatch(mBatchInputs, mBatchOutputs, inputs.size());
+
+   auto oIter = mBatchOutputs.cbegin();
+   for(auto& o : outputs)
+   {
+      oIter = readOutputs(o, oIter);
+   }
+}
+
+void NNAgent::runFlat(const IOSchema& schema, std::span<const double> inputs, std::span<double> outputs, const std::size_t numSamples)
+{
+   if(!mFastNn)
+   {
+      mNn->activateBatch(inputs, outputs, numSamples);
+      return;
+   }
+
+   const std::size_t numInputs = std::distance(mFastNn->begin_input(), mFastNn->end_input());
+   const std::size_t numOutputs = std::distance(mFastNn->begin_output(), mFastNn->end_output());
+   if(inputs.size() != numSamples * numInputs || outputs.size() != numSamples * numOutputs)
+   {
+      throw std::runtime_error("Batch size does not match the network");
+   }
+
+   for(std::size_t s = 0; s < numSamples; ++s)
+   {
+      reset();
+      std::copy_n(inputs.begin() + s * numInputs, numInputs, mFastNn->begin_input());
+      mFastNn->activate();
+      std::copy(mFastNn->begin_output(), mFastNn->end_output(), outputs.begin() + s * numOutputs);
+   }
 }
 
 void NNAgent::toBinaryStream(std::ofstream& stream) const
@@ -274,9 +675,21 @@ NeuroNet2& NNAgent::getNN()
    return *mNn;
 }
 
+std::vector<std::pair<NodeId, double>> NeuroNet2::getInputs(const NodeId idx) const
+{
+   std::vector<std::pair<NodeId, double>> result;
+   for(std::uint16_t i = mCons.colInd[idx]; i < mCons.colInd[idx + 1]; ++i)
+   {
+      result.push_back({mCons.rowInd[i], mCons.weights[i]});
+   }
+
+   return result;
+}
+
 void NeuroNet2::reset()
 {
    std::fill(mValues.begin(), mValues.end(), 0);
+   std::fill(mPrevious.begin(), mPrevious.end(), 0);
 }
 
 NeuroNet2::Matrix::Matrix(const std::vector<Node>& mNodes, const std::size_t numConnections)
@@ -359,6 +772,7 @@ std::unique_ptr<NeuroNet2> NeuroNet2::fromBinaryStream(std::ifstream& stream)
    }
 
    result->mCons = Matrix(result->mNodes, numConns);
+   result->buildSchedule();
 
    return std::unique_ptr<NeuroNet2>{result};
 }
@@ -372,8 +786,15 @@ void NeuroNet2::toBinaryStream(std::ofstream& stream)
         return result;
     };
 
+    //The matrix is the source of truth, input lists are only the stream format
+    auto nodes = mNodes;
+    for(auto& n : nodes)
+    {
+        n.inputs = getInputs(n.id);
+    }
+
     boost::archive::binary_oarchive oa(stream);
-    oa << mNodes;
+    oa << nodes;
     oa << mValues;
     oa << toIdVector(mHiddenNodes);
     oa << toIdVector(mInputNodes);
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <map>
 #include <memory>
+#include <span>
 #include "IPlayground.hpp"
 #include <boost/numeric/ublas/matrix_sparse.hpp>
 #include <boost/numeric/ublas/io.hpp>
@@ -56,6 +57,14 @@ public:
       double bias;
    };
 
+   //Connection between node indexes: inputs, then outputs, then hidden nodes
+   struct IndexedConnectionDef
+   {
+      std::uint16_t src;
+      std::uint16_t dst;
+      double weight;
+   };
+
    NeuroNet2(
       const std::vector<NodeId>& inputNodes, 
       const std::vector<NodeId>& outputNodes,
@@ -63,9 +72,28 @@ public:
       const std::vector<ConnectionDef>& connections
       );
 
+   //Packs connections straight into the matrix, nodes keep no input lists
+   NeuroNet2(
+      const std::size_t numInputs,
+      const std::size_t numOutputs,
+      const std::vector<ActivationFunctionType>& hiddenTypes,
+      const std::vector<IndexedConnectionDef>& connections
+      );
+
+   //Nodes are evaluated level by level. A connection inside a cycle, self loops included, reads the value its
+   //source had after the previous tick, every other connection reads the value of the current tick. Results do
+   //not depend on the order nodes are given in. Feed forward nets are detected on construction and take one pass
    void activate();
    void reset();
 
+   //Ticks a recurrent net is stepped per activate, inputs stay the same for all of them
+   void setNumTicks(const std::size_t numTicks);
+   bool isRecurrent() const;
+
+   //Runs numSamples independent passes, each from a reset state.
+   //inputs and outputs are laid out sample by sample (numSamples x numInputs/numOutputs).
+   void activateBatch(std::span<const double> inputs, std::span<double> outputs, const std::size_t numSamples);
+
    NetworkTopology createTopology() const;
    
    NodeIterator begin_input();
@@ -77,10 +105,14 @@ public:
    static std::unique_ptr<NeuroNet2> fromBinaryStream(std::ifstream& stream);
    void toBinaryStream(std::ofstream& stream);
 
+   friend class NeuroNetF32;
+
 #ifndef TEST
 private:
 #endif
    NeuroNet2() = default;
+   std::vector<std::pair<NodeId, double>> getInputs(const NodeId idx) const;
+
    struct Node
    {
       NodeId id;
@@ -99,6 +131,17 @@ private:
       }
    };
 
+   //Computed node and its connections in mSrc/mWeights. [begin, split) read values of the current tick,
+   //[split, end) the previous one
+   struct Step
+   {
+      NodeId id;
+      ActivationFunction func;
+      std::uint32_t begin;
+      std::uint32_t split;
+      std::uint32_t end;
+   };
+
    struct Matrix
    {
       std::vector<std::uint16_t> colInd;
@@ -119,23 +162,51 @@ private:
    std::vector<Node*> mOutputNodes;
 
    Matrix mCons;
+
+   //Sets depths, evaluation order and the previous tick reads from mCons
+   void buildSchedule();
+   //Feed forward nets have no previous tick reads
+   template<bool Recurrent>
+   void tick();
+
+   std::vector<Step> mSchedule;
+   std::vector<NodeId> mSrc;
+   std::vector<double> mWeights;
+   std::vector<double> mPrevious;
+   bool mRecurrent = false;
+   std::size_t mNumTicks = 1;
+
+   //Batch scratch: values of a node for all samples are adjacent
+   std::vector<double> mBatchValues;
+   std::vector<double> mBatchPrevious;
+   std::vector<double> mBatchSums;
 };
 
 std::vector<double> activate(NeuroNet2& n, const std::vector<double>& input);
 
+class NeuroNetF32;
+
 class NNAgent : public IAgent
 {
 public:
-   NNAgent(const unsigned int numInputs, const unsigned int numOutputs, std::unique_ptr<NeuroNet2>&& nn);
+   //useFloat32 runs inference on a NeuroNetF32 copy of the network
+   NNAgent(const unsigned int numInputs, const unsigned int numOutputs, std::unique_ptr<NeuroNet2>&& nn, const bool useFloat32 = false);
+   ~NNAgent();
 
    void reset() override;
    void run(const std::vector<IOElement>& inputs, std::vector<IOElement>& output) override;
+   void runBatch(const std::vector<std::vector<IOElement>>& inputs, std::vector<std::vector<IOElement>>& outputs) override;
+   //Schema layout is the network's own, so sets go to the network as they are
+   void runFlat(const IOSchema& schema, std::span<const double> inputs, std::span<double> outputs, const std::size_t numSamples) override;
    void toBinaryStream(std::ofstream& stream) const override;
 
    NeuroNet2& getNN();
 
 private:
    std::unique_ptr<NeuroNet2> mNn;
+   std::unique_ptr<NeuroNetF32> mFastNn;
+   std::vector<double> mBatchInputs;
+   std::vector<double> mBatchOutputs;
 };
 
 }
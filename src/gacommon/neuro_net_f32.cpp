@@ -0,0 +1,214 @@
+#include "neuro_net_f32.hpp"
+#include <algorithm>
+
+namespace gacommon
+{
+
+NeuroNetF32::NeuroNetF32(const NeuroNet2& source)
+: mNumInputs(source.mInputNodes.size())
+, mNumOutputs(source.mOutputNodes.size())
+, mRecurrent(source.mRecurrent)
+, mNumTicks(source.mNumTicks)
+{
+   const std::size_t numNodes = source.mNodes.size();
+   const std::uint32_t noSlot = static_cast<std::uint32_t>(-1);
+
+   //Nodes of one depth read only values of earlier depths or of the previous tick, so each depth is
+   //a level. Hidden nodes of a level get adjacent slots, outputs keep theirs right after the inputs
+   std::vector<std::uint32_t> slotOf(numNodes, noSlot);
+   for(std::size_t i = 0; i < mNumInputs; ++i)
+   {
+      slotOf[source.mInputNodes[i]->id] = static_cast<std::uint32_t>(i);
+   }
+   for(std::size_t i = 0; i < mNumOutputs; ++i)
+   {
+      slotOf[source.mOutputNodes[i]->id] = static_cast<std::uint32_t>(mNumInputs + i);
+   }
+
+   std::vector<const NeuroNet2::Step*> bySlot(numNodes, nullptr);
+   std::uint32_t nextSlot = static_cast<std::uint32_t>(mNumInputs + mNumOutputs);
+   for(auto first = source.mSchedule.begin(); first != source.mSchedule.end();)
+   {
+      const int depth = source.mNodes[first->id].depth;
+      auto last = std::find_if(first, source.mSchedule.end(), [&](auto& step)
+      {
+         return source.mNodes[step.id].depth != depth;
+      });
+
+      std::vector<const NeuroNet2::Step*> hidden;
+      std::vector<const NeuroNet2::Step*> outputs;
+      for(auto iter = first; iter != last; ++iter)
+      {
+         (slotOf[iter->id] == noSlot ? hidden : outputs).push_back(&*iter);
+      }
+
+      std::stable_sort(hidden.begin(), hidden.end(), [&](auto x, auto y)
+      {
+         return source.mNodes[x->id].accType < source.mNodes[y->id].accType;
+      });
+
+      if(!hidden.empty())
+      {
+         Level l{nextSlot, nextSlot, {}};
+         for(auto step : hidden)
+         {
+            auto type = source.mNodes[step->id].accType;
+            if(l.runs.empty() || l.runs.back().type != type)
+            {
+               l.runs.push_back({type, nextSlot, nextSlot});
+            }
+
+            slotOf[step->id] = nextSlot;
+            bySlot[nextSlot++] = step;
+            l.runs.back().end = nextSlot;
+         }
+         l.end = nextSlot;
+         mLevels.push_back(std::move(l));
+      }
+
+      //Outputs have no runs, every range of adjacent slots is a level of its own
+      std::sort(outputs.begin(), outputs.end(), [&](auto x, auto y)
+      {
+         return slotOf[x->id] < slotOf[y->id];
+      });
+      const auto firstOutputLevel = mLevels.size();
+      for(auto step : outputs)
+      {
+         auto slot = slotOf[step->id];
+         bySlot[slot] = step;
+         if(mLevels.size() == firstOutputLevel || mLevels.back().end != slot)
+         {
+            mLevels.push_back({slot, slot, {}});
+         }
+         mLevels.back().end = slot + 1;
+      }
+
+      first = last;
+   }
+
+   //Pack connections by slot
+   mRowStart.reserve(numNodes - mNumInputs + 1);
+   mRowStart.push_back(0);
+   mRowSplit.reserve(numNodes - mNumInputs);
+   mSrc.reserve(source.mSrc.size());
+   mWeights.reserve(source.mWeights.size());
+   for(std::size_t slot = mNumInputs; slot < numNodes; ++slot)
+   {
+      auto step = bySlot[slot];
+      for(std::uint32_t i = step->begin; i < step->end; ++i)
+      {
+         if(i == step->split)
+         {
+            mRowSplit.push_back(static_cast<std::uint32_t>(mSrc.size()));
+         }
+         mSrc.push_back(slotOf[source.mSrc[i]]);
+         mWeights.push_back(static_cast<float>(source.mWeights[i]));
+      }
+      if(step->split == step->end)
+      {
+         mRowSplit.push_back(static_cast<std::uint32_t>(mSrc.size()));
+      }
+      mRowStart.push_back(static_cast<std::uint32_t>(mSrc.size()));
+   }
+
+   mValues.resize(numNodes, 0.0f);
+   mPrevious.resize(numNodes, 0.0f);
+
+   std::size_t widest = 0;
+   for(auto& l : mLevels)
+   {
+      widest = std::max<std::size_t>(widest, l.end - l.begin);
+   }
+   mSums.resize(widest);
+}
+
+template<bool Recurrent>
+void NeuroNetF32::tick()
+{
+   for(auto& level : mLevels)
+   {
+      float* sums = mSums.data();
+      for(std::uint32_t slot = level.begin; slot < level.end; ++slot)
+      {
+         float totalInput = 0;
+
+         auto row = slot - mNumInputs;
+         for(std::uint32_t i = mRowStart[row]; i < mRowSplit[row]; ++i)
+         {
+            totalInput += mValues[mSrc[i]] * mWeights[i];
+         }
+         if constexpr(Recurrent)
+         {
+            for(std::uint32_t i = mRowSplit[row]; i < mRowStart[row + 1]; ++i)
+            {
+               totalInput += mPrevious[mSrc[i]] * mWeights[i];
+            }
+         }
+
+         sums[slot - level.begin] = totalInput;
+      }
+
+      for(auto& r : level.runs)
+      {
+         activateSpan(r.type, sums + (r.begin - level.begin), r.end - r.begin);
+      }
+
+      std::copy(sums, sums + (level.end - level.begin), mValues.begin() + level.begin);
+   }
+}
+
+void NeuroNetF32::activate()
+{
+   if(!mRecurrent)
+   {
+      tick<false>();
+      return;
+   }
+
+   for(std::size_t t = 0; t < mNumTicks; ++t)
+   {
+      std::copy(mValues.begin(), mValues.end(), mPrevious.begin());
+      tick<true>();
+   }
+}
+
+void NeuroNetF32::reset()
+{
+   std::fill(mValues.begin(), mValues.end(), 0.0f);
+   std::fill(mPrevious.begin(), mPrevious.end(), 0.0f);
+}
+
+NeuroNetF32::NodeIterator NeuroNetF32::begin_input()
+{
+   return mValues.begin();
+}
+
+NeuroNetF32::NodeIterator NeuroNetF32::end_input()
+{
+   return mValues.begin() + mNumInputs;
+}
+
+NeuroNetF32::ConstNodeIterator NeuroNetF32::begin_output() const
+{
+   return mValues.begin() + mNumInputs;
+}
+
+NeuroNetF32::ConstNodeIterator NeuroNetF32::end_output() const
+{
+   return begin_output() + mNumOutputs;
+}
+
+std::vector<float> activate(NeuroNetF32& n, const std::vector<float>& input)
+{
+   std::vector<float> result;
+
+   std::copy(input.begin(), input.end(), n.begin_input());
+
+   n.activate();
+
+   std::copy(n.begin_output(), n.end_output(), std::back_inserter(result));
+
+   return result;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "neuro_net2.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace gacommon
+{
+
+//Float32 copy of a NeuroNet2 for fast inference. Nodes are grouped into levels
+//whose sums can be computed together, and each level is activated per function type
+//with the vector kernels. Results match NeuroNet2 up to float precision, ticks included.
+class NeuroNetF32
+{
+public:
+   using NodeIterator = std::vector<float>::iterator;
+   using ConstNodeIterator = std::vector<float>::const_iterator;
+
+   explicit NeuroNetF32(const NeuroNet2& source);
+
+   void activate();
+   void reset();
+
+   NodeIterator begin_input();
+   NodeIterator end_input();
+
+   ConstNodeIterator begin_output() const;
+   ConstNodeIterator end_output() const;
+
+#ifndef TEST
+private:
+#endif
+   template<bool Recurrent>
+   void tick();
+
+   struct Run
+   {
+      ActivationFunctionType type;
+      std::uint32_t begin;
+      std::uint32_t end;
+   };
+
+   //Slots [begin, end) are computed together, outputs have no runs
+   struct Level
+   {
+      std::uint32_t begin;
+      std::uint32_t end;
+      std::vector<Run> runs;
+   };
+
+   std::size_t mNumInputs;
+   std::size_t mNumOutputs;
+   bool mRecurrent;
+   std::size_t mNumTicks;
+
+   //Inputs, outputs, then hidden nodes in evaluation order
+   std::vector<float> mValues;
+   std::vector<float> mPrevious;
+   std::vector<float> mSums;
+
+   //CSR over computed slots, indexed by slot - mNumInputs. Sources from the split on are read from mPrevious
+   std::vector<std::uint32_t> mRowStart;
+   std::vector<std::uint32_t> mRowSplit;
+   std::vector<std::uint32_t> mSrc;
+   std::vector<float> mWeights;
+
+   std::vector<Level> mLevels;
+};
+
+std::vector<float> activate(NeuroNetF32& n, const std::vector<float>& input);
+
+}
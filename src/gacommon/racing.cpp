@@ -0,0 +1,134 @@
+#include "racing.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace gacommon
+{
+
+RacedOrder::RacedOrder(std::vector<Fitness> fitness, std::vector<Fitness> upperBounds, std::vector<bool> finished)
+: mFitness(std::move(fitness))
+, mUpperBounds(std::move(upperBounds))
+, mFinished(std::move(finished))
+{
+   for(std::size_t i = 0; i < mFitness.size(); ++i)
+   {
+      if(mFinished[i])
+      {
+         mUpperBounds[i] = mFitness[i];
+         mFinishedOrder.push_back(i);
+      }
+   }
+   std::sort(mFinishedOrder.begin(), mFinishedOrder.end(), [this](auto a, auto b){return isBefore(a, b);});
+   updateKnown();
+}
+
+std::size_t RacedOrder::size() const
+{
+   return mFitness.size();
+}
+
+bool RacedOrder::isFinished(const std::size_t candidate) const
+{
+   return mFinished[candidate];
+}
+
+Fitness RacedOrder::getFitness(const std::size_t candidate) const
+{
+   return mFitness[candidate];
+}
+
+std::size_t RacedOrder::getNumKnown() const
+{
+   return mNumKnown;
+}
+
+std::size_t RacedOrder::at(const std::size_t position) const
+{
+   return mFinishedOrder[position];
+}
+
+std::vector<std::size_t> RacedOrder::getOrder() const
+{
+   std::vector<std::size_t> result(mFitness.size());
+   std::iota(result.begin(), result.end(), 0);
+   std::sort(result.begin(), result.end(), [this](auto a, auto b){return isBefore(a, b);});
+
+   return result;
+}
+
+std::vector<std::size_t> RacedOrder::getNextToFinish(std::size_t count) const
+{
+   count = std::min(count, mFitness.size());
+   std::vector<std::size_t> result;
+   if(count <= mNumKnown)
+   {
+      return result;
+   }
+
+   for(std::size_t i = 0; i < mFitness.size(); ++i)
+   {
+      if(!mFinished[i])
+      {
+         result.push_back(i);
+      }
+   }
+
+   if(mFinishedOrder.size() >= count)
+   {
+      const auto threshold = mFitness[mFinishedOrder[count - 1]];
+      std::erase_if(result, [&](auto i){return mUpperBounds[i] < threshold;});
+   }
+   else
+   {
+      const auto numMissing = std::min(count - mFinishedOrder.size(), result.size());
+      std::partial_sort(result.begin(), result.begin() + numMissing, result.end(), [this](auto a, auto b)
+      {
+         return mUpperBounds[a] > mUpperBounds[b] || (mUpperBounds[a] == mUpperBounds[b] && a < b);
+      });
+      result.resize(numMissing);
+   }
+
+   return result;
+}
+
+void RacedOrder::finish(const std::size_t candidate, const Fitness fitness)
+{
+   mFitness[candidate] = fitness;
+   mUpperBounds[candidate] = fitness;
+   mFinished[candidate] = true;
+   mFinishedOrder.insert(
+      std::upper_bound(mFinishedOrder.begin(), mFinishedOrder.end(), candidate, [this](auto a, auto b){return isBefore(a, b);}),
+      candidate
+      );
+   updateKnown();
+}
+
+bool RacedOrder::isBefore(const std::size_t a, const std::size_t b) const
+{
+   return mFitness[a] > mFitness[b] || (mFitness[a] == mFitness[b] && a < b);
+}
+
+void RacedOrder::updateKnown()
+{
+   if(mFinishedOrder.size() == mFitness.size())
+   {
+      mNumKnown = mFitness.size();
+      return;
+   }
+
+   //A finished candidate is placed for good once every unfinished one is bound to stay below it
+   Fitness maxUpperBound = 0;
+   bool first = true;
+   for(std::size_t i = 0; i < mFitness.size(); ++i)
+   {
+      if(!mFinished[i])
+      {
+         maxUpperBound = first ? mUpperBounds[i] : std::max(maxUpperBound, mUpperBounds[i]);
+         first = false;
+      }
+   }
+
+   mNumKnown = std::partition_point(mFinishedOrder.begin(), mFinishedOrder.end(), [&](auto i){return mFitness[i] > maxUpperBound;}) - mFinishedOrder.begin();
+}
+
+}
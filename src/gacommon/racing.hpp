@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "IPlayground.hpp"
+
+namespace gacommon
+{
+
+//Candidates ordered by fitness while some of them are only partially scored. Unfinished candidates have a
+//lower bound fitness and an upper bound on what finishing can add to it. The order is the one a stable sort
+//of the final fitness in descending order would give, and a prefix of it is known once no unfinished
+//candidate can enter it. Finishing candidates grows the known prefix.
+class RacedOrder
+{
+public:
+   //Finished candidates take upper bound equal to their fitness
+   RacedOrder(std::vector<Fitness> fitness, std::vector<Fitness> upperBounds, std::vector<bool> finished);
+
+   std::size_t size() const;
+   bool isFinished(const std::size_t candidate) const;
+   Fitness getFitness(const std::size_t candidate) const;
+
+   //Length of the known prefix of the order
+   std::size_t getNumKnown() const;
+   //Candidate at a position of the known prefix
+   std::size_t at(const std::size_t position) const;
+   //All candidates by their current fitness, the known prefix comes first
+   std::vector<std::size_t> getOrder() const;
+
+   //Unfinished candidates worth finishing next to know the first count positions, empty once they are known.
+   //If count candidates are finished it is every one that can still enter them, otherwise the best bounded
+   //ones that make up the missing number
+   std::vector<std::size_t> getNextToFinish(std::size_t count) const;
+   void finish(const std::size_t candidate, const Fitness fitness);
+
+private:
+   bool isBefore(const std::size_t a, const std::size_t b) const;
+   void updateKnown();
+
+   std::vector<Fitness> mFitness;
+   std::vector<Fitness> mUpperBounds;
+   std::vector<bool> mFinished;
+   //Finished candidates in order
+   std::vector<std::size_t> mFinishedOrder;
+   std::size_t mNumKnown = 0;
+};
+
+}
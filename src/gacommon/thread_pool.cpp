@@ -0,0 +1,172 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace gacommon
+{
+
+ThreadPool::ThreadPool(const std::size_t numThreads)
+{
+   const std::size_t n = std::max<std::size_t>(1, numThreads);
+
+   for(std::size_t i = 0; i < n; ++i)
+   {
+      mQueues.push_back(std::make_unique<Queue>());
+   }
+
+   for(std::size_t i = 0; i < n; ++i)
+   {
+      mThreads.emplace_back([this, i](){threadFunc(i);});
+   }
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+   }
+   mWake.notify_all();
+
+   for(auto& t : mThreads)
+   {
+      t.join();
+   }
+}
+
+std::size_t ThreadPool::getNumThreads() const
+{
+   return mThreads.size();
+}
+
+void ThreadPool::parallelFor(const std::size_t count, const std::function<void(std::size_t)>& func)
+{
+   if(count == 0)
+   {
+      return;
+   }
+
+   Job job{func, count, nullptr};
+
+   //Counted before the tasks are visible, a worker that takes one right away must not wrap it below zero
+   mQueued += count;
+
+   //Deal tasks round robin, stealing evens out whatever the split gets wrong
+   for(std::size_t q = 0; q < mQueues.size(); ++q)
+   {
+      std::lock_guard<std::mutex> lock(mQueues[q]->mutex);
+      for(std::size_t i = q; i < count; i += mQueues.size())
+      {
+         mQueues[q]->tasks.push_back({&job, i});
+      }
+   }
+
+   //Pass through the lock so a worker between its check and its wait cannot miss the wake up
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+   }
+   mWake.notify_all();
+
+   {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mDone.wait(lock, [&](){return job.pending == 0;});
+   }
+
+   if(job.error)
+   {
+      std::rethrow_exception(job.error);
+   }
+}
+
+std::vector<std::chrono::nanoseconds> ThreadPool::takeBusyTimes()
+{
+   std::vector<std::chrono::nanoseconds> result;
+   for(auto& q : mQueues)
+   {
+      result.push_back(std::chrono::nanoseconds(q->busyNs.exchange(0)));
+   }
+
+   return result;
+}
+
+void ThreadPool::threadFunc(const std::size_t self)
+{
+   while(true)
+   {
+      Task task;
+      if(takeTask(self, task))
+      {
+         runTask(self, task);
+         continue;
+      }
+
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWake.wait(lock, [&](){return mStop || mQueued > 0;});
+      if(mStop && mQueued == 0)
+      {
+         return;
+      }
+   }
+}
+
+bool ThreadPool::takeTask(const std::size_t self, Task& task)
+{
+   //Own queue from the front, others from the back
+   for(std::size_t i = 0; i < mQueues.size(); ++i)
+   {
+      auto& q = *mQueues[(self + i) % mQueues.size()];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if(!q.tasks.empty())
+      {
+         if(i == 0)
+         {
+            task = q.tasks.front();
+            q.tasks.pop_front();
+         }
+         else
+         {
+            task = q.tasks.back();
+            q.tasks.pop_back();
+         }
+
+         mQueued--;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void ThreadPool::runTask(const std::size_t self, const Task& task)
+{
+   auto& job = *task.job;
+   auto start = std::chrono::steady_clock::now();
+   try
+   {
+      job.func(task.index);
+   }
+   catch(...)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if(!job.error)
+      {
+         job.error = std::current_exception();
+      }
+   }
+   mQueues[self]->busyNs += std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count();
+
+   if(--job.pending == 0)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mDone.notify_all();
+   }
+}
+
+void ensureThreadPool(std::unique_ptr<ThreadPool>& pool, const std::size_t numThreads)
+{
+   if(!pool || pool->getNumThreads() != std::max<std::size_t>(1, numThreads))
+   {
+      pool = std::make_unique<ThreadPool>(numThreads);
+   }
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gacommon
+{
+
+//Persistent pool of workers with per worker queues. Idle workers steal from the back
+//of other queues, so one slow task does not hold back the rest of its share.
+class ThreadPool
+{
+public:
+   explicit ThreadPool(const std::size_t numThreads);
+   ~ThreadPool();
+
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool& operator= (const ThreadPool&) = delete;
+
+   std::size_t getNumThreads() const;
+
+   //Calls func(i) for every i in [0, count) on the workers and waits for all of them.
+   //The first exception thrown by a task is rethrown here.
+   void parallelFor(const std::size_t count, const std::function<void(std::size_t)>& func);
+
+   //Time each worker spent running tasks since the previous call
+   std::vector<std::chrono::nanoseconds> takeBusyTimes();
+
+private:
+   struct Job
+   {
+      const std::function<void(std::size_t)>& func;
+      std::atomic<std::size_t> pending;
+      std::exception_ptr error;
+   };
+
+   struct Task
+   {
+      Job* job;
+      std::size_t index;
+   };
+
+   struct Queue
+   {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+      std::atomic<std::int64_t> busyNs = 0;
+   };
+
+   void threadFunc(const std::size_t self);
+   bool takeTask(const std::size_t self, Task& task);
+   void runTask(const std::size_t self, const Task& task);
+
+   std::vector<std::unique_ptr<Queue>> mQueues;
+   std::vector<std::thread> mThreads;
+
+   std::mutex mMutex;
+   std::condition_variable mWake;
+   std::condition_variable mDone;
+   std::atomic<std::size_t> mQueued = 0;
+   bool mStop = false;
+};
+
+//Recreates the pool if the requested number of threads has changed
+void ensureThreadPool(std::unique_ptr<ThreadPool>& pool, const std::size_t numThreads);
+
+}
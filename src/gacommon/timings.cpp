@@ -0,0 +1,163 @@
+#include "timings.hpp"
+#include "thread_pool.hpp"
+
+namespace gacommon
+{
+
+std::string toString(const Phase phase)
+{
+   switch(phase)
+   {
+      case Phase::Select: return "select";
+      case Phase::Repopulate: return "repopulate";
+      case Phase::BuildAnn: return "buildAnn";
+      case Phase::Evaluate: return "evaluate";
+      case Phase::Speciate: return "speciate";
+      case Phase::Sort: return "sort";
+      case Phase::Checkpoint: return "checkpoint";
+   }
+
+   return "unknown";
+}
+
+std::chrono::nanoseconds GenerationTimings::get(const Phase phase) const
+{
+   return phases[static_cast<std::size_t>(phase)];
+}
+
+double GenerationTimings::getEvaluationsPerSecond() const
+{
+   auto seconds = std::chrono::duration<double>(get(Phase::Evaluate)).count();
+   return seconds > 0 ? numEvaluations / seconds : 0.0;
+}
+
+std::chrono::nanoseconds GenerationTimings::getRacingSavedTime() const
+{
+   if(racingWorkDone == 0)
+   {
+      return std::chrono::nanoseconds(0);
+   }
+   return std::chrono::nanoseconds(static_cast<std::int64_t>(
+      static_cast<double>(get(Phase::Evaluate).count()) * racingWorkSkipped / racingWorkDone));
+}
+
+double GenerationTimings::getCacheHitRate() const
+{
+   return cacheLookups > 0 ? static_cast<double>(cacheHits) / cacheLookups : 0.0;
+}
+
+boost::property_tree::ptree toPtree(const GenerationTimings& timings)
+{
+   using Ms = std::chrono::duration<double, std::milli>;
+
+   boost::property_tree::ptree result;
+   result.put("generation", timings.generation);
+   result.put("totalMs", Ms(timings.total).count());
+   for(std::size_t i = 0; i < NumPhases; ++i)
+   {
+      result.put("phasesMs." + toString(static_cast<Phase>(i)), Ms(timings.phases[i]).count());
+   }
+   result.put("numEvaluations", timings.numEvaluations);
+   result.put("evaluationsPerSecond", timings.getEvaluationsPerSecond());
+   result.put("racing.workDone", timings.racingWorkDone);
+   result.put("racing.workSkipped", timings.racingWorkSkipped);
+   result.put("racing.savedMs", Ms(timings.getRacingSavedTime()).count());
+   result.put("fitnessCache.lookups", timings.cacheLookups);
+   result.put("fitnessCache.hits", timings.cacheHits);
+   result.put("fitnessCache.hitRate", timings.getCacheHitRate());
+
+   boost::property_tree::ptree busy;
+   for(auto& t : timings.threadBusy)
+   {
+      boost::property_tree::ptree ch;
+      ch.put("", Ms(t).count());
+      busy.push_back(std::make_pair("", ch));
+   }
+   result.add_child("threadBusyMs", busy);
+
+   return result;
+}
+
+Timings::Scope::Scope(Timings& timings, const Phase phase)
+: mTimings(timings)
+, mPhase(phase)
+, mStart(std::chrono::steady_clock::now())
+{
+}
+
+Timings::Scope::~Scope()
+{
+   mTimings.add(mPhase, std::chrono::steady_clock::now() - mStart);
+}
+
+Timings::Timings()
+: mStart(std::chrono::steady_clock::now())
+{
+   for(auto& p : mPhases)
+   {
+      p = 0;
+   }
+}
+
+Timings::Scope Timings::measure(const Phase phase)
+{
+   return Scope(*this, phase);
+}
+
+void Timings::add(const Phase phase, const std::chrono::nanoseconds duration)
+{
+   mPhases[static_cast<std::size_t>(phase)] += duration.count();
+}
+
+void Timings::addEvaluations(const std::size_t count)
+{
+   mNumEvaluations += count;
+}
+
+void Timings::addRacingWork(const std::size_t done, const std::size_t skipped)
+{
+   mRacingWorkDone += done;
+   mRacingWorkSkipped += skipped;
+}
+
+void Timings::addCacheLookups(const std::size_t lookups, const std::size_t hits)
+{
+   mCacheLookups += lookups;
+   mCacheHits += hits;
+}
+
+void Timings::beginGeneration()
+{
+   mStart = std::chrono::steady_clock::now();
+}
+
+void Timings::endGeneration(const std::size_t generation, ThreadPool* pool)
+{
+   GenerationTimings result;
+   result.generation = generation;
+   result.total = std::chrono::steady_clock::now() - mStart;
+   for(std::size_t i = 0; i < NumPhases; ++i)
+   {
+      result.phases[i] = std::chrono::nanoseconds(mPhases[i].exchange(0));
+   }
+   result.numEvaluations = mNumEvaluations.exchange(0);
+   result.racingWorkDone = mRacingWorkDone.exchange(0);
+   result.racingWorkSkipped = mRacingWorkSkipped.exchange(0);
+   result.cacheLookups = mCacheLookups.exchange(0);
+   result.cacheHits = mCacheHits.exchange(0);
+   if(pool)
+   {
+      result.threadBusy = pool->takeBusyTimes();
+   }
+
+   std::lock_guard<std::mutex> lock(mMutex);
+   mLast = std::move(result);
+}
+
+GenerationTimings Timings::getLast() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mLast;
+}
+
+}
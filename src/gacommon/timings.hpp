@@ -0,0 +1,103 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+namespace gacommon
+{
+
+class ThreadPool;
+
+enum class Phase
+{
+   Select,
+   Repopulate,
+   BuildAnn,
+   Evaluate,
+   Speciate,
+   Sort,
+   Checkpoint
+};
+
+constexpr std::size_t NumPhases = static_cast<std::size_t>(Phase::Checkpoint) + 1;
+
+std::string toString(const Phase phase);
+
+struct GenerationTimings
+{
+   std::size_t generation = 0;
+   std::chrono::nanoseconds total{0};
+   //BuildAnn runs inside evaluation on every worker, so it is the sum over workers
+   std::array<std::chrono::nanoseconds, NumPhases> phases{};
+   std::size_t numEvaluations = 0;
+   //Time each worker of the pool spent running tasks
+   std::vector<std::chrono::nanoseconds> threadBusy;
+   //Racing evaluation: challenges run and challenges skipped for candidates selection never needed
+   std::size_t racingWorkDone = 0;
+   std::size_t racingWorkSkipped = 0;
+   //Fitness cache lookups and the ones answered without an evaluation
+   std::size_t cacheLookups = 0;
+   std::size_t cacheHits = 0;
+
+   std::chrono::nanoseconds get(const Phase phase) const;
+   double getEvaluationsPerSecond() const;
+   //Evaluation time the skipped work would have taken at the rate of the work done
+   std::chrono::nanoseconds getRacingSavedTime() const;
+   double getCacheHitRate() const;
+};
+
+boost::property_tree::ptree toPtree(const GenerationTimings& timings);
+
+//Collects the timings of the generation in progress. Phases may be added from any thread,
+//the last finished generation can be read at any time. A checkpoint taken between
+//generations is reported with the generation that follows it.
+class Timings
+{
+public:
+   class Scope
+   {
+   public:
+      Scope(Timings& timings, const Phase phase);
+      ~Scope();
+
+      Scope(const Scope&) = delete;
+      Scope& operator= (const Scope&) = delete;
+
+   private:
+      Timings& mTimings;
+      const Phase mPhase;
+      const std::chrono::steady_clock::time_point mStart;
+   };
+
+   Timings();
+
+   Scope measure(const Phase phase);
+   void add(const Phase phase, const std::chrono::nanoseconds duration);
+   void addEvaluations(const std::size_t count);
+   void addRacingWork(const std::size_t done, const std::size_t skipped);
+   void addCacheLookups(const std::size_t lookups, const std::size_t hits);
+
+   void beginGeneration();
+   void endGeneration(const std::size_t generation, ThreadPool* pool);
+
+   GenerationTimings getLast() const;
+
+private:
+   std::array<std::atomic<std::int64_t>, NumPhases> mPhases;
+   std::atomic<std::size_t> mNumEvaluations = 0;
+   std::atomic<std::size_t> mRacingWorkDone = 0;
+   std::atomic<std::size_t> mRacingWorkSkipped = 0;
+   std::atomic<std::size_t> mCacheLookups = 0;
+   std::atomic<std::size_t> mCacheHits = 0;
+   std::chrono::steady_clock::time_point mStart;
+
+   mutable std::mutex mMutex;
+   GenerationTimings mLast;
+};
+
+}
@@ -0,0 +1,80 @@
+#include "CheckpointWriter.hpp"
+
+CheckpointWriter::CheckpointWriter()
+    : mThread(&CheckpointWriter::threadFunc, this)
+{
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mJobPosted.notify_one();
+    mThread.join();
+}
+
+void CheckpointWriter::post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mJobPosted.notify_one();
+}
+
+bool CheckpointWriter::isIdle()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mJobs.empty() && !mBusy;
+}
+
+void CheckpointWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJobsDone.wait(lock, [this]{return mJobs.empty() && !mBusy;});
+
+    if(mError)
+    {
+        auto error = mError;
+        mError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void CheckpointWriter::threadFunc()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(true)
+    {
+        mJobPosted.wait(lock, [this]{return !mJobs.empty() || mStopping;});
+        if(mJobs.empty())
+        {
+            return;
+        }
+
+        auto job = std::move(mJobs.front());
+        mJobs.pop_front();
+        mBusy = true;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try
+        {
+            job();
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        mBusy = false;
+        if(error && !mError)
+        {
+            mError = error;
+        }
+        mJobsDone.notify_all();
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//Runs checkpoint jobs on its own thread one at a time, in the order they were posted
+class CheckpointWriter
+{
+public:
+    CheckpointWriter();
+    //Finishes the posted jobs
+    ~CheckpointWriter();
+
+    void post(std::function<void()> job);
+    //True if all posted jobs are done
+    bool isIdle();
+    //Waits for the posted jobs, rethrows the first error one of them threw since the last flush
+    void flush();
+
+private:
+    void threadFunc();
+
+    std::mutex mMutex;
+    std::condition_variable mJobPosted;
+    std::condition_variable mJobsDone;
+    std::deque<std::function<void()>> mJobs;
+    bool mBusy = false;
+    bool mStopping = false;
+    std::exception_ptr mError;
+
+    std::thread mThread;
+};
@@ -9,6 +9,7 @@ Host::Host()
     : mRootDir(getenv("HOME") + std::string("/.snakeai"))
 {
     std::filesystem::create_directory(mRootDir);
+    mStatus = std::make_shared<const HostStatus>();
 }
 
 HostState Host::getState() const
@@ -16,6 +17,21 @@ HostState Host::getState() const
     return mState;
 }
 
+std::shared_ptr<const HostStatus> Host::getStatus() const
+{
+    return mStatus.load();
+}
+
+void Host::publishStatus()
+{
+    auto status = std::make_shared<HostStatus>();
+    status->config = mCurrentProject->getConfig();
+    status->recentStats = mCurrentProject->printRecentStats();
+    status->timings = mCurrentProject->getTimings();
+
+    mStatus = std::move(status);
+}
+
 std::vector<std::string> Host::listProjects() const
 {
     std::vector<std::string> result;
@@ -68,10 +84,15 @@ void Host::createProject(const std::string& name)
 
     auto newCfg = makeDefaultProjectConfig();
 
+    //Checkpoints of the current project may still be written
+    mWriter.flush();
+
     mCurrentProject = sori::createProject(newCfg);
     mCurrentProjectName = name;
     std::filesystem::create_directory(mRootDir + "/" + name);
     saveProject();
+    mWriter.flush();
+    publishStatus();
     mState = HostState::Ready;
 }
 
@@ -95,10 +116,12 @@ void Host::loadProject(const std::string& name)
         throw std::runtime_error("Project with name " + name + " does not exists");
     }
 
+    mWriter.flush();
     auto cfg = readProjectConfig(mRootDir + "/" + name + "/cfg");
 
     mCurrentProject = sori::loadProject(mRootDir + "/" + name + "/state", cfg);
     mCurrentProjectName = name;
+    publishStatus();
     mState = HostState::Ready;
 }
 
@@ -113,8 +136,11 @@ void Host::deleteProject(const std::string& name)
     {
         mState = HostState::Empty;
         mCurrentProject.reset();
+        mCurrentProjectName.clear();
+        mStatus = std::make_shared<const HostStatus>();
     }
 
+    mWriter.flush();
     std::filesystem::remove_all(mRootDir + "/" + name);
 }
 
@@ -133,7 +159,17 @@ std::string Host::printLatestStatistics() const
         throw std::runtime_error("Cannot print stats in this state");
     }
 
-    return mCurrentProject->printRecentStats();
+    return getStatus()->recentStats;
+}
+
+boost::property_tree::ptree Host::getTimings() const
+{
+    if(mState == HostState::Empty)
+    {
+        throw std::runtime_error("Cannot get timings in this state");
+    }
+
+    return getStatus()->timings;
 }
 
 void Host::threadFunc(const StopCondition condition)
@@ -144,15 +180,17 @@ void Host::threadFunc(const StopCondition condition)
         && !mStopTriggered)
     {
         mCurrentProject->step();
+        publishStatus();
 
-        if(mStopTriggered || std::chrono::system_clock::now() > nextAutoSaveTime)
+        //An autosave waits for the previous one to be written, so they do not pile up behind a slow disk
+        if(mStopTriggered || (std::chrono::system_clock::now() > nextAutoSaveTime && mWriter.isIdle()))
         {
             saveProject();
             nextAutoSaveTime = std::chrono::system_clock::now() + std::chrono::minutes(mCurrentProject->getConfig().get<std::size_t>("autosave_period"));
         }
     }
 
-    mStopTriggered = false;
+    mWriter.flush();
     mState = HostState::Ready;
 }
 
@@ -168,13 +206,17 @@ void Host::run(const StopCondition& condition)
         mRunnerThread.join();
     }
 
+    //A stop that lost the race with the previous run finishing on its own must not end this one
+    mStopTriggered = false;
     mState = HostState::Running;
     mRunnerThread = std::thread(&Host::threadFunc, this, condition);
 }
 
 void Host::stop()
 {
-    if(mState != HostState::Running)
+    //The runner may be finishing on its own, it sets Ready only after it is done with the project
+    auto expected = HostState::Running;
+    if(!mState.compare_exchange_strong(expected, HostState::Stopping))
     {
         throw std::runtime_error("Cannot run in this state");
     }
@@ -192,6 +234,8 @@ void Host::set(const std::string& key, const std::string& value)
     cfg.put(key, value);
     mCurrentProject->reconfigure(cfg);
     saveProject();
+    mWriter.flush();
+    publishStatus();
 }
 
 boost::property_tree::ptree Host::getConfig() const
@@ -201,12 +245,17 @@ boost::property_tree::ptree Host::getConfig() const
         throw std::runtime_error("Cannot run in this state");
     }
 
-    return mCurrentProject->getConfig();
+    return getStatus()->config;
 }
 
 void Host::saveProject()
 {
+    const auto dir = mRootDir + "/" + mCurrentProjectName;
     auto cfg = mCurrentProject->getConfig();
-    boost::property_tree::write_json(mRootDir + "/" + mCurrentProjectName + "/cfg", cfg);
-    mCurrentProject->saveState(mRootDir + "/" + mCurrentProjectName + "/state");
+    auto writeState = mCurrentProject->snapshotState(dir + "/state");
+    mWriter.post([dir, cfg, writeState]()
+    {
+        boost::property_tree::write_json(dir + "/cfg", cfg);
+        writeState();
+    });
 }
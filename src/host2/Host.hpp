@@ -1,10 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <map>
 #include <thread>
 #include <boost/property_tree/ptree.hpp>
 #include "IProject.hpp"
+#include "CheckpointWriter.hpp"
 
 enum class HostState
 {
@@ -14,6 +17,14 @@ enum class HostState
     Stopping
 };
 
+//What monitoring queries see, published by whoever changed the project last
+struct HostStatus
+{
+    boost::property_tree::ptree config;
+    std::string recentStats;
+    boost::property_tree::ptree timings;
+};
+
 struct StopCondition
 {
     std::size_t minutes;
@@ -26,6 +37,8 @@ public:
     ~Host();
 
     HostState getState() const;
+    //Never waits for a generation or an operation to finish
+    std::shared_ptr<const HostStatus> getStatus() const;
     std::vector<std::string> listProjects() const;
     void createProject(const std::string& name);
     void loadProject(const std::string& name);
@@ -38,6 +51,7 @@ public:
     void set(const std::string& key, const std::string& value);
     boost::property_tree::ptree getConfig() const;
     std::string printLatestStatistics() const;
+    boost::property_tree::ptree getTimings() const;
 
     void exportPop(const std::size_t idx, const std::string& filename) const;
 
@@ -45,12 +59,19 @@ private:
     const std::string mRootDir;
     void threadFunc(const StopCondition condition);
     void saveProject();
+    //Only called by the thread owning the project: the runner while it runs, the caller otherwise
+    void publishStatus();
 
-    HostState mState = HostState::Empty;
+    std::atomic<HostState> mState = HostState::Empty;
+    //Not lock-free in libstdc++: a reader spins on an internal lock, but only for the pointer copy
+    std::atomic<std::shared_ptr<const HostStatus>> mStatus;
 
     std::unique_ptr<IProject> mCurrentProject;
     std::string mCurrentProjectName;
 
     std::thread mRunnerThread;
     std::atomic<bool> mStopTriggered = false;
+
+    //Writes the snapshots taken by saveProject, so the runner does not wait for the disk
+    CheckpointWriter mWriter;
 };
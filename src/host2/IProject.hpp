@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <boost/property_tree/ptree.hpp>
 
 class IProject
@@ -10,10 +11,12 @@ public:
     virtual boost::property_tree::ptree getConfig() const = 0;
     virtual void reconfigure(const boost::property_tree::ptree& cfg) = 0;
     virtual void step() = 0;
-    virtual void saveState(const std::string& fileName) = 0;
+    //Takes a snapshot of the state and returns the job writing it, the job may run while the project steps
+    virtual std::function<void()> snapshotState(const std::string& fileName) = 0;
     virtual std::size_t getGenerationNumber() const = 0;
     virtual void exportPop(const std::size_t idx, const std::string& filename) const = 0;
 
     //Callable any time
     virtual std::string printRecentStats() const = 0;
+    virtual boost::property_tree::ptree getTimings() const = 0;
 };
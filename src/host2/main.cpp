@@ -1,9 +1,17 @@
+#include <array>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <optional>
 #include <string>
-#include <boost/bind.hpp>
-#include <boost/shared_ptr.hpp>
-#include <boost/enable_shared_from_this.hpp>
+#include <utility>
 #include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -143,6 +151,13 @@ std::string executeOperation(const boost::property_tree::ptree& tr)
     {
         return gHost.printLatestStatistics();
     }
+    else if(opName == "timings")
+    {
+        auto result = gHost.getTimings();
+        std::stringstream str;
+        boost::property_tree::write_json(str, result);
+        return str.str();
+    }
     else if(opName == "getConfig")
     {
         auto result = gHost.getConfig();
@@ -156,135 +171,196 @@ std::string executeOperation(const boost::property_tree::ptree& tr)
     }
 }
 
-std::string handleMessage(const std::string& input)
+//Answered on the I/O thread, they only read the published status or flip a flag
+bool isInstant(const std::string& opName)
+{
+    return opName == "getState" || opName == "listProjects" || opName == "recentStats" || opName == "timings" ||
+        opName == "getConfig" || opName == "stop" || opName == "quit";
+}
+
+std::string handleOperation(const boost::property_tree::ptree& tree)
 {
-    std::string result;
     try
     {
-        boost::property_tree::ptree tree;
-        std::stringstream str(input);
-        boost::property_tree::read_json(str, tree);
-        result =  executeOperation(tree);
+        return executeOperation(tree);
     }
     catch(std::exception& ex)
     {
         return "Error: " + std::string(ex.what());
     }
-
-
-    return result;
 }
 
-class Connection : public boost::enable_shared_from_this<Connection>
+class Server
 {
+    // Message format for this server: 16bit length + content, replied with 32bit length + content
 public:
-    static boost::shared_ptr<Connection> create(boost::asio::io_service& ioService)
+    Server(boost::asio::io_context& ioContext)
+        : mIoContext(ioContext)
+        , mAcceptor(ioContext, tcp::endpoint(tcp::v4(), 38539))
     {
-        return boost::shared_ptr<Connection>(new Connection(ioService));
-    }
-
-    tcp::socket& socket()
-    {
-        return mSocket;
-    }
-
-    void start()
-    {
-        boost::asio::async_read(mSocket, boost::asio::buffer(mInputHeader.data(), mInputHeader.size()),
-            boost::bind(&Connection::handleReadHeader, shared_from_this(), boost::asio::placeholders::error));
+        boost::asio::co_spawn(mIoContext, accept(), boost::asio::detached);
     }
 
 private:
-    void handleWrite(const boost::system::error_code err)
+    //Reply to the messages answered on the I/O thread, nothing if the message is an operation for the worker
+    std::optional<std::string> answer(const std::string& input, boost::property_tree::ptree& tree)
     {
-        if(gQuit)
+        std::string opName;
+        try
+        {
+            std::stringstream str(input);
+            boost::property_tree::read_json(str, tree);
+            opName = getOrThrow<std::string>(tree, "operation");
+        }
+        catch(std::exception& ex)
         {
-            throw std::logic_error("Quitting");
+            return "Error: " + std::string(ex.what());
         }
+
+        if(opName == "progress")
+        {
+            return printProgress();
+        }
+        if(isInstant(opName))
+        {
+            return handleOperation(tree);
+        }
+
+        return std::nullopt;
     }
 
-    void handleRead(const boost::system::error_code err)
+    //Everything else changes the host, so it runs one at a time on the worker and
+    //the connection waits for it without holding up the I/O thread
+    template<class CompletionToken>
+    auto asyncOperate(boost::property_tree::ptree tree, CompletionToken&& token)
     {
-        if (err)
         {
+            std::lock_guard<std::mutex> lock(mProgressMutex);
+            ++mNumQueued;
         }
-        else
+
+        return boost::asio::async_initiate<CompletionToken, void(std::string)>(
+            [this](auto handler, boost::property_tree::ptree tree)
+            {
+                boost::asio::post(mWorker, [this, tree = std::move(tree), handler = std::move(handler)]() mutable
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mProgressMutex);
+                        --mNumQueued;
+                        mOperation = tree.get<std::string>("operation");
+                        mOperationStart = std::chrono::steady_clock::now();
+                    }
+
+                    auto result = handleOperation(tree);
+
+                    {
+                        std::lock_guard<std::mutex> lock(mProgressMutex);
+                        mOperation.clear();
+                    }
+
+                    //The connection resumes on its own executor
+                    auto ex = boost::asio::get_associated_executor(handler);
+                    boost::asio::post(ex, [handler = std::move(handler), result = std::move(result)]() mutable
+                    {
+                        std::move(handler)(std::move(result));
+                    });
+                });
+            }, token, std::move(tree));
+    }
+
+    boost::asio::awaitable<void> accept()
+    {
+        for(;;)
         {
-            std::cout << "Input message: " << mInputBuffer << std::endl;
-            auto responce = handleMessage(mInputBuffer);
-            if(responce.size() > 4294967294)
+            try
             {
-                std::cout << "Responce size is to big, send error instead" << std::endl;
-                responce = "Error: responce is to big";
+                auto socket = co_await mAcceptor.async_accept(boost::asio::use_awaitable);
+                boost::asio::co_spawn(mIoContext, serve(std::move(socket)), boost::asio::detached);
+            }
+            catch(std::exception& e)
+            {
+                std::cout << "Accept failed: " << e.what() << std::endl;
             }
-            mOutBuffer.resize(responce.size() + 4);
-            mOutBuffer[0] = static_cast<unsigned int>(responce.size()) & 0xFF;
-            mOutBuffer[1] = (static_cast<unsigned int>(responce.size()) >> 8) & 0xFF;
-            mOutBuffer[2] = (static_cast<unsigned int>(responce.size()) >> 16) & 0xFF;
-            mOutBuffer[3] = (static_cast<unsigned int>(responce.size()) >> 24) & 0xFF;
-            std::copy(responce.begin(), responce.end(), mOutBuffer.begin() + 4);
-
-            boost::asio::async_write(mSocket, boost::asio::buffer(mOutBuffer),
-                boost::bind(&Connection::handleWrite, shared_from_this(), boost::asio::placeholders::error));
         }
     }
 
-    void handleReadHeader(const boost::system::error_code err)
+    boost::asio::awaitable<void> serve(tcp::socket socket)
     {
-        if (err)
+        try
         {
+            for(;;)
+            {
+                std::array<unsigned char, 2> header;
+                co_await boost::asio::async_read(socket, boost::asio::buffer(header), boost::asio::use_awaitable);
+
+                std::string input(static_cast<unsigned int>(header[0]) | static_cast<unsigned int>(header[1]) << 8, '\0');
+                co_await boost::asio::async_read(socket, boost::asio::buffer(input), boost::asio::use_awaitable);
+                std::cout << "Input message: " << input << std::endl;
+
+                boost::property_tree::ptree tree;
+                std::string responce;
+                if(auto answered = answer(input, tree))
+                {
+                    responce = std::move(*answered);
+                }
+                else
+                {
+                    responce = co_await asyncOperate(std::move(tree), boost::asio::use_awaitable);
+                }
+                if(responce.size() > 4294967294)
+                {
+                    std::cout << "Responce size is to big, send error instead" << std::endl;
+                    responce = "Error: responce is to big";
+                }
+                std::string out(4, '\0');
+                out[0] = static_cast<unsigned int>(responce.size()) & 0xFF;
+                out[1] = (static_cast<unsigned int>(responce.size()) >> 8) & 0xFF;
+                out[2] = (static_cast<unsigned int>(responce.size()) >> 16) & 0xFF;
+                out[3] = (static_cast<unsigned int>(responce.size()) >> 24) & 0xFF;
+                out += responce;
+                co_await boost::asio::async_write(socket, boost::asio::buffer(out), boost::asio::use_awaitable);
+
+                if(gQuit)
+                {
+                    mIoContext.stop();
+                    co_return;
+                }
+            }
         }
-        else
+        catch(std::exception&)
         {
-            mInputBuffer.resize(static_cast<unsigned int>(mInputHeader[0]) | static_cast<unsigned int>(mInputHeader[1]) << 8);
-            std::cout << "Input header: " << mInputBuffer.size() << std::endl;
-            boost::asio::async_read(mSocket, boost::asio::buffer(mInputBuffer.data(), mInputBuffer.size()),
-                boost::bind(&Connection::handleRead, shared_from_this(), boost::asio::placeholders::error));
+            //Client closed the connection
         }
     }
 
-    Connection(boost::asio::io_service& ioService)
-        : mSocket(ioService)
+    std::string printProgress()
     {
-        mInputHeader.resize(2);
-    }
-
-    tcp::socket mSocket;
-    std::string mInputBuffer;
-    std::string mOutBuffer;
-    std::string mInputHeader;
-};
+        std::lock_guard<std::mutex> lock(mProgressMutex);
 
-class Server
-{
-    // Message format for this server: 16bit length + content
-public:
-    Server(boost::asio::io_service& ioService)
-        : mAcceptor(ioService, tcp::endpoint(tcp::v4(), 38539))
-        , mIoService(ioService)
-    {
-        startAccept();
-    }
-private:
-    void startAccept()
-    {
-        auto newConn = Connection::create(mIoService);
-        mAcceptor.async_accept(newConn->socket(), boost::bind(&Server::handleAccept, this, newConn, boost::asio::placeholders::error
-            ));
-    }
-
-    void handleAccept(boost::shared_ptr<Connection> conn, const boost::system::error_code err)
-    {
-        if(!err)
+        std::stringstream str;
+        if(mOperation.empty())
+        {
+            str << "Idle";
+        }
+        else
         {
-            conn->start();
+            using Seconds = std::chrono::duration<double>;
+            str << mOperation << " for " << std::fixed << std::setprecision(1) << Seconds(std::chrono::steady_clock::now() - mOperationStart).count() << " s";
         }
+        str << ", " << mNumQueued << " queued";
 
-        startAccept();
+        return str.str();
     }
 
+    boost::asio::io_context& mIoContext;
     tcp::acceptor mAcceptor;
-    boost::asio::io_service& mIoService;
+
+    //Runs the operations changing the host
+    boost::asio::thread_pool mWorker{1};
+    std::mutex mProgressMutex;
+    std::string mOperation;
+    std::chrono::steady_clock::time_point mOperationStart;
+    std::size_t mNumQueued = 0;
 };
 
 int main()
@@ -292,9 +368,9 @@ int main()
     Rng::seed(time(0));
     try
     {
-        boost::asio::io_service service;
-        Server s(service);
-        service.run();
+        boost::asio::io_context ioContext;
+        Server s(ioContext);
+        ioContext.run();
     }
     catch(std::exception& e)
     {
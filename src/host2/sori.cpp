@@ -5,6 +5,7 @@
 #include "tasks/manager.hpp"
 #include "../../sqlite_modern_cpp/hdr/sqlite_modern_cpp.h"
 #include <chrono>
+#include <deque>
 #include <iomanip>
 #include <sstream>
 #include <fstream>
@@ -36,6 +37,9 @@ Config toSoriConfig(const boost::property_tree::ptree& cfg)
     result.numThreads = getOrDefault("numThreads", cfg, result.numThreads);
     result.populationSize = getOrDefault("populationSize", cfg, result.populationSize);
     result.survivalRate = getOrDefault("survivalRate", cfg, result.survivalRate);
+    result.shareTaskInstances = getOrDefault("shareTaskInstances", cfg, result.shareTaskInstances);
+    result.contextsPerTask = getOrDefault("contextsPerTask", cfg, result.contextsPerTask);
+    result.tasksPerGeneration = getOrDefault("tasksPerGeneration", cfg, result.tasksPerGeneration);
 
     return result;
 }
@@ -49,6 +53,9 @@ boost::property_tree::ptree toPtree(const Config& cfg)
     result.put("numThreads", cfg.numThreads);
     result.put("populationSize", cfg.populationSize);
     result.put("survivalRate", cfg.survivalRate);
+    result.put("shareTaskInstances", cfg.shareTaskInstances);
+    result.put("contextsPerTask", cfg.contextsPerTask);
+    result.put("tasksPerGeneration", cfg.tasksPerGeneration);
 
     return result;
 }
@@ -94,14 +101,45 @@ std::stringstream format_duration(std::chrono::milliseconds duration) {
 
 class StatisticsDatabase : public IStatistics
 {
+private:
+    struct StepResultEntry
+    {
+        std::string taskName;
+        std::size_t genNumber;
+        std::size_t energyLimit;
+        int maxScore;
+        int avgScore;
+    };
+
+    struct TaskResultEntry
+    {
+        std::string taskName;
+        std::size_t genNumber;
+        TaskResult result;
+    };
+
 public:
+    //Entries not persisted yet, taken out of the statistics to be written by persist
+    struct Pending
+    {
+        std::vector<StepResultEntry> entries;
+        std::vector<TaskResultEntry> taskResults;
+        std::vector<gacommon::GenerationTimings> timings;
+        std::chrono::milliseconds totalExecutionTime;
+    };
+
     StatisticsDatabase(const std::filesystem::path& dbPath)
-        : mDbPath(dbPath)
     {
-        sqlite::database db(*mDbPath);
+        sqlite::database db(dbPath);
         std::uint64_t ms;
         db << "SELECT val FROM statsValues WHERE name = 'totalExecutionTime'" >> ms;
         mTotalExecutionTime = std::chrono::milliseconds(ms);
+
+        db << "SELECT task, gen, energyLimit, maxScore, avgScore FROM stepResults ORDER BY gen DESC LIMIT ?" << NumRecent >> [this](
+                std::string name, std::size_t gen, std::size_t energyLimit, int maxScore, int avgScore
+            ) {
+            mRecentEntries.push_front({name, gen, energyLimit, maxScore, avgScore});
+        };
     }
 
     StatisticsDatabase()
@@ -111,6 +149,21 @@ public:
     void onStepResult(const std::string& taskName, const std::size_t genNumber, const std::size_t energyLimit, const int maxScore, const int avgScore) override
     {
         mNonPersistEntries.push_back({taskName, genNumber, energyLimit, maxScore, avgScore});
+        mRecentEntries.push_back(mNonPersistEntries.back());
+        if(mRecentEntries.size() > NumRecent)
+        {
+            mRecentEntries.pop_front();
+        }
+    }
+
+    void onGenerationTimings(const gacommon::GenerationTimings& timings) override
+    {
+        mNonPersistTimings.push_back(timings);
+    }
+
+    void onTaskResult(const std::string& taskName, const std::size_t genNumber, const TaskResult& result) override
+    {
+        mNonPersistTaskResults.push_back({taskName, genNumber, result});
     }
 
     void incTimer(const std::chrono::milliseconds& val)
@@ -118,58 +171,91 @@ public:
         mTotalExecutionTime += val;
     }
 
-    void printLatestStatistics(const int number, std::stringstream& stream)
+    //Prints from memory only, it runs after every generation
+    void printLatestStatistics(std::stringstream& stream) const
     {
         stream << "Total execution time: " << format_duration(mTotalExecutionTime).str() << std::endl;
-        int deficit = number - static_cast<int>(mNonPersistEntries.size());
-        for(int i = 0; i < mNonPersistEntries.size() && i < number; ++i)
+        for(auto pos = mRecentEntries.rbegin(); pos != mRecentEntries.rend(); ++pos)
         {
-            print(stream, mNonPersistEntries[mNonPersistEntries.size() - (i + 1)]);
-        }
-        if(deficit > 0 && mDbPath)
-        {
-            sqlite::database db(*mDbPath);
-            db << "SELECT task, gen, energyLimit, maxScore, avgScore FROM stepResults ORDER BY gen DESC LIMIT ?" << deficit >> [&stream](
-                    std::string name, std::size_t gen, std::size_t energyLimit, int maxScore, int avgScore
-                ) {
-                StepResultEntry entry{name, gen, energyLimit, maxScore, avgScore};
-                print(stream, entry);
-            };
+            print(stream, *pos);
         }
     }
 
-    void persist(const std::filesystem::path& path)
+    Pending takePending()
+    {
+        Pending result{std::move(mNonPersistEntries), std::move(mNonPersistTaskResults), std::move(mNonPersistTimings), mTotalExecutionTime};
+
+        mNonPersistEntries.clear();
+        mNonPersistTimings.clear();
+        mNonPersistTaskResults.clear();
+
+        return result;
+    }
+
+    static void persist(const std::filesystem::path& path, const Pending& pending)
     {
-        mDbPath = path;
         sqlite::database db(path);
         db << "CREATE TABLE IF NOT EXISTS stepResults(task text, gen int primary key, energyLimit int, maxScore int, avgScore int)";
         db << "BEGIN";
         auto ins = db << "INSERT INTO stepResults VALUES(?, ?, ?, ?, ?)";
-        for(auto& x : mNonPersistEntries)
+        for(auto& x : pending.entries)
         {
             ins << x.taskName << x.genNumber << x.energyLimit << x.maxScore << x.avgScore;
             ins++;
         }
+        db << "CREATE TABLE IF NOT EXISTS generationTimings(gen int primary key, totalMs real, selectMs real, repopulateMs real, buildAnnMs real, "
+              "evaluateMs real, speciateMs real, sortMs real, checkpointMs real, evaluationsPerSecond real, "
+              "cacheLookups int, cacheHits int, cacheHitRate real)";
+        //Tables created before the fitness cache have no columns for it
+        int numCacheColumns = 0;
+        db << "SELECT count(*) FROM pragma_table_info('generationTimings') WHERE name = 'cacheHitRate'" >> numCacheColumns;
+        if(numCacheColumns == 0)
+        {
+            db << "ALTER TABLE generationTimings ADD COLUMN cacheLookups int";
+            db << "ALTER TABLE generationTimings ADD COLUMN cacheHits int";
+            db << "ALTER TABLE generationTimings ADD COLUMN cacheHitRate real";
+        }
+        db << "CREATE TABLE IF NOT EXISTS threadBusy(gen int, thread int, busyMs real, primary key(gen, thread))";
+        auto insTimings = db << "INSERT OR REPLACE INTO generationTimings VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        auto insBusy = db << "INSERT OR REPLACE INTO threadBusy VALUES(?, ?, ?)";
+        for(auto& x : pending.timings)
+        {
+            using Ms = std::chrono::duration<double, std::milli>;
+            insTimings << x.generation << Ms(x.total).count();
+            for(auto& p : x.phases)
+            {
+                insTimings << Ms(p).count();
+            }
+            insTimings << x.getEvaluationsPerSecond() << x.cacheLookups << x.cacheHits << x.getCacheHitRate();
+            insTimings++;
+
+            for(std::size_t i = 0; i < x.threadBusy.size(); ++i)
+            {
+                insBusy << x.generation << i << Ms(x.threadBusy[i]).count();
+                insBusy++;
+            }
+        }
+        db << "CREATE TABLE IF NOT EXISTS taskResults(gen int, task text, numContexts int, maxMeanScore int, avgMeanScore int, "
+              "maxMinScore int, avgMinScore int, primary key(gen, task))";
+        auto insTaskResult = db << "INSERT OR REPLACE INTO taskResults VALUES(?, ?, ?, ?, ?, ?, ?)";
+        for(auto& x : pending.taskResults)
+        {
+            insTaskResult << x.genNumber << x.taskName << x.result.numContexts << x.result.maxMeanScore << x.result.avgMeanScore
+                          << x.result.maxMinScore << x.result.avgMinScore;
+            insTaskResult++;
+        }
         db << "CREATE TABLE IF NOT EXISTS statsValues(name text primary key, val int)";
-        db << "INSERT OR REPLACE INTO statsValues VALUES('totalExecutionTime', ?)" << mTotalExecutionTime.count();
+        db << "INSERT OR REPLACE INTO statsValues VALUES('totalExecutionTime', ?)" << pending.totalExecutionTime.count();
         db << "COMMIT";
-
-        mNonPersistEntries.clear();
     }
 
 private:
-    struct StepResultEntry
-    {
-        std::string taskName;
-        std::size_t genNumber;
-        std::size_t energyLimit;
-        int maxScore;
-        int avgScore;
-    };
-
     std::vector<StepResultEntry> mNonPersistEntries;
-    std::optional<std::filesystem::path> mDbPath;
-    std::chrono::milliseconds mTotalExecutionTime;
+    std::vector<TaskResultEntry> mNonPersistTaskResults;
+    std::vector<gacommon::GenerationTimings> mNonPersistTimings;
+    static constexpr std::size_t NumRecent = 10;
+    std::deque<StepResultEntry> mRecentEntries;
+    std::chrono::milliseconds mTotalExecutionTime{0};
 };
 
 class Project : public IProject
@@ -188,8 +274,9 @@ public:
     Project(const std::filesystem::path& path, const boost::property_tree::ptree& cfg)
     {
         mTaskManager = std::make_unique<tlib::TaskManager>();
-        Database db(path.string());
-        mImpl = std::make_unique<Sori>(*mTaskManager, db);
+        mDb = std::make_shared<Database>(path.string());
+        mDbPath = path.string();
+        mImpl = std::make_unique<Sori>(*mTaskManager, *mDb);
         mStats = std::make_unique<StatisticsDatabase>(path);
         mImpl->setStatistics(*mStats);
         mCfg = cfg;
@@ -211,10 +298,8 @@ public:
     {
         if(mImpl->getPopulation().size() > idx)
         {
-            auto iter = mImpl->getPopulation().begin();
-            std::advance(iter, idx);
             std::ofstream out(filename, std::ios_base::out);
-            out << iter->print();
+            out << mImpl->getPopulation()[idx].print();
         }
         else
         {
@@ -229,11 +314,22 @@ public:
         mStats->incTimer(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - startTime));
     }
 
-    void saveState(const std::string& fileName) override
+    std::function<void()> snapshotState(const std::string& fileName) override
     {
-        Database db(fileName);
-        mImpl->checkpoint(db);
-        mStats->persist(fileName);
+        //Kept open, the database remembers the pops it holds, so only the graphs of new pops are written
+        if(!mDb || mDbPath != fileName)
+        {
+            mDb = std::make_shared<Database>(fileName);
+            mDbPath = fileName;
+        }
+
+        auto snapshot = std::make_shared<const Snapshot>(mImpl->makeSnapshot());
+        auto stats = std::make_shared<const StatisticsDatabase::Pending>(mStats->takePending());
+        return [db = mDb, snapshot, stats, fileName]()
+        {
+            Sori::writeSnapshot(*snapshot, *db);
+            StatisticsDatabase::persist(fileName, *stats);
+        };
     }
 
     std::string play(const std::size_t popIdx, const std::string& taskName)
@@ -249,15 +345,23 @@ public:
     std::string printRecentStats() const override
     {
         std::stringstream out;
-        mStats->printLatestStatistics(10, out);
+        mStats->printLatestStatistics(out);
         return out.str();
     }
 
+    boost::property_tree::ptree getTimings() const override
+    {
+        return gacommon::toPtree(mImpl->getTimings().getLast());
+    }
+
 private:
     boost::property_tree::ptree mCfg;
     std::unique_ptr<tlib::TaskManager> mTaskManager;
     std::unique_ptr<Sori> mImpl;
     std::unique_ptr<StatisticsDatabase> mStats;
+    //Used by the checkpoint jobs only, one at a time
+    std::shared_ptr<Database> mDb;
+    std::string mDbPath;
 };
 
 std::unique_ptr<IProject> createProject(const boost::property_tree::ptree& config)
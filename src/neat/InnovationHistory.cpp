@@ -1,62 +1,87 @@
 #include "InnovationHistory.hpp"
 #include <stdexcept>
 #include <iostream>
+#include <mutex>
 
 namespace neat
 {
 
-InnovationNumber InnovationHistory::get(const NodeId from, const NodeId to)
+std::uint64_t InnovationHistory::key(const NodeId from, const NodeId to)
 {
-    auto fromPos = mAllConnections.find(from);
+    return (static_cast<std::uint64_t>(from) << 32) | to;
+}
 
-    if(fromPos == mAllConnections.end())
-    {
-        mAllConnections[from][to] = mInnovationNumber;
-        return mInnovationNumber++;
-    }
-    else
+InnovationNumber InnovationHistory::get(const NodeId from, const NodeId to)
+{
+    const auto k = key(from, to);
     {
-        auto toPos = fromPos->second.find(to);
-        if(toPos == fromPos->second.end())
+        std::shared_lock lock(mMutex);
+        auto pos = mByConnection.find(k);
+        if(mIndexed && pos != mByConnection.end())
         {
-            fromPos->second.insert(std::make_pair(to, mInnovationNumber));
-            return mInnovationNumber++;
+            return pos->second;
         }
+    }
 
-        return toPos->second;
+    std::unique_lock lock(mMutex);
+    if(!mIndexed)
+    {
+        buildIndex();
+    }
+    auto [pos, inserted] = mByConnection.try_emplace(k, static_cast<InnovationNumber>(mByNumber.size()));
+    if(inserted)
+    {
+        mByNumber.push_back(std::make_pair(from, to));
     }
+
+    return pos->second;
 }
 
-void InnovationHistory::saveState(std::ofstream& s)
+void InnovationHistory::buildIndex()
 {
-    s.write((char*)&mInnovationNumber, sizeof(InnovationNumber));
-    for(auto x : mAllConnections)
+    mByConnection.clear();
+    mByConnection.reserve(mByNumber.size());
+    for(InnovationNumber i = 0; i < mByNumber.size(); ++i)
     {
-        for(auto y : x.second)
-        {
-            s.write((char*)&x.first, sizeof(NodeId));
-            s.write((char*)&y.first, sizeof(NodeId));
-            s.write((char*)&y.second, sizeof(InnovationNumber));
-        }
+        mByConnection.try_emplace(key(mByNumber[i].first, mByNumber[i].second), i);
     }
+    mIndexed = true;
 }
 
-std::pair<NodeId, NodeId> InnovationHistory::get(const InnovationNumber n) const
+std::size_t InnovationHistory::size() const
+{
+    std::shared_lock lock(mMutex);
+    return mByNumber.size();
+}
+
+void InnovationHistory::assign(std::vector<std::pair<NodeId, NodeId>> connections)
 {
-    if(mCache.size() != 0)
+    std::unique_lock lock(mMutex);
+    mByNumber = std::move(connections);
+    mByConnection.clear();
+    mIndexed = false;
+}
+
+void InnovationHistory::saveState(std::ofstream& s)
+{
+    std::shared_lock lock(mMutex);
+
+    InnovationNumber innovationNumber = mByNumber.size();
+    s.write((char*)&innovationNumber, sizeof(InnovationNumber));
+    for(InnovationNumber i = 0; i < innovationNumber; ++i)
     {
-        return mCache.find(n)->second;
+        s.write((char*)&mByNumber[i].first, sizeof(NodeId));
+        s.write((char*)&mByNumber[i].second, sizeof(NodeId));
+        s.write((char*)&i, sizeof(InnovationNumber));
     }
+}
 
-    for(auto x : mAllConnections)
+std::pair<NodeId, NodeId> InnovationHistory::get(const InnovationNumber n) const
+{
+    std::shared_lock lock(mMutex);
+    if(n < mByNumber.size())
     {
-        for(auto y : x.second)
-        {
-            if(y.second == n)
-            {
-                return std::make_pair(x.first, y.first);
-            }
-        }
+        return mByNumber[n];
     }
 
     throw std::invalid_argument("Innovation number not found");
@@ -64,10 +89,16 @@ std::pair<NodeId, NodeId> InnovationHistory::get(const InnovationNumber n) const
 
 void InnovationHistory::loadState(std::ifstream& s)
 {
-    mAllConnections.clear();
+    std::unique_lock lock(mMutex);
+    mByConnection.clear();
+    mByNumber.clear();
+    mIndexed = true;
 
-    s.read((char*)&mInnovationNumber, sizeof(InnovationNumber));
-    for(InnovationNumber i = 0; i < mInnovationNumber; ++i)
+    InnovationNumber innovationNumber = 0;
+    s.read((char*)&innovationNumber, sizeof(InnovationNumber));
+    mByConnection.reserve(innovationNumber);
+    mByNumber.resize(innovationNumber);
+    for(InnovationNumber i = 0; i < innovationNumber; ++i)
     {
         NodeId a;
         NodeId b;
@@ -77,24 +108,14 @@ void InnovationHistory::loadState(std::ifstream& s)
         s.read((char*)&b, sizeof(NodeId));
         s.read((char*)&numb, sizeof(InnovationNumber));
 
-        mAllConnections[a][b] = numb;
-    }
-}
-
-void InnovationHistory::buildCache()
-{
-    for(auto x : mAllConnections)
-    {
-        for(auto y : x.second)
+        if(numb >= innovationNumber)
         {
-            mCache.insert(std::make_pair(y.second, std::make_pair(x.first, y.first)));
+            throw std::runtime_error("Corrupted innovation history");
         }
+
+        mByConnection[key(a, b)] = numb;
+        mByNumber[numb] = std::make_pair(a, b);
     }
 }
 
-void InnovationHistory::clearCache()
-{
-    mCache.clear();
 }
-
-}
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <map>
 #include <fstream>
 #include <unordered_map>
+#include <vector>
+#include <shared_mutex>
+#include <cstdint>
 
 namespace neat
 {
@@ -9,22 +12,30 @@ namespace neat
 using NodeId = unsigned int;
 using InnovationNumber = unsigned int;
 
+//Safe to use from several threads, lookups only take a shared lock
 class InnovationHistory
 {
 public:
     InnovationNumber get(const NodeId from, const NodeId to);
     std::pair<NodeId, NodeId> get(const InnovationNumber n) const;
 
+    std::size_t size() const;
+    //Connection of every innovation, indexed by innovation number
+    void assign(std::vector<std::pair<NodeId, NodeId>> connections);
+
     void saveState(std::ofstream& s);
     void loadState(std::ifstream& s);
 
-    void buildCache();
-    void clearCache();
-
 private:
-    InnovationNumber mInnovationNumber = 0;
-    std::map<NodeId, std::map<NodeId, InnovationNumber>> mAllConnections;
-    std::unordered_map<InnovationNumber, std::pair<NodeId, NodeId>> mCache;
+    static std::uint64_t key(const NodeId from, const NodeId to);
+    void buildIndex();
+
+    mutable std::shared_mutex mMutex;
+    std::unordered_map<std::uint64_t, InnovationNumber> mByConnection;
+    //Innovation numbers are dense, so index n holds the connection of innovation n
+    std::vector<std::pair<NodeId, NodeId>> mByNumber;
+    //After assign mByConnection is built by the first lookup by connection, which loads do not need
+    bool mIndexed = true;
 };
 
-}
\ No newline at end of file
+}
@@ -1,8 +1,11 @@
 #include "genom.hpp"
 #include "gacommon/rng.hpp"
+#include "gacommon/fitness_cache.hpp"
 #include <algorithm>
+#include <bit>
 #include <numeric>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <iostream>
 namespace neat
@@ -121,6 +124,25 @@ std::size_t Genom::getComplexity() const
     return mGenes.size();
 }
 
+std::uint64_t Genom::getStructuralHash() const
+{
+    //Innovation numbers and connection counts do not change the network, they are left out
+    std::uint64_t result = gacommon::hashCombine(mNumInputs, mNumOutputs);
+    for(auto& n : mNodes)
+    {
+        result = gacommon::hashCombine(result, n.id);
+        result = gacommon::hashCombine(result, static_cast<std::uint64_t>(n.acType));
+    }
+    for(auto& g : mGenes)
+    {
+        result = gacommon::hashCombine(result, g.srcNodeId);
+        result = gacommon::hashCombine(result, g.dstNodeId);
+        result = gacommon::hashCombine(result, std::bit_cast<std::uint64_t>(g.weight));
+    }
+
+    return result;
+}
+
 Genom::ConstConnectionsIterator Genom::begin() const
 {
     return mGenes.begin();
@@ -582,6 +604,37 @@ Genom Genom::read(std::ifstream& s, const NodeId numInputs, const NodeId numOutp
     return g;
 }
 
+Genom Genom::fromGenes(const NodeId numInputs, const NodeId numOutputs, std::span<const ConnectionGene> genes, std::span<const NodeGene> hiddenNodes, const InnovationHistory& history)
+{
+    for(auto& z : genes)
+    {
+        if(z.innovationNumber >= history.size())
+        {
+            throw std::runtime_error("Gene has unknown innovation " + std::to_string(z.innovationNumber));
+        }
+        if(history.get(z.innovationNumber) != std::make_pair(z.srcNodeId, z.dstNodeId))
+        {
+            throw std::runtime_error("Gene does not match innovation " + std::to_string(z.innovationNumber));
+        }
+    }
+
+    Genom g(numInputs, numOutputs);
+    g.mGenes.assign(genes.begin(), genes.end());
+    g.mNodes.assign(hiddenNodes.begin(), hiddenNodes.end());
+
+    return g;
+}
+
+std::span<const ConnectionGene> Genom::getGenes() const
+{
+    return mGenes;
+}
+
+std::span<const NodeGene> Genom::getHiddenNodes() const
+{
+    return mNodes;
+}
+
 void Genom::write(std::ofstream& s) const
 {
     auto genSize = getComplexity();
@@ -621,36 +674,41 @@ const NodeGene& Genom::NodesIterator::operator *() const
 
 std::unique_ptr<gacommon::NeuroNet2> createAnn2(const Genom& g)
 {
-    std::vector<NodeId> inputNodes(g.getNodeCount(neat::v2::Genom::NodeType::Input)); //Always same can be optimized
-    std::vector<NodeId> outputNodes(g.getNodeCount(neat::v2::Genom::NodeType::Output)); //Always same can be optimized
-    std::vector<gacommon::NeuroNet2::HiddenNodeDef> hiddenNodes(g.getNodeCount(neat::v2::Genom::NodeType::Hidden));
-    std::vector<gacommon::NeuroNet2::ConnectionDef> connections(g.getComplexity());
-
-    std::transform(g.beginNodes(neat::v2::Genom::NodeType::Input),
-        g.endNodes(neat::v2::Genom::NodeType::Input),
-        inputNodes.begin(),
-        [](auto x){return x.id;}
-        );
-
-    std::transform(g.beginNodes(neat::v2::Genom::NodeType::Output),
-        g.endNodes(neat::v2::Genom::NodeType::Output),
-        outputNodes.begin(),
-        [](auto x){return x.id;}
-        );
-
-    std::transform(g.beginNodes(neat::v2::Genom::NodeType::Hidden),
-        g.endNodes(neat::v2::Genom::NodeType::Hidden),
-        hiddenNodes.begin(),
-        [](auto x){return gacommon::NeuroNet2::HiddenNodeDef{x.id, x.acType, 0.0};}
-        );
-
-    std::transform(g.begin(),
-        g.end(),
-        connections.begin(),
-        [](auto x){return gacommon::NeuroNet2::ConnectionDef{x.srcNodeId, x.dstNodeId, x.weight};}
-        );
-
-    return std::make_unique<gacommon::NeuroNet2>(inputNodes, outputNodes, hiddenNodes, connections);
+    //Bias, input and output ids are dense so only hidden ids need a lookup.
+    //Index layout is inputs, outputs, hidden - as in NeuroNet2.
+    const NodeId numIO = g.mNumInputs + g.mNumOutputs;
+
+    std::vector<std::pair<NodeId, std::uint16_t>> hiddenIdx;
+    std::vector<ActivationFunctionType> hiddenTypes;
+    hiddenIdx.reserve(g.mNodes.size());
+    hiddenTypes.reserve(g.mNodes.size());
+    for(auto& n : g.mNodes)
+    {
+        hiddenIdx.push_back({n.id, static_cast<std::uint16_t>(numIO + hiddenTypes.size())});
+        hiddenTypes.push_back(n.acType);
+    }
+    std::sort(hiddenIdx.begin(), hiddenIdx.end());
+
+    //Bias and unknown ids land on index 0, same as the id based NeuroNet2 constructor
+    auto toIdx = [&](const NodeId id) -> std::uint16_t
+    {
+        if(id <= numIO)
+        {
+            return id == 0 ? 0 : id - 1;
+        }
+
+        auto pos = std::lower_bound(hiddenIdx.begin(), hiddenIdx.end(), std::make_pair(id, std::uint16_t(0)));
+        return pos != hiddenIdx.end() && pos->first == id ? pos->second : 0;
+    };
+
+    std::vector<gacommon::NeuroNet2::IndexedConnectionDef> connections;
+    connections.reserve(g.mGenes.size());
+    for(auto& c : g.mGenes)
+    {
+        connections.push_back({toIdx(c.srcNodeId), toIdx(c.dstNodeId), c.weight});
+    }
+
+    return std::make_unique<gacommon::NeuroNet2>(g.mNumInputs, g.mNumOutputs, hiddenTypes, connections);
 }
 
 
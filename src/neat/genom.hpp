@@ -1,6 +1,8 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <span>
+#include <cstdint>
 #include "InnovationHistory.hpp"
 #include "gacommon/activation.hpp"
 #include "gacommon/neuro_net2.hpp"
@@ -83,6 +85,7 @@ public:
         mutable NodeGene mFakeGene;
     };
     friend class NodesIterator;
+    friend std::unique_ptr<gacommon::NeuroNet2> createAnn2(const Genom& g);
 
     Genom(const NodeId numInputs, const NodeId numOutputs);
 
@@ -92,10 +95,16 @@ public:
     static Genom crossover(const Genom& a, const Genom& b, const Fitness fitA, const Fitness fitB);
     static double calculateDivergence(const Genom& a, const Genom& b, const double C1_C2, const double C3);
     static Genom read(std::ifstream& s, const NodeId numInputs, const NodeId numOutputs, InnovationHistory& history);
+    //Throws if a gene is not the connection its innovation number stands for in history
+    static Genom fromGenes(const NodeId numInputs, const NodeId numOutputs, std::span<const ConnectionGene> genes, std::span<const NodeGene> hiddenNodes, const InnovationHistory& history);
 
     void write(std::ofstream& s) const;
 
     std::size_t getComplexity() const;
+    //Equal for genomes that build the same network, keys the fitness cache
+    std::uint64_t getStructuralHash() const;
+    std::span<const ConnectionGene> getGenes() const;
+    std::span<const NodeGene> getHiddenNodes() const;
 
     const ConnectionGene& operator[] (const std::size_t index) const;
     void setWeight(const std::size_t index, const double weight);
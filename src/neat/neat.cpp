@@ -8,6 +8,7 @@
 #include <iostream>
 #include <fstream>
 #include <set>
+#include <chrono>
 #include "../logger/Logger.hpp"
 #include "gacommon/neuro_net2.hpp"
 
@@ -40,8 +41,14 @@ std::size_t Neat::getGenerationNumber() const
     return mGeneration;
 }
 
+const gacommon::Timings& Neat::getTimings() const
+{
+    return mTimings;
+}
+
 void Neat::step()
 {
+    mTimings.beginGeneration();
     if(!mPopulation)
     {
         mPopulation.emplace(Population::createInitialPopulation(
@@ -52,13 +59,19 @@ void Neat::step()
             ));
 
         mPopulation->setEvolutionStrategy(mEs);
+        mPopulation->setTimings(mTimings);
     }
     else
     {
-        mPopulation->nextGeneration(mHistory);
+        if(mCfg.numThreads > 1)
+        {
+            gacommon::ensureThreadPool(mPool, mCfg.numThreads);
+        }
+        mPopulation->nextGeneration(mHistory, mCfg.numThreads > 1 ? mPool.get() : nullptr);
     }
 
     updateFitness();
+    mTimings.endGeneration(mGeneration, mCfg.numThreads > 1 ? mPool.get() : nullptr);
     mGeneration++;
 }
 
@@ -75,34 +88,24 @@ int Neat::evaluate(
 {
     for(auto iter = begin; iter != end; ++iter)
     {
-        auto agent = gacommon::NNAgent(mCfg.numInputs, mCfg.numOutputs, createAnn((*iter)->genotype));
+        auto buildStart = std::chrono::steady_clock::now();
+        auto agent = gacommon::NNAgent(mCfg.numInputs, mCfg.numOutputs, createAnn((*iter)->genotype), mCfg.useFloat32Engine);
+        mTimings.add(gacommon::Phase::BuildAnn, std::chrono::steady_clock::now() - buildStart);
         (*iter)->fitness = eval->evaluate(agent);
     }
 
     return 0;
 }
 
-void Neat::evaluateParallel( std::vector<std::vector<Pop>::iterator>& popPtrs, gacommon::IFitnessEvaluator& eval, int numThreads)
+void Neat::evaluateParallel( std::vector<std::vector<Pop>::iterator>& popPtrs, gacommon::IFitnessEvaluator& eval)
 {
-    std::vector<std::thread> threads;
-    for(int i = 0; i < numThreads; ++i)
-    {
-        threads.push_back(std::thread([this, &popPtrs, &eval, numThreads, i](){
-                for(int popidx = 0; popidx < static_cast<int>(popPtrs.size()); ++popidx)
-                {
-                    if(popidx % numThreads == i)
-                    {
-                        auto agent = gacommon::NNAgent(mCfg.numInputs, mCfg.numOutputs, createAnn(popPtrs[popidx]->genotype));
-                        popPtrs[popidx]->fitness = eval.evaluate(agent);
-                    }
-                }
-            }));
-    }
-
-    for(auto& t : threads)
-    {
-        t.join();
-    }
+    gacommon::ensureThreadPool(mPool, mCfg.numThreads);
+    mPool->parallelFor(popPtrs.size(), [&](const std::size_t popidx){
+        auto buildStart = std::chrono::steady_clock::now();
+        auto agent = gacommon::NNAgent(mCfg.numInputs, mCfg.numOutputs, createAnn(popPtrs[popidx]->genotype), mCfg.useFloat32Engine);
+        mTimings.add(gacommon::Phase::BuildAnn, std::chrono::steady_clock::now() - buildStart);
+        popPtrs[popidx]->fitness = eval.evaluate(agent);
+    });
 }
 
 void Neat::updateFitness()
@@ -110,21 +113,48 @@ void Neat::updateFitness()
     std::vector<std::vector<Pop>::iterator> popPtrs;
     popPtrs.reserve(mCfg.populationCfg.size * 2); //x2 is not to reallocate overpopulation
 
-    for(auto& s: (*mPopulation))
     {
-        for(auto iter = s.population.begin(); iter != s.population.end(); ++iter)
+        auto scope = mTimings.measure(gacommon::Phase::Evaluate);
+
+        //Copies of genomes scored on the same challenges take the cached fitness
+        mCache.setChallengeSet(mFitnessEvaluator.getChallengeSetId());
+        std::size_t numLookups = 0;
+        for(auto& s: (*mPopulation))
         {
-            popPtrs.push_back(iter);
+            for(auto iter = s.population.begin(); iter != s.population.end(); ++iter)
+            {
+                if(mCache.isEnabled())
+                {
+                    numLookups++;
+                    if(auto fitness = mCache.find(iter->genotype.getStructuralHash()))
+                    {
+                        iter->fitness = *fitness;
+                        continue;
+                    }
+                }
+                popPtrs.push_back(iter);
+            }
         }
-    }
 
-    if(mCfg.numThreads > 1)
-    {
-        evaluateParallel(popPtrs, mFitnessEvaluator, mCfg.numThreads);
-    }
-    else
-    {
-        evaluate(&mFitnessEvaluator, popPtrs.begin(), popPtrs.end());
+        if(mCfg.numThreads > 1)
+        {
+            evaluateParallel(popPtrs, mFitnessEvaluator);
+        }
+        else
+        {
+            evaluate(&mFitnessEvaluator, popPtrs.begin(), popPtrs.end());
+        }
+        mTimings.addEvaluations(popPtrs.size());
+
+        if(mCache.isEnabled())
+        {
+            for(auto& p : popPtrs)
+            {
+                mCache.store(p->genotype.getStructuralHash(), p->fitness);
+            }
+            mTimings.addCacheLookups(numLookups, numLookups - popPtrs.size());
+        }
+        mCache.endGeneration();
     }
 
     mPopulation->onEvaluationFinished();
@@ -155,27 +185,53 @@ const Population& Neat::getPopulation() const
 
 void Neat::saveState(const std::string& fileName)
 {
-    std::ofstream ofile(fileName, std::ios::binary | std::ios::trunc);
-
-    ofile << mGeneration;
-    mHistory.saveState(ofile);
-    if(mPopulation)
-    {
-        mPopulation->saveState(ofile);
-    }
+    auto scope = mTimings.measure(gacommon::Phase::Checkpoint);
+
+    PopulationSnapshot::write(
+        fileName,
+        mGeneration,
+        mHistory,
+        mPopulation ? &*mPopulation : nullptr,
+        mCfg.numInputs,
+        mCfg.numOutputs
+        );
 }
 
 void Neat::loadState(const std::string& fileName)
 {
+    if(PopulationSnapshot::isSnapshot(fileName))
+    {
+        PopulationSnapshot snapshot(fileName);
+        if(snapshot.getNumInputs() != mCfg.numInputs || snapshot.getNumOutputs() != mCfg.numOutputs)
+        {
+            throw std::runtime_error("Snapshot " + fileName + " was saved for a different number of inputs or outputs");
+        }
+
+        std::vector<std::pair<NodeId, NodeId>> innovations;
+        innovations.reserve(snapshot.getInnovations().size());
+        for(auto& i : snapshot.getInnovations())
+        {
+            innovations.emplace_back(i.from, i.to);
+        }
+
+        mGeneration = snapshot.getGeneration();
+        mHistory.assign(std::move(innovations));
+        mPopulation.emplace(mCfg.populationCfg);
+        mPopulation->setEvolutionStrategy(mEs);
+        mPopulation->setTimings(mTimings);
+        mPopulation->loadState(snapshot, mHistory);
+        return;
+    }
+
+    //Stream format written before snapshots
     std::ifstream ifile(fileName, std::ios::binary);
 
     ifile >> mGeneration;
     mHistory.loadState(ifile);
-    mHistory.buildCache();
     mPopulation.emplace(mCfg.populationCfg);
     mPopulation->setEvolutionStrategy(mEs);
+    mPopulation->setTimings(mTimings);
     mPopulation->loadState(ifile, mHistory, mCfg.numInputs, mCfg.numOutputs);
-    mHistory.clearCache();
 }
 
 void Neat::reconfigure(const Config& cfg, const EvolutionStrategyType esType)
@@ -197,6 +253,9 @@ void Neat::reconfigure(const Config& cfg, const EvolutionStrategyType esType)
     mCfg.numInputs = oldNumInputs;
     mCfg.numOutputs = oldNumOutputs;
 
+    //The engine may have changed, which changes fitness slightly
+    mCache.clear();
+
     if(mPopulation)
     {
         mPopulation->reconfigure(mCfg.populationCfg);
@@ -3,6 +3,8 @@
 #include "genom.hpp"
 #include <optional>
 #include "gacommon/IPlayground.hpp"
+#include "gacommon/thread_pool.hpp"
+#include "gacommon/fitness_cache.hpp"
 
 namespace neat
 {
@@ -18,6 +20,7 @@ struct Config
     unsigned int numInputs;
     unsigned int numOutputs;
     unsigned int numThreads; 
+    bool useFloat32Engine = false;
     v2::MutationConfig mutationCfg;
     Population::Config populationCfg;
 };
@@ -40,6 +43,7 @@ public:
     std::unique_ptr<gacommon::NeuroNet2> createAnn(const v2::Genom& src) const;
 
     std::size_t getGenerationNumber() const;
+    const gacommon::Timings& getTimings() const;
 
 private:
 
@@ -50,7 +54,7 @@ private:
         std::vector<std::vector<Pop>::iterator>::iterator begin, 
         std::vector<std::vector<Pop>::iterator>::iterator end
         );
-    void evaluateParallel( std::vector<std::vector<Pop>::iterator>& popPtrs, gacommon::IFitnessEvaluator& eval, int numThreads);
+    void evaluateParallel( std::vector<std::vector<Pop>::iterator>& popPtrs, gacommon::IFitnessEvaluator& eval);
 
     Config mCfg;
     gacommon::IFitnessEvaluator& mFitnessEvaluator;
@@ -59,6 +63,9 @@ private:
     std::optional<Population> mPopulation;
     InnovationHistory mHistory;
     std::size_t mGeneration = 1;
+    std::unique_ptr<gacommon::ThreadPool> mPool;
+    gacommon::Timings mTimings;
+    gacommon::FitnessCache mCache;
 };
 
 }
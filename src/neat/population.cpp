@@ -2,6 +2,9 @@
 #include "gacommon/rng.hpp"
 #include <algorithm>
 #include <numeric>
+#include <bit>
+#include <limits>
+#include <optional>
 #include <iostream>
 #include <string>
 #include "../logger/Logger.hpp"
@@ -14,6 +17,48 @@ bool comparePopsByFitness(const Pop& a, const Pop& b)
    return a.fitness > b.fitness;
 }
 
+namespace
+{
+
+//64 bit summary of the innovation numbers of a genom. A bit set in only one of two
+//sketches stands for at least one gene missing from the other genom.
+struct InnovationSketch
+{
+   std::uint64_t bits = 0;
+   std::size_t numGenes = 0;
+};
+
+InnovationSketch makeSketch(const v2::Genom& g)
+{
+   InnovationSketch sketch;
+   for(auto& gene : g)
+   {
+      sketch.bits |= 1ull << ((gene.innovationNumber * 0x9E3779B97F4A7C15ull) >> 58);
+   }
+   sketch.numGenes = g.getComplexity();
+
+   return sketch;
+}
+
+std::optional<gacommon::Timings::Scope> measure(gacommon::Timings* timings, const gacommon::Phase phase)
+{
+   if(timings)
+   {
+      return std::optional<gacommon::Timings::Scope>(std::in_place, *timings, phase);
+   }
+
+   return std::nullopt;
+}
+
+//Lower bound of the number of disjoint and excess genes of two genoms
+std::size_t minDisjointAndExcess(const InnovationSketch& a, const InnovationSketch& b)
+{
+   auto sizeDiff = a.numGenes > b.numGenes ? a.numGenes - b.numGenes : b.numGenes - a.numGenes;
+   return std::max<std::size_t>(sizeDiff, std::popcount(a.bits ^ b.bits));
+}
+
+}
+
 Population Population::createInitialPopulation(
    const NodeId numInputs, 
    const NodeId numOutputs, 
@@ -44,6 +89,7 @@ double Specie::getSharedFitness() const
 
 void Population::onEvaluationFinished()
 {
+   auto scope = measure(mTimings, gacommon::Phase::Sort);
    for(auto& s : mSpecies)
    {
       s.updateFitness();
@@ -201,7 +247,7 @@ void Specie::produceOffsprings(
 
 unsigned int Speciation::genNewSpecieId(const std::vector<Specie>& species)
 {
-   return std::max_element(species.begin(), species.end(), [] (auto x, auto y){return x.id < y.id;})->id + 1;
+   return std::max_element(species.begin(), species.end(), [] (auto& x, auto& y){return x.id < y.id;})->id + 1;
 }
 
 void Population::reconfigure(const Config& config)
@@ -214,52 +260,103 @@ void Speciation::respeciate(
    const std::vector<v2::Genom>& genoms, 
    const double compatibilityFactor,
    const double C1_C2,
-   const double C3
+   const double C3,
+   gacommon::ThreadPool* pool
    )
 {
+   constexpr std::size_t NoSpecie = std::numeric_limits<std::size_t>::max();
+
    for(auto& s : species)
    {
       s.population.clear();
    }
 
-   for(auto& g : genoms)
+   //Divergence is never below the sketch bound when both factors are non negative,
+   //so skipping a specie on the bound does not change the outcome
+   const bool usePrefilter = C1_C2 >= 0 && C3 >= 0;
+
+   std::vector<InnovationSketch> specieSketches;
+   for(auto& s : species)
+   {
+      specieSketches.push_back(makeSketch(s.representor->genotype));
+   }
+
+   std::vector<InnovationSketch> genomSketches(genoms.size());
+   std::vector<std::size_t> bestSpecie(genoms.size(), NoSpecie);
+   std::vector<double> bestDistance(genoms.size(), compatibilityFactor);
+
+   auto compare = [&](const std::size_t genomIdx, const std::size_t specieIdx)
+   {
+      if(usePrefilter && minDisjointAndExcess(genomSketches[genomIdx], specieSketches[specieIdx]) * C1_C2 >= bestDistance[genomIdx])
+      {
+         return;
+      }
+
+      auto distance = v2::Genom::calculateDivergence(genoms[genomIdx], species[specieIdx].representor->genotype, C1_C2, C3);
+      if(distance < bestDistance[genomIdx])
+      {
+         bestSpecie[genomIdx] = specieIdx;
+         bestDistance[genomIdx] = distance;
+      }
+   };
+
+   //Matching against the existing species is independent per genom
+   const std::size_t numExistingSpecies = species.size();
+   auto matchExisting = [&](const std::size_t genomIdx)
+   {
+      genomSketches[genomIdx] = makeSketch(genoms[genomIdx]);
+      for(std::size_t i = 0; i < numExistingSpecies; ++i)
+      {
+         compare(genomIdx, i);
+      }
+   };
+
+   if(pool)
+   {
+      pool->parallelFor(genoms.size(), matchExisting);
+   }
+   else
+   {
+      for(std::size_t i = 0; i < genoms.size(); ++i)
+      {
+         matchExisting(i);
+      }
+   }
+
+   //Species founded during this pass are only visible to later genoms, so this part stays in order
+   for(std::size_t g = 0; g < genoms.size(); ++g)
    {
-      Specie* mostCompatibleSpecie = nullptr;
-      double bestDistance = compatibilityFactor;
-      for(auto& s : species)
+      for(std::size_t i = numExistingSpecies; i < species.size(); ++i)
       {
-         auto distance = v2::Genom::calculateDivergence(g, s.representor->genotype, C1_C2, C3);
-         if(distance < bestDistance)
-         {
-            mostCompatibleSpecie = &s;
-            bestDistance = distance;
-         }
+         compare(g, i);
       }
 
-      if(mostCompatibleSpecie == nullptr)
+      if(bestSpecie[g] == NoSpecie)
       {
-         Pop p {0, g};
+         Pop p {0, genoms[g]};
          Specie s;
          s.id = genNewSpecieId(species);
          s.maxFitness = 0;
          s.representor = p;
          s.population.push_back(p);
          species.push_back(s);
+         specieSketches.push_back(genomSketches[g]);
       }
       else
       {
-         mostCompatibleSpecie->population.push_back({0, g});
+         species[bestSpecie[g]].population.push_back({0, genoms[g]});
       }
    }
 
    //remove extinct
-   species.erase(std::remove_if(species.begin(), species.end(), [](auto x){return x.population.empty();}), species.end());
+   species.erase(std::remove_if(species.begin(), species.end(), [](auto& x){return x.population.empty();}), species.end());
 }
 
-void Population::nextGeneration(InnovationHistory& history)
+void Population::nextGeneration(InnovationHistory& history, gacommon::ThreadPool* pool)
 {
    std::vector<v2::Genom> newGenoms;
 
+   auto selectScope = measure(mTimings, gacommon::Phase::Select);
    for(auto& s : mSpecies)
    {
       s.selectRepresentor();
@@ -278,6 +375,9 @@ void Population::nextGeneration(InnovationHistory& history)
    mEs->setGenerationResults(getAverageFitness(), mAverageComplexity);
    
    std::vector<unsigned int> quotas = getSpeciesOffspringQuotas();
+   selectScope.reset();
+
+   auto repopulateScope = measure(mTimings, gacommon::Phase::Repopulate);
 
    newGenoms.reserve(mCfg.size);
 
@@ -314,7 +414,10 @@ void Population::nextGeneration(InnovationHistory& history)
        newGenoms.push_back(p1.genotype);
    }
 
-   Speciation::respeciate(mSpecies, newGenoms, mCfg.mCompatibilityFactor, mCfg.mC1_C2, mCfg.mC3);
+   repopulateScope.reset();
+
+   auto speciateScope = measure(mTimings, gacommon::Phase::Speciate);
+   Speciation::respeciate(mSpecies, newGenoms, mCfg.mCompatibilityFactor, mCfg.mC1_C2, mCfg.mC3, pool);
 }
 
 const Specie& Population::operator[] (const std::size_t index) const
@@ -454,6 +557,37 @@ void Population::loadState(
    }
 }
 
+void Population::loadState(const PopulationSnapshot& snapshot, const InnovationHistory& history)
+{
+   mSpecies.clear();
+   mSpecies.reserve(snapshot.getSpecies().size());
+   for(auto& s : snapshot.getSpecies())
+   {
+      Specie x;
+      x.id = s.id;
+      x.numStagnant = s.numStagnant;
+      x.maxFitness = s.maxFitness;
+      x.totalFitness = s.totalFitness;
+      x.maxAverageFitness = s.maxAverageFitness;
+      x.sharedFitness = s.sharedFitness;
+
+      auto pops = snapshot.getPops(s);
+      x.population.reserve(pops.size());
+      for(auto& p : pops)
+      {
+         x.population.push_back({p.fitness, v2::Genom::fromGenes(
+            snapshot.getNumInputs(),
+            snapshot.getNumOutputs(),
+            snapshot.getGenes(p),
+            snapshot.getHiddenNodes(p),
+            history
+            )});
+      }
+
+      mSpecies.push_back(std::move(x));
+   }
+}
+
 void Population::setEvolutionStrategy(std::shared_ptr<IEvolutionStrategy>& es)
 {
    mEs = es;
@@ -461,6 +595,11 @@ void Population::setEvolutionStrategy(std::shared_ptr<IEvolutionStrategy>& es)
    std::cout << mEs->getAllowedMutations().addNodeMutationChance << " " << mEs->getAllowedMutations().addConnectionMutationChance;
 }
 
+void Population::setTimings(gacommon::Timings& timings)
+{
+   mTimings = &timings;
+}
+
 double Population::getAverageComplexity() const
 {
    return mAverageComplexity;
@@ -1,8 +1,11 @@
 #pragma once
 #include "genom.hpp"
+#include "snapshot.hpp"
 #include <optional>
 #include <memory>
 #include "EvolutionStrategy.hpp"
+#include "gacommon/thread_pool.hpp"
+#include "gacommon/timings.hpp"
 
 namespace neat
 {
@@ -47,7 +50,8 @@ public:
       const std::vector<v2::Genom>& genoms, 
       const double compatibilityFactor,
       const double C1_C2,
-      const double C3
+      const double C3,
+      gacommon::ThreadPool* pool = nullptr
       );
 
 private:
@@ -88,7 +92,7 @@ public:
    double getAverageFitness() const;
    double getAverageComplexity() const;
 
-   void nextGeneration(InnovationHistory& history);
+   void nextGeneration(InnovationHistory& history, gacommon::ThreadPool* pool = nullptr);
    void onEvaluationFinished();
 
    void saveState(std::ofstream& s);
@@ -98,6 +102,7 @@ public:
       const NodeId numInputs, 
       const NodeId numOutputs
       );
+   void loadState(const PopulationSnapshot& snapshot, const InnovationHistory& history);
 
    static Population createInitialPopulation(
       const NodeId numInputs, 
@@ -107,6 +112,7 @@ public:
       );
 
    void setEvolutionStrategy(std::shared_ptr<IEvolutionStrategy>& es);
+   void setTimings(gacommon::Timings& timings);
 
 private:
    std::vector<unsigned int> getSpeciesOffspringQuotas();
@@ -119,5 +125,6 @@ private:
    double mMaxComplexity = 0.0;
    unsigned int mNumStagnantGenerations = 0;
    std::shared_ptr<IEvolutionStrategy> mEs;
+   gacommon::Timings* mTimings = nullptr;
 };
 }
@@ -0,0 +1,279 @@
+#include "snapshot.hpp"
+#include "population.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace neat
+{
+
+static constexpr char Magic[8] = {'N', 'E', 'A', 'T', 'S', 'N', 'A', 'P'};
+
+//Records are read in place, so they have to be plain bytes
+static_assert(std::is_trivially_copyable_v<snapshot::Header>);
+static_assert(std::is_trivially_copyable_v<snapshot::Innovation>);
+static_assert(std::is_trivially_copyable_v<snapshot::Specie>);
+static_assert(std::is_trivially_copyable_v<snapshot::Pop>);
+static_assert(std::is_trivially_copyable_v<v2::ConnectionGene>);
+static_assert(std::is_trivially_copyable_v<v2::NodeGene>);
+
+static std::uint64_t align(const std::uint64_t offset)
+{
+    return (offset + 7) & ~std::uint64_t(7);
+}
+
+PopulationSnapshot::PopulationSnapshot(const std::string& fileName)
+{
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if(fd == -1)
+    {
+        throw std::runtime_error("Unable to open " + fileName);
+    }
+
+    struct stat st;
+    if(::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(snapshot::Header))
+    {
+        ::close(fd);
+        throw std::runtime_error(fileName + " is not a snapshot");
+    }
+
+    mSize = st.st_size;
+    mData = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mData == MAP_FAILED)
+    {
+        mData = nullptr;
+        throw std::runtime_error("Unable to map " + fileName);
+    }
+
+    try
+    {
+        mHeader = static_cast<const snapshot::Header*>(mData);
+        if(std::memcmp(mHeader->magic, Magic, sizeof(Magic)) != 0)
+        {
+            throw std::runtime_error(fileName + " is not a snapshot");
+        }
+        if(mHeader->version != Version)
+        {
+            throw std::runtime_error("Snapshot version " + std::to_string(mHeader->version) + " is not supported");
+        }
+
+        mInnovations = getSection<snapshot::Innovation>(mHeader->innovations);
+        mSpecies = getSection<snapshot::Specie>(mHeader->species);
+        mPops = getSection<snapshot::Pop>(mHeader->pops);
+        mGenes = getSection<v2::ConnectionGene>(mHeader->genes);
+        mNodes = getSection<v2::NodeGene>(mHeader->nodes);
+
+        //Ranges are checked once here, so the getters can slice without checks
+        for(auto& s : mSpecies)
+        {
+            if(s.firstPop > mPops.size() || s.numPops > mPops.size() - s.firstPop)
+            {
+                throw std::runtime_error("Snapshot specie " + std::to_string(s.id) + " is out of bounds");
+            }
+        }
+        for(auto& p : mPops)
+        {
+            if(p.firstGene > mGenes.size() || p.numGenes > mGenes.size() - p.firstGene ||
+               p.firstNode > mNodes.size() || p.numNodes > mNodes.size() - p.firstNode)
+            {
+                throw std::runtime_error("Snapshot pop is out of bounds");
+            }
+        }
+    }
+    catch(...)
+    {
+        ::munmap(mData, mSize);
+        throw;
+    }
+}
+
+PopulationSnapshot::~PopulationSnapshot()
+{
+    ::munmap(mData, mSize);
+}
+
+template<class T>
+std::span<const T> PopulationSnapshot::getSection(const snapshot::Section& section) const
+{
+    if(section.offset % alignof(T) != 0 ||
+       section.offset > mSize ||
+       section.count > (mSize - section.offset) / sizeof(T))
+    {
+        throw std::runtime_error("Snapshot section is out of bounds");
+    }
+
+    return {reinterpret_cast<const T*>(static_cast<const char*>(mData) + section.offset), section.count};
+}
+
+bool PopulationSnapshot::isSnapshot(const std::string& fileName)
+{
+    std::ifstream ifile(fileName, std::ios::binary);
+
+    char magic[sizeof(Magic)] = {};
+    ifile.read(magic, sizeof(magic));
+
+    return ifile && std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+}
+
+void PopulationSnapshot::write(
+    const std::string& fileName,
+    const std::size_t generation,
+    const InnovationHistory& history,
+    const Population* population,
+    const NodeId numInputs,
+    const NodeId numOutputs
+    )
+{
+    std::vector<snapshot::Innovation> innovations(history.size());
+    for(InnovationNumber i = 0; i < innovations.size(); ++i)
+    {
+        auto c = history.get(i);
+        innovations[i] = {c.first, c.second};
+    }
+
+    std::vector<snapshot::Specie> species;
+    std::vector<snapshot::Pop> pops;
+    std::uint64_t numGenes = 0;
+    std::uint64_t numNodes = 0;
+    if(population)
+    {
+        species.reserve(population->numSpecies());
+        pops.reserve(population->size());
+        for(auto& s : *population)
+        {
+            species.push_back({s.id, s.numStagnant, s.maxFitness, s.totalFitness, s.maxAverageFitness, s.sharedFitness, pops.size(), s.population.size()});
+            for(auto& p : s.population)
+            {
+                auto genes = p.genotype.getGenes();
+                auto nodes = p.genotype.getHiddenNodes();
+                pops.push_back({p.fitness, 0, numGenes, genes.size(), numNodes, nodes.size()});
+                numGenes += genes.size();
+                numNodes += nodes.size();
+            }
+        }
+    }
+
+    snapshot::Header header = {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.numInputs = numInputs;
+    header.numOutputs = numOutputs;
+    header.generation = generation;
+
+    std::uint64_t offset = align(sizeof(header));
+    auto place = [&offset](snapshot::Section& section, const std::uint64_t count, const std::size_t size)
+    {
+        section = {offset, count};
+        offset = align(offset + count * size);
+    };
+    place(header.innovations, innovations.size(), sizeof(snapshot::Innovation));
+    place(header.species, species.size(), sizeof(snapshot::Specie));
+    place(header.pops, pops.size(), sizeof(snapshot::Pop));
+    place(header.genes, numGenes, sizeof(v2::ConnectionGene));
+    place(header.nodes, numNodes, sizeof(v2::NodeGene));
+
+    //Written next to the file and renamed over it, so readers that have the old file mapped keep it
+    //and a failed save leaves the old state in place
+    const auto tmpName = fileName + ".tmp";
+    std::ofstream ofile(tmpName, std::ios::binary | std::ios::trunc);
+    if(!ofile)
+    {
+        throw std::runtime_error("Unable to write " + tmpName);
+    }
+
+    auto writeAt = [&ofile](const std::uint64_t offset, const void* data, const std::size_t size)
+    {
+        static const char zeros[8] = {};
+        ofile.write(zeros, offset - static_cast<std::uint64_t>(ofile.tellp()));
+        ofile.write(static_cast<const char*>(data), size);
+    };
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.innovations.offset, innovations.data(), innovations.size() * sizeof(snapshot::Innovation));
+    writeAt(header.species.offset, species.data(), species.size() * sizeof(snapshot::Specie));
+    writeAt(header.pops.offset, pops.data(), pops.size() * sizeof(snapshot::Pop));
+
+    //Genes and nodes are copied straight from the genoms, without a staging buffer
+    writeAt(header.genes.offset, nullptr, 0);
+    if(population)
+    {
+        for(auto& s : *population)
+        {
+            for(auto& p : s.population)
+            {
+                auto genes = p.genotype.getGenes();
+                ofile.write(reinterpret_cast<const char*>(genes.data()), genes.size_bytes());
+            }
+        }
+    }
+    writeAt(header.nodes.offset, nullptr, 0);
+    if(population)
+    {
+        for(auto& s : *population)
+        {
+            for(auto& p : s.population)
+            {
+                auto nodes = p.genotype.getHiddenNodes();
+                ofile.write(reinterpret_cast<const char*>(nodes.data()), nodes.size_bytes());
+            }
+        }
+    }
+
+    ofile.flush();
+    ofile.close();
+    if(!ofile)
+    {
+        std::filesystem::remove(tmpName);
+        throw std::runtime_error("Unable to write " + tmpName);
+    }
+
+    std::filesystem::rename(tmpName, fileName);
+}
+
+std::size_t PopulationSnapshot::getGeneration() const
+{
+    return mHeader->generation;
+}
+
+NodeId PopulationSnapshot::getNumInputs() const
+{
+    return mHeader->numInputs;
+}
+
+NodeId PopulationSnapshot::getNumOutputs() const
+{
+    return mHeader->numOutputs;
+}
+
+std::span<const snapshot::Innovation> PopulationSnapshot::getInnovations() const
+{
+    return mInnovations;
+}
+
+std::span<const snapshot::Specie> PopulationSnapshot::getSpecies() const
+{
+    return mSpecies;
+}
+
+std::span<const snapshot::Pop> PopulationSnapshot::getPops(const snapshot::Specie& specie) const
+{
+    return mPops.subspan(specie.firstPop, specie.numPops);
+}
+
+std::span<const v2::ConnectionGene> PopulationSnapshot::getGenes(const snapshot::Pop& pop) const
+{
+    return mGenes.subspan(pop.firstGene, pop.numGenes);
+}
+
+std::span<const v2::NodeGene> PopulationSnapshot::getHiddenNodes(const snapshot::Pop& pop) const
+{
+    return mNodes.subspan(pop.firstNode, pop.numNodes);
+}
+
+}
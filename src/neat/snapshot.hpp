@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include "genom.hpp"
+
+namespace neat
+{
+
+class Population;
+
+//Layout of a saved Neat state, made to be mapped into memory and used as it is. The header points to
+//sections, each an array of the records below at an 8 byte aligned offset from the start of the file.
+//Records are kept in the byte order and layout of the machine that wrote them
+namespace snapshot
+{
+
+struct Section
+{
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t numInputs;
+    std::uint32_t numOutputs;
+    std::uint32_t reserved;
+    std::uint64_t generation;
+    //Innovation, indexed by innovation number
+    Section innovations;
+    Section species;
+    Section pops;
+    //v2::ConnectionGene and v2::NodeGene, the hidden nodes of every pop
+    Section genes;
+    Section nodes;
+};
+
+struct Innovation
+{
+    NodeId from;
+    NodeId to;
+};
+
+struct Specie
+{
+    unsigned int id;
+    unsigned int numStagnant;
+    Fitness maxFitness;
+    Fitness totalFitness;
+    double maxAverageFitness;
+    double sharedFitness;
+    //Range in the pops section
+    std::uint64_t firstPop;
+    std::uint64_t numPops;
+};
+
+struct Pop
+{
+    Fitness fitness;
+    std::uint32_t reserved;
+    //Ranges in the genes and nodes sections
+    std::uint64_t firstGene;
+    std::uint64_t numGenes;
+    std::uint64_t firstNode;
+    std::uint64_t numNodes;
+};
+
+}
+
+//Read only view of a snapshot file. The file is mapped once and the section offsets are turned into
+//pointers, nothing is copied. Spans returned by the view are valid as long as the view is
+class PopulationSnapshot
+{
+public:
+    static constexpr std::uint32_t Version = 1;
+
+    //Throws if the file is not a snapshot or its sections do not fit in it
+    explicit PopulationSnapshot(const std::string& fileName);
+    ~PopulationSnapshot();
+    PopulationSnapshot(const PopulationSnapshot&) = delete;
+    PopulationSnapshot& operator=(const PopulationSnapshot&) = delete;
+
+    //False for the stream format written before snapshots
+    static bool isSnapshot(const std::string& fileName);
+    static void write(
+        const std::string& fileName,
+        const std::size_t generation,
+        const InnovationHistory& history,
+        const Population* population,
+        const NodeId numInputs,
+        const NodeId numOutputs
+        );
+
+    std::size_t getGeneration() const;
+    NodeId getNumInputs() const;
+    NodeId getNumOutputs() const;
+
+    std::span<const snapshot::Innovation> getInnovations() const;
+    std::span<const snapshot::Specie> getSpecies() const;
+    std::span<const snapshot::Pop> getPops(const snapshot::Specie& specie) const;
+    std::span<const v2::ConnectionGene> getGenes(const snapshot::Pop& pop) const;
+    std::span<const v2::NodeGene> getHiddenNodes(const snapshot::Pop& pop) const;
+
+private:
+    template<class T>
+    std::span<const T> getSection(const snapshot::Section& section) const;
+
+    void* mData = nullptr;
+    std::size_t mSize = 0;
+
+    const snapshot::Header* mHeader = nullptr;
+    std::span<const snapshot::Innovation> mInnovations;
+    std::span<const snapshot::Specie> mSpecies;
+    std::span<const snapshot::Pop> mPops;
+    std::span<const v2::ConnectionGene> mGenes;
+    std::span<const v2::NodeGene> mNodes;
+};
+
+}
@@ -13,6 +13,7 @@ public:
    CalculatorFitnessEvaluator()
        : mInputs({gacommon::ValueIO(), gacommon::ValueIO(), gacommon::ChoiceIO{4}})
        , mOutputs({gacommon::ValueIO{}})
+       , mSchema(mInputs, mOutputs)
    {
        updateChallenges();
    }
@@ -23,24 +24,60 @@ public:
    }
 
    gacommon::Fitness evaluate(gacommon::IAgent& agent) override
+   {
+      return evaluateChallenges(agent, 0, mChallenges.size());
+   }
+
+   std::size_t getNumChallenges() const override
+   {
+      return mChallenges.size();
+   }
+
+   std::optional<std::uint64_t> getChallengeSetId() const override
+   {
+      return mChallengeSetId;
+   }
+
+   gacommon::Fitness getMaxChallengesScore(const std::size_t first, const std::size_t last) const override
    {
       gacommon::Fitness result = 0;
+      for(std::size_t i = first; i < last; ++i)
+      {
+          auto op = mChallenges[i].op;
+          result += op == Operation::Div ? 3 : op == Operation::Mult ? 2 : 1;
+      }
 
-      for(auto c : mChallenges)
+      return result;
+   }
+
+   gacommon::Fitness evaluateChallenges(gacommon::IAgent& agent, const std::size_t first, const std::size_t last) override
+   {
+      gacommon::Fitness result = 0;
+
+      //Evaluations run in parallel, buffers are reused per thread
+      thread_local std::vector<double> inputs;
+      thread_local std::vector<double> outputs;
+      const auto numSamples = last - first;
+      inputs.resize(numSamples * mSchema.getNumInputs());
+      outputs.resize(numSamples * mSchema.getNumOutputs());
+      for(std::size_t i = first; i < last; ++i)
       {
-          auto inputs = getInputs();
-          auto outputs = getOutputs();
+          auto& c = mChallenges[i];
+          auto sample = inputs.data() + (i - first) * mSchema.getNumInputs();
 
-          std::get<gacommon::ValueIO>(inputs[0]).value = static_cast<double>(c.a);
-          std::get<gacommon::ValueIO>(inputs[1]).value = static_cast<double>(c.b);
-          std::get<gacommon::ChoiceIO>(inputs[2]).selection = static_cast<std::size_t>(c.op);
+          mSchema.setValue(sample, 0, static_cast<double>(c.a));
+          mSchema.setValue(sample, 1, static_cast<double>(c.b));
+          mSchema.setChoice(sample, 2, static_cast<std::size_t>(c.op));
+      }
 
-          auto expected = runChallenge(c);
+      agent.runFlat(mSchema, inputs, outputs, numSamples);
 
-          agent.reset();
-          agent.run(inputs, outputs);
+      for(std::size_t i = first; i < last; ++i)
+      {
+          auto& c = mChallenges[i];
+          auto expected = runChallenge(c);
 
-          if(expected == floor(std::get<gacommon::ValueIO>(outputs[0]).value))
+          if(expected == floor(mSchema.getValue(outputs.data() + (i - first) * mSchema.getNumOutputs(), 0)))
           {
               result++;
               if(c.op == Operation::Mult)
@@ -132,6 +169,7 @@ private:
 
    void updateChallenges()
    {
+       mChallengeSetId++;
        mChallenges.clear();
        for(int i = 0; i < 25; ++i)
        {
@@ -178,8 +216,10 @@ private:
    }
 
    std::vector<Challenge> mChallenges;
+   std::uint64_t mChallengeSetId = 0;
    std::vector<gacommon::IOElement> mInputs;
    std::vector<gacommon::IOElement> mOutputs;
+   gacommon::IOSchema mSchema;
 };
 
 gacommon::IFitnessEvaluator& CalculatorPG::getFitnessEvaluator()
@@ -12,6 +12,7 @@ public:
    LogicalFitnessEvaluator()
        : mInputs({gacommon::ValueIO(), gacommon::ValueIO(), gacommon::ChoiceIO{4}})
        , mOutputs({gacommon::ChoiceIO{2}})
+       , mSchema(mInputs, mOutputs)
    {
        mChallenges.push_back({0, 0, Operation::Or});
        mChallenges.push_back({0, 1, Operation::Or});
@@ -36,24 +37,54 @@ public:
    }
    
    gacommon::Fitness evaluate(gacommon::IAgent& agent) override
+   {
+      return evaluateChallenges(agent, 0, mChallenges.size());
+   }
+
+   std::size_t getNumChallenges() const override
+   {
+      return mChallenges.size();
+   }
+
+   std::optional<std::uint64_t> getChallengeSetId() const override
+   {
+      //Challenges never change
+      return 0;
+   }
+
+   gacommon::Fitness getMaxChallengesScore(const std::size_t first, const std::size_t last) const override
+   {
+      return static_cast<gacommon::Fitness>(last - first);
+   }
+
+   gacommon::Fitness evaluateChallenges(gacommon::IAgent& agent, const std::size_t first, const std::size_t last) override
    {
       gacommon::Fitness result = 0;
-      
-      for(auto c : mChallenges)
+
+      //Evaluations run in parallel, buffers are reused per thread
+      thread_local std::vector<double> inputs;
+      thread_local std::vector<double> outputs;
+      const auto numSamples = last - first;
+      inputs.resize(numSamples * mSchema.getNumInputs());
+      outputs.resize(numSamples * mSchema.getNumOutputs());
+      for(std::size_t i = first; i < last; ++i)
       {
-          auto inputs = getInputs();
-          auto outputs = getOutputs();
+          auto& c = mChallenges[i];
+          auto sample = inputs.data() + (i - first) * mSchema.getNumInputs();
 
-          std::get<gacommon::ValueIO>(inputs[0]).value = static_cast<double>(c.a);
-          std::get<gacommon::ValueIO>(inputs[1]).value = static_cast<double>(c.b);
-          std::get<gacommon::ChoiceIO>(inputs[2]).selection = static_cast<std::size_t>(c.op);
+          mSchema.setValue(sample, 0, static_cast<double>(c.a));
+          mSchema.setValue(sample, 1, static_cast<double>(c.b));
+          mSchema.setChoice(sample, 2, static_cast<std::size_t>(c.op));
+      }
 
-          auto expected = runChallenge(c);
+      agent.runFlat(mSchema, inputs, outputs, numSamples);
 
-          agent.reset();
-          agent.run(inputs, outputs);
+      for(std::size_t i = first; i < last; ++i)
+      {
+          auto& c = mChallenges[i];
+          auto expected = runChallenge(c);
 
-          if(expected == std::get<gacommon::ChoiceIO>(outputs[0]).selection)
+          if(expected == mSchema.getChoice(outputs.data() + (i - first) * mSchema.getNumOutputs(), 0))
           {
               result++;
           } 
@@ -154,6 +185,7 @@ private:
    std::vector<Challenge> mChallenges;
    std::vector<gacommon::IOElement> mInputs;
    std::vector<gacommon::IOElement> mOutputs;
+   gacommon::IOSchema mSchema;
 };
 
 gacommon::IFitnessEvaluator& LogicalPG::getFitnessEvaluator()
@@ -1,8 +1,10 @@
 #include "system.hpp"
 #include "gacommon/IPlayground.hpp"
 #include <algorithm>
+#include <limits>
 #include <memory>
-#include <map>
+#include <string>
+#include <unordered_map>
 
 namespace snake4
 {
@@ -15,12 +17,13 @@ public:
        , mPrevActivated(false)
        , mNextActivationsAttempts(1)
    {
+       internElements();
    }
 
    void reset() override
    {
        mPrevActivated = false;
-       mElements.clear();
+       std::fill(mElements.begin(), mElements.end(), 0);
        mBlockedSteps = 0;
        mForceMultiplier = 0;
        mNextActivationsAttempts = 1;
@@ -28,8 +31,10 @@ public:
 
    void run(const std::vector<gacommon::IOElement>& inputs, std::vector<gacommon::IOElement>& outputs) override
    {
-       for(const auto& b : mBlocks)
+       for(std::size_t blockIdx = 0; blockIdx < mBlocks.size(); ++blockIdx)
        {
+           const auto& b = mBlocks[blockIdx];
+           const auto& symbols = mBlockSymbols[blockIdx];
            if(mBlockedSteps > 0)
            {
                mPrevActivated = false;
@@ -43,10 +48,10 @@ public:
            for(int i = 0; i < thisActivationAttempts; i++)
            {
                mForceMultiplier = 1;
-               if(std::visit([&inputs, this](auto && arg){return processActivator(inputs, arg);}, b.activator))
+               if(std::visit([&inputs, &symbols, this](auto && arg){return processActivator(inputs, arg, symbols);}, b.activator))
                {
                    mPrevActivated = true;
-                   std::visit([&outputs, this](auto && arg){return processForce(outputs, arg);}, b.force);
+                   std::visit([&outputs, &symbols, this](auto && arg){return processForce(outputs, arg, symbols);}, b.force);
                }
                else
                {
@@ -62,6 +67,106 @@ public:
    }
 
 private:
+   //Elements are interned per agent. Only the ones named by consume activators are ever looked up, so they and
+   //the empty name, which is what was last consumed before anything was, get ids. Everything else is counted in Untracked
+   using ElementId = std::uint32_t;
+   static constexpr ElementId NoElement = std::numeric_limits<ElementId>::max();
+
+   struct BlockSymbols
+   {
+       ElementId left = NoElement;
+       ElementId right = NoElement;
+       ElementId produced = NoElement;
+       //Offset of the decompositions for this block's split position
+       std::size_t decompositions = 0;
+   };
+
+   void internElements()
+   {
+       std::unordered_map<std::string, ElementId> ids;
+       std::vector<std::string> names;
+       auto intern = [&](const std::string& name)
+       {
+           auto [pos, inserted] = ids.try_emplace(name, static_cast<ElementId>(names.size()));
+           if(inserted)
+           {
+               names.push_back(name);
+           }
+           return pos->second;
+       };
+
+       mLastConsumed1 = intern("");
+       mLastConsumed2 = mLastConsumed1;
+       mBlockSymbols.resize(mBlocks.size());
+       for(std::size_t i = 0; i < mBlocks.size(); ++i)
+       {
+           if(auto act = std::get_if<ConsumeActivator>(&mBlocks[i].activator))
+           {
+               mBlockSymbols[i].left = intern(act->left);
+               mBlockSymbols[i].right = intern(act->right);
+           }
+       }
+
+       mUntracked = static_cast<ElementId>(names.size());
+       mElements.assign(names.size() + 1, 0);
+       auto find = [&](const std::string& name)
+       {
+           auto pos = ids.find(name);
+           return pos != ids.end() ? pos->second : mUntracked;
+       };
+
+       const auto numTracked = names.size();
+       mCombinations.resize(numTracked * numTracked);
+       for(std::size_t a = 0; a < numTracked; ++a)
+       {
+           for(std::size_t b = 0; b < numTracked; ++b)
+           {
+               mCombinations[a * numTracked + b] = find(names[a] + names[b]);
+           }
+       }
+
+       //One table per distinct split position
+       std::unordered_map<std::size_t, std::size_t> decompositionOffsets;
+       for(std::size_t i = 0; i < mBlocks.size(); ++i)
+       {
+           if(auto& force = mBlocks[i].force; std::holds_alternative<ProduceForce>(force))
+           {
+               mBlockSymbols[i].produced = find(std::get<ProduceForce>(force).primitive);
+           }
+           else if(std::holds_alternative<DecomposeForce>(force))
+           {
+               const auto pos = std::get<DecomposeForce>(force).pos;
+               auto [offset, inserted] = decompositionOffsets.try_emplace(pos, mDecompositions.size());
+               if(inserted)
+               {
+                   for(const auto& name : names)
+                   {
+                       if(pos < name.size())
+                       {
+                           mDecompositions.push_back({find(name.substr(0, pos)), find(name.substr(pos, std::string::npos))});
+                       }
+                       else
+                       {
+                           mDecompositions.push_back({find(name), NoElement});
+                       }
+                   }
+               }
+               mBlockSymbols[i].decompositions = offset->second;
+           }
+       }
+   }
+
+   template<class T>
+   bool processActivator(const std::vector<gacommon::IOElement>& inputs, const T& act, const BlockSymbols& symbols)
+   {
+       return processActivator(inputs, act);
+   }
+
+   template<class T>
+   void processForce(std::vector<gacommon::IOElement>& outputs, const T& force, const BlockSymbols& symbols)
+   {
+       processForce(outputs, force);
+   }
 
    bool processActivator(const std::vector<gacommon::IOElement>& inputs, const AlwaysActivator& act)
    {
@@ -73,21 +178,21 @@ private:
        return mPrevActivated;
    }
 
-   bool processActivator(const std::vector<gacommon::IOElement>& inputs, const ConsumeActivator& act)
+   bool processActivator(const std::vector<gacommon::IOElement>& inputs, const ConsumeActivator& act, const BlockSymbols& symbols)
    {
-       auto pos1 = mElements.find(act.left);
-       auto pos2 = mElements.find(act.right);
-       if(pos1 != mElements.end() && pos2 != mElements.end() && pos1->second > 0 && pos2->second > 0)
+       auto& amount1 = mElements[symbols.left];
+       auto& amount2 = mElements[symbols.right];
+       if(amount1 > 0 && amount2 > 0)
        {
-           if(pos1 == pos2 && pos1->second < 2)
+           if(symbols.left == symbols.right && amount1 < 2)
            {
                return false;
            }
 
-           pos1->second--;
-           pos2->second--;
-           mLastConsumed1 = pos1->first;
-           mLastConsumed2 = pos2->first;
+           amount1--;
+           amount2--;
+           mLastConsumed1 = symbols.left;
+           mLastConsumed2 = symbols.right;
            return true;
        }
        return false;
@@ -165,37 +270,28 @@ private:
 
    void processForce(std::vector<gacommon::IOElement>& outputs, const CombineForce& force)
    {
-       mElements[mLastConsumed1 + mLastConsumed2]++;
+       mElements[mCombinations[mLastConsumed1 * mUntracked + mLastConsumed2]]++;
    }
 
    void processForce(std::vector<gacommon::IOElement>& outputs, const SinkForce& force)
    {
    }
 
-   void processForce(std::vector<gacommon::IOElement>& outputs, const ProduceForce& force)
+   void processForce(std::vector<gacommon::IOElement>& outputs, const ProduceForce& force, const BlockSymbols& symbols)
    {
-       mElements[force.primitive] += 2 * mForceMultiplier;
+       mElements[symbols.produced] += 2 * mForceMultiplier;
    }
 
-   void processForce(std::vector<gacommon::IOElement>& outputs, const DecomposeForce& force)
+   void processForce(std::vector<gacommon::IOElement>& outputs, const DecomposeForce& force, const BlockSymbols& symbols)
    {
-       if(force.pos < mLastConsumed1.size())
-       {
-           mElements[mLastConsumed1.substr(0, force.pos)]++;
-           mElements[mLastConsumed1.substr(force.pos, std::string::npos)]++;
-       }
-       else
-       {
-           mElements[mLastConsumed1]++;
-       }
-       if(force.pos < mLastConsumed2.size())
+       for(auto consumed : {mLastConsumed1, mLastConsumed2})
        {
-           mElements[mLastConsumed2.substr(0, force.pos)]++;
-           mElements[mLastConsumed2.substr(force.pos, std::string::npos)]++;
-       }
-       else
-       {
-           mElements[mLastConsumed2]++;
+           const auto& parts = mDecompositions[symbols.decompositions + consumed];
+           mElements[parts.first]++;
+           if(parts.second != NoElement)
+           {
+               mElements[parts.second]++;
+           }
        }
    }
 
@@ -214,9 +310,16 @@ private:
    std::size_t mBlockedSteps = 0;
    std::size_t mNextActivationsAttempts = 1;
    unsigned int mForceMultiplier = 0;
-   std::string mLastConsumed1;
-   std::string mLastConsumed2;
-   std::map<std::string, std::size_t> mElements;
+   ElementId mLastConsumed1 = 0;
+   ElementId mLastConsumed2 = 0;
+   //Amount of every element, indexed by id, the last one is Untracked
+   std::vector<std::size_t> mElements;
+   ElementId mUntracked = 0;
+   std::vector<BlockSymbols> mBlockSymbols;
+   //Element made of two consumed elements, indexed by first * mUntracked + second
+   std::vector<ElementId> mCombinations;
+   //Parts of every consumed element for the split positions of the decompose forces
+   std::vector<std::pair<ElementId, ElementId>> mDecompositions;
 };
 
 std::unique_ptr<gacommon::IAgent> createAgentImpl(const gacommon::IODefinition& io, const std::vector<BlockDefinition>& blocks)
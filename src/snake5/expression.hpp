@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+namespace snake5
+{
+
+using ValueType = std::variant<bool, double, std::vector<std::uint8_t>>;
+using ExprId = std::size_t;
+static constexpr ExprId INVALID_ID = 0;
+
+enum class ExpressionType
+{
+    InputTranslate,
+    OutputTranslate,
+    Constant,
+    //Random,
+    BinaryOr,
+    BinaryAnd,
+    BinaryNot,
+    LogicalAnd,
+    LogicalOr,
+    LogicalNot,
+    Greater,
+    Less,
+    Equals,
+    Plus,
+    Minus,
+    Multiply,
+    Divide,
+    //Match
+    Select
+};
+
+//InputTranslate reads input in1id, OutputTranslate writes expression in1id to output in2id,
+//other expressions take the results of expressions in1id, in2id and in3id
+struct Expression
+{
+    ExprId id;
+    ExpressionType type;
+
+    ExprId in1id = INVALID_ID;
+    ExprId in2id = INVALID_ID;
+    ExprId in3id = INVALID_ID;
+    ValueType constant = false;
+};
+
+}
@@ -0,0 +1,459 @@
+#include "program.hpp"
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace snake5
+{
+
+namespace
+{
+
+enum class Type
+{
+    Bool,
+    Number,
+    Bitmap
+};
+
+struct Register
+{
+    Type type;
+    std::uint32_t index;
+};
+
+}
+
+Program Program::compile(const std::vector<Expression>& expressions, const gacommon::IODefinition& io)
+{
+    Program result;
+    result.mCode.reserve(expressions.size());
+
+    std::unordered_map<ExprId, Register> registers;
+
+    auto alloc = [&result](const Type type) -> Register
+    {
+        switch(type)
+        {
+            case Type::Bool:
+                result.mBools.push_back(false);
+                return {type, static_cast<std::uint32_t>(result.mBools.size() - 1)};
+
+            case Type::Number:
+                result.mNumbers.push_back(0.0);
+                return {type, static_cast<std::uint32_t>(result.mNumbers.size() - 1)};
+
+            case Type::Bitmap:
+                result.mBitmaps.emplace_back();
+                return {type, static_cast<std::uint32_t>(result.mBitmaps.size() - 1)};
+        }
+
+        throw std::logic_error("Unknown type");
+    };
+
+    auto fail = [](const Expression& e, const std::string& reason)
+    {
+        throw std::runtime_error("Expression " + std::to_string(e.id) + " " + reason);
+    };
+
+    auto operand = [&](const Expression& e, const ExprId id)
+    {
+        auto pos = registers.find(id);
+        if(pos == registers.end())
+        {
+            fail(e, "uses undefined expression " + std::to_string(id));
+        }
+
+        return pos->second;
+    };
+
+    auto expect = [&](const Expression& e, const Register r, const Type type)
+    {
+        if(r.type != type)
+        {
+            fail(e, "has operands of wrong types");
+        }
+    };
+
+    //Bitmap operands are combined element by element
+    auto expectSameSize = [&](const Expression& e, const Register a, const Register b)
+    {
+        if(a.type == Type::Bitmap && result.mBitmaps[a.index].size() != result.mBitmaps[b.index].size())
+        {
+            fail(e, "combines bitmaps of different sizes");
+        }
+    };
+
+    auto emit = [&result](const OpCode op, const Register dst, const std::uint32_t a, const std::uint32_t b = 0, const std::uint32_t c = 0)
+    {
+        result.mCode.push_back({op, dst.index, a, b, c});
+    };
+
+    for(const auto& e : expressions)
+    {
+        if(registers.count(e.id) != 0)
+        {
+            fail(e, "is defined twice");
+        }
+
+        Register dst{Type::Bool, 0};
+        switch(e.type)
+        {
+            case ExpressionType::InputTranslate:
+            {
+                if(e.in1id >= io.inputs.size())
+                {
+                    fail(e, "reads a missing input");
+                }
+
+                std::visit([&](auto&& input)
+                {
+                    using T = std::decay_t<decltype(input)>;
+                    if constexpr(std::is_same_v<gacommon::ValueIO, T>)
+                    {
+                        dst = alloc(Type::Number);
+                        emit(OpCode::LoadValue, dst, e.in1id);
+                    }
+                    else if constexpr(std::is_same_v<gacommon::ChoiceIO, T>)
+                    {
+                        dst = alloc(Type::Number);
+                        emit(OpCode::LoadChoice, dst, e.in1id);
+                    }
+                    else if constexpr(std::is_same_v<gacommon::BitmapIO, T>)
+                    {
+                        dst = alloc(Type::Bitmap);
+                        result.mBitmaps[dst.index].resize(input.width * input.heigth);
+                        emit(OpCode::LoadBitmap, dst, e.in1id);
+                    }
+                }, io.inputs[e.in1id]);
+                break;
+            }
+
+            case ExpressionType::OutputTranslate:
+            {
+                auto value = operand(e, e.in1id);
+                if(e.in2id >= io.outputs.size())
+                {
+                    fail(e, "writes a missing output");
+                }
+
+                std::visit([&](auto&& output)
+                {
+                    using T = std::decay_t<decltype(output)>;
+                    if constexpr(std::is_same_v<gacommon::ValueIO, T>)
+                    {
+                        if(value.type == Type::Bitmap)
+                        {
+                            fail(e, "writes a bitmap to a value output");
+                        }
+                        emit(value.type == Type::Bool ? OpCode::StoreBool : OpCode::StoreValue, value, e.in2id);
+                    }
+                    else if constexpr(std::is_same_v<gacommon::ChoiceIO, T>)
+                    {
+                        expect(e, value, Type::Number);
+                        if(output.options == 0)
+                        {
+                            fail(e, "writes to a choice without options");
+                        }
+                        emit(OpCode::StoreChoice, value, e.in2id);
+                    }
+                    else if constexpr(std::is_same_v<gacommon::BitmapIO, T>)
+                    {
+                        expect(e, value, Type::Bitmap);
+                        emit(OpCode::StoreBitmap, value, e.in2id);
+                    }
+                }, io.outputs[e.in2id]);
+
+                //Outputs are not operands of other expressions
+                continue;
+            }
+
+            case ExpressionType::Constant:
+            {
+                std::visit([&](auto&& constant)
+                {
+                    using T = std::decay_t<decltype(constant)>;
+                    if constexpr(std::is_same_v<bool, T>)
+                    {
+                        dst = alloc(Type::Bool);
+                        result.mBools[dst.index] = constant;
+                    }
+                    else if constexpr(std::is_same_v<double, T>)
+                    {
+                        dst = alloc(Type::Number);
+                        result.mNumbers[dst.index] = constant;
+                    }
+                    else
+                    {
+                        dst = alloc(Type::Bitmap);
+                        result.mBitmaps[dst.index] = constant;
+                    }
+                }, e.constant);
+                break;
+            }
+
+            case ExpressionType::BinaryOr:
+            case ExpressionType::BinaryAnd:
+            {
+                auto a = operand(e, e.in1id);
+                auto b = operand(e, e.in2id);
+                expect(e, a, Type::Bitmap);
+                expect(e, b, Type::Bitmap);
+                expectSameSize(e, a, b);
+
+                dst = alloc(Type::Bitmap);
+                result.mBitmaps[dst.index].resize(result.mBitmaps[a.index].size());
+                emit(e.type == ExpressionType::BinaryOr ? OpCode::BitmapOr : OpCode::BitmapAnd, dst, a.index, b.index);
+                break;
+            }
+
+            case ExpressionType::BinaryNot:
+            {
+                auto a = operand(e, e.in1id);
+                expect(e, a, Type::Bitmap);
+
+                dst = alloc(Type::Bitmap);
+                result.mBitmaps[dst.index].resize(result.mBitmaps[a.index].size());
+                emit(OpCode::BitmapNot, dst, a.index);
+                break;
+            }
+
+            case ExpressionType::LogicalAnd:
+            case ExpressionType::LogicalOr:
+            {
+                auto a = operand(e, e.in1id);
+                auto b = operand(e, e.in2id);
+                expect(e, a, Type::Bool);
+                expect(e, b, Type::Bool);
+
+                dst = alloc(Type::Bool);
+                emit(e.type == ExpressionType::LogicalAnd ? OpCode::BoolAnd : OpCode::BoolOr, dst, a.index, b.index);
+                break;
+            }
+
+            case ExpressionType::LogicalNot:
+            {
+                auto a = operand(e, e.in1id);
+                expect(e, a, Type::Bool);
+
+                dst = alloc(Type::Bool);
+                emit(OpCode::BoolNot, dst, a.index);
+                break;
+            }
+
+            case ExpressionType::Greater:
+            case ExpressionType::Less:
+            {
+                auto a = operand(e, e.in1id);
+                auto b = operand(e, e.in2id);
+                expect(e, a, Type::Number);
+                expect(e, b, Type::Number);
+
+                dst = alloc(Type::Bool);
+                emit(e.type == ExpressionType::Greater ? OpCode::Greater : OpCode::Less, dst, a.index, b.index);
+                break;
+            }
+
+            case ExpressionType::Equals:
+            {
+                auto a = operand(e, e.in1id);
+                auto b = operand(e, e.in2id);
+                expect(e, b, a.type);
+                expectSameSize(e, a, b);
+
+                dst = alloc(Type::Bool);
+                const auto op = a.type == Type::Bool ? OpCode::EqualsBool : a.type == Type::Number ? OpCode::EqualsNumber : OpCode::EqualsBitmap;
+                emit(op, dst, a.index, b.index);
+                break;
+            }
+
+            case ExpressionType::Plus:
+            case ExpressionType::Minus:
+            case ExpressionType::Multiply:
+            case ExpressionType::Divide:
+            {
+                auto a = operand(e, e.in1id);
+                auto b = operand(e, e.in2id);
+                expect(e, a, Type::Number);
+                expect(e, b, Type::Number);
+
+                dst = alloc(Type::Number);
+                const auto op =
+                    e.type == ExpressionType::Plus ? OpCode::Plus :
+                    e.type == ExpressionType::Minus ? OpCode::Minus :
+                    e.type == ExpressionType::Multiply ? OpCode::Multiply :
+                    OpCode::Divide;
+                emit(op, dst, a.index, b.index);
+                break;
+            }
+
+            case ExpressionType::Select:
+            {
+                auto condition = operand(e, e.in1id);
+                auto a = operand(e, e.in2id);
+                auto b = operand(e, e.in3id);
+                expect(e, condition, Type::Bool);
+                expect(e, b, a.type);
+                expectSameSize(e, a, b);
+
+                dst = alloc(a.type);
+                if(a.type == Type::Bitmap)
+                {
+                    result.mBitmaps[dst.index].resize(result.mBitmaps[a.index].size());
+                }
+                const auto op = a.type == Type::Bool ? OpCode::SelectBool : a.type == Type::Number ? OpCode::SelectNumber : OpCode::SelectBitmap;
+                emit(op, dst, condition.index, a.index, b.index);
+                break;
+            }
+        }
+
+        registers.emplace(e.id, dst);
+    }
+
+    return result;
+}
+
+void Program::run(const std::vector<gacommon::IOElement>& inputs, std::vector<gacommon::IOElement>& outputs)
+{
+    //Byte stores may alias anything, so the bitmap loops work on local pointers to stay vectorized
+    for(const auto& i : mCode)
+    {
+        switch(i.op)
+        {
+            case OpCode::LoadValue:
+                mNumbers[i.dst] = std::get<gacommon::ValueIO>(inputs[i.a]).value;
+                break;
+
+            case OpCode::LoadChoice:
+                mNumbers[i.dst] = std::get<gacommon::ChoiceIO>(inputs[i.a]).selection;
+                break;
+
+            case OpCode::LoadBitmap:
+                //Same size as at compile time, so the register keeps its buffer
+                mBitmaps[i.dst].assign(std::get<gacommon::BitmapIO>(inputs[i.a]).map.begin(), std::get<gacommon::BitmapIO>(inputs[i.a]).map.end());
+                break;
+
+            case OpCode::StoreValue:
+                std::get<gacommon::ValueIO>(outputs[i.a]).value = mNumbers[i.dst];
+                break;
+
+            case OpCode::StoreBool:
+                std::get<gacommon::ValueIO>(outputs[i.a]).value = mBools[i.dst] ? 1.0 : 0.0;
+                break;
+
+            case OpCode::StoreChoice:
+            {
+                auto& choice = std::get<gacommon::ChoiceIO>(outputs[i.a]);
+                choice.selection = mNumbers[i.dst] > 0 ? static_cast<std::size_t>(mNumbers[i.dst]) % choice.options : 0;
+                break;
+            }
+
+            case OpCode::StoreBitmap:
+                std::get<gacommon::BitmapIO>(outputs[i.a]).map.assign(mBitmaps[i.dst].begin(), mBitmaps[i.dst].end());
+                break;
+
+            case OpCode::BitmapOr:
+            {
+                auto* dst = mBitmaps[i.dst].data();
+                const auto* a = mBitmaps[i.a].data();
+                const auto* b = mBitmaps[i.b].data();
+                for(std::size_t k = 0, size = mBitmaps[i.dst].size(); k < size; ++k)
+                {
+                    dst[k] = a[k] | b[k];
+                }
+                break;
+            }
+
+            case OpCode::BitmapAnd:
+            {
+                auto* dst = mBitmaps[i.dst].data();
+                const auto* a = mBitmaps[i.a].data();
+                const auto* b = mBitmaps[i.b].data();
+                for(std::size_t k = 0, size = mBitmaps[i.dst].size(); k < size; ++k)
+                {
+                    dst[k] = a[k] & b[k];
+                }
+                break;
+            }
+
+            case OpCode::BitmapNot:
+            {
+                auto* dst = mBitmaps[i.dst].data();
+                const auto* a = mBitmaps[i.a].data();
+                for(std::size_t k = 0, size = mBitmaps[i.dst].size(); k < size; ++k)
+                {
+                    dst[k] = ~a[k];
+                }
+                break;
+            }
+
+            case OpCode::BoolAnd:
+                mBools[i.dst] = mBools[i.a] && mBools[i.b];
+                break;
+
+            case OpCode::BoolOr:
+                mBools[i.dst] = mBools[i.a] || mBools[i.b];
+                break;
+
+            case OpCode::BoolNot:
+                mBools[i.dst] = !mBools[i.a];
+                break;
+
+            case OpCode::Greater:
+                mBools[i.dst] = mNumbers[i.a] > mNumbers[i.b];
+                break;
+
+            case OpCode::Less:
+                mBools[i.dst] = mNumbers[i.a] < mNumbers[i.b];
+                break;
+
+            case OpCode::EqualsBool:
+                mBools[i.dst] = mBools[i.a] == mBools[i.b];
+                break;
+
+            case OpCode::EqualsNumber:
+                mBools[i.dst] = mNumbers[i.a] == mNumbers[i.b];
+                break;
+
+            case OpCode::EqualsBitmap:
+                mBools[i.dst] = mBitmaps[i.a] == mBitmaps[i.b];
+                break;
+
+            case OpCode::Plus:
+                mNumbers[i.dst] = mNumbers[i.a] + mNumbers[i.b];
+                break;
+
+            case OpCode::Minus:
+                mNumbers[i.dst] = mNumbers[i.a] - mNumbers[i.b];
+                break;
+
+            case OpCode::Multiply:
+                mNumbers[i.dst] = mNumbers[i.a] * mNumbers[i.b];
+                break;
+
+            case OpCode::Divide:
+                mNumbers[i.dst] = mNumbers[i.b] != 0.0 ? mNumbers[i.a] / mNumbers[i.b] : 0.0;
+                break;
+
+            case OpCode::SelectBool:
+                mBools[i.dst] = mBools[i.a] ? mBools[i.b] : mBools[i.c];
+                break;
+
+            case OpCode::SelectNumber:
+                mNumbers[i.dst] = mBools[i.a] ? mNumbers[i.b] : mNumbers[i.c];
+                break;
+
+            case OpCode::SelectBitmap:
+                //Registers of one size, the copy reuses the buffer of dst
+                mBitmaps[i.dst] = mBools[i.a] ? mBitmaps[i.b] : mBitmaps[i.c];
+                break;
+        }
+    }
+}
+
+std::size_t Program::size() const
+{
+    return mCode.size();
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <gacommon/natural_selection.hpp>
+#include "expression.hpp"
+
+namespace snake5
+{
+
+//Expressions compiled for one IODefinition. Every expression gets a register of its result type, so
+//the code runs without variants, and bitmap registers are sized at compile time, so it runs without allocations
+class Program
+{
+public:
+    //Throws if an expression has operands of wrong types or refers to something undefined
+    static Program compile(const std::vector<Expression>& expressions, const gacommon::IODefinition& io);
+
+    //Inputs and outputs have to be laid out as the IODefinition the program was compiled for
+    void run(const std::vector<gacommon::IOElement>& inputs, std::vector<gacommon::IOElement>& outputs);
+
+    std::size_t size() const;
+
+private:
+    enum class OpCode : std::uint8_t
+    {
+        LoadValue,
+        LoadChoice,
+        LoadBitmap,
+        StoreValue,
+        StoreBool,
+        StoreChoice,
+        StoreBitmap,
+        BitmapOr,
+        BitmapAnd,
+        BitmapNot,
+        BoolAnd,
+        BoolOr,
+        BoolNot,
+        Greater,
+        Less,
+        EqualsBool,
+        EqualsNumber,
+        EqualsBitmap,
+        Plus,
+        Minus,
+        Multiply,
+        Divide,
+        SelectBool,
+        SelectNumber,
+        SelectBitmap
+    };
+
+    //dst and the operands are registers of the types the opcode works on, loads and stores use an io index instead
+    struct Instruction
+    {
+        OpCode op;
+        std::uint32_t dst;
+        std::uint32_t a;
+        std::uint32_t b;
+        std::uint32_t c;
+    };
+
+    std::vector<Instruction> mCode;
+    //Constants are preloaded into registers nothing writes to
+    std::vector<char> mBools;
+    std::vector<double> mNumbers;
+    std::vector<std::vector<std::uint8_t>> mBitmaps;
+};
+
+}
@@ -66,6 +66,12 @@ void StaticObjectDetection::draw(dng::Image& surface) const
     }
 }
 
+std::unique_ptr<sori::TaskContext> StaticObjectDetection::clone() const
+{
+    //Shapes are immutable and shared, only the scoring state is copied
+    return std::make_unique<StaticObjectDetection>(*this);
+}
+
 ObjectDetection1::ObjectDetection1(const dng::Size& envSize)
     : StaticObjectDetection({std::make_shared<dng::Rectangle>(genCoordsToFit(envSize, {10, 10}), dng::Size{10, 10}, dng::colors::Blue)}, dng::colors::Black)
 {
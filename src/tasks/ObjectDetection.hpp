@@ -13,6 +13,7 @@ public:
     void onClick(const dng::Point& pos) override;
     int getScore() const override;
     void draw(dng::Image& surface) const override;
+    std::unique_ptr<sori::TaskContext> clone() const override;
 
 private:
     const std::vector<std::shared_ptr<dng::Shape>> mShapes;
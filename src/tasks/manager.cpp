@@ -58,10 +58,9 @@ void TaskManager::dumpDemoPictures(const std::filesystem::path& dirName) const
     }
 }
 
-sori::ITask& TaskManager::pickNextTask(const sori::TaskScores& taskScores)
+static std::vector<TaskDefinition> getCandidates(const sori::TaskScores& taskScores)
 {
     //Policy here is task is elegible if it has no prerequisites or at least one of the prerequisites is reached specified score
-    //If task is maxed it got only 10% chance to be used
     std::vector<TaskDefinition> candidates;
 
     for(auto& d : gAllTasks)
@@ -82,22 +81,50 @@ sori::ITask& TaskManager::pickNextTask(const sori::TaskScores& taskScores)
         }
     }
 
+    return candidates;
+}
+
+static std::size_t pickCandidate(const std::vector<TaskDefinition>& candidates, const sori::TaskScores& taskScores)
+{
+    //If task is maxed it got only 10% chance to be used
     while(true)
     {
-        const auto& randomCandidate = candidates[Rng::genChoise(candidates.size())];
-        auto pos = taskScores.find(randomCandidate.task->getName());
-        if(pos != taskScores.end() && pos->second >= randomCandidate.task->getSolvedScore())
+        const auto pos = Rng::genChoise(candidates.size());
+        const auto& randomCandidate = candidates[pos];
+        auto score = taskScores.find(randomCandidate.task->getName());
+        if(score != taskScores.end() && score->second >= randomCandidate.task->getSolvedScore())
         {
             if(Rng::genProbability(0.1))
             {
-                return *randomCandidate.task;
+                return pos;
             }
         }
         else
         {
-            return *randomCandidate.task;
+            return pos;
         }
     }
 }
 
+sori::ITask& TaskManager::pickNextTask(const sori::TaskScores& taskScores)
+{
+    auto candidates = getCandidates(taskScores);
+    return *candidates[pickCandidate(candidates, taskScores)].task;
+}
+
+std::vector<sori::ITask*> TaskManager::pickNextTasks(const sori::TaskScores& taskScores, const std::size_t num)
+{
+    //Same policy, without repeating a task
+    std::vector<sori::ITask*> result;
+    auto candidates = getCandidates(taskScores);
+    while(result.size() < num && !candidates.empty())
+    {
+        auto pos = pickCandidate(candidates, taskScores);
+        result.push_back(candidates[pos].task.get());
+        candidates.erase(candidates.begin() + pos);
+    }
+
+    return result;
+}
+
 }
@@ -10,6 +10,7 @@ class TaskManager : public sori::ITaskManager
 {
 public:
     sori::ITask& pickNextTask(const sori::TaskScores& taskScores) override;
+    std::vector<sori::ITask*> pickNextTasks(const sori::TaskScores& taskScores, const std::size_t num) override;
 
     void dumpDemoPictures(const std::filesystem::path& dirName) const;
 };
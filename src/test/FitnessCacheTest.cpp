@@ -0,0 +1,165 @@
+#define BOOST_TEST_DYN_LINK
+#define TEST
+#include <boost/test/unit_test.hpp>
+#include "gacommon/fitness_cache.hpp"
+#include "gacommon/rng.hpp"
+#include "neat/neat.hpp"
+#include <cmath>
+
+class FitnessCacheTest
+{
+public:
+    FitnessCacheTest()
+    {
+        Rng::seed(1);
+
+        mCfg.numInputs = 3;
+        mCfg.numOutputs = 2;
+        mCfg.numThreads = 1;
+        mCfg.mutationCfg.perturbationChance = 0.5;
+        mCfg.mutationCfg.addNodeMutationChance = 0.05;
+        mCfg.mutationCfg.addConnectionMutationChance = 0.1;
+        mCfg.mutationCfg.weightsMutationChance = 0.3;
+        mCfg.populationCfg.size = 100;
+        mCfg.populationCfg.mCompatibilityFactor = 3.0;
+        mCfg.populationCfg.minterspecieCrossoverPercentage = 0.1;
+        mCfg.populationCfg.mC1_C2 = 1.0;
+        mCfg.populationCfg.mC3 = 2.0;
+    }
+
+protected:
+    //Fitness only depends on the outputs for one fixed input
+    class TestEvaluator : public gacommon::IFitnessEvaluator
+    {
+    public:
+        TestEvaluator(const bool cacheable)
+            : mCacheable(cacheable)
+        {
+        }
+
+        gacommon::Fitness evaluate(gacommon::IAgent& agent) override
+        {
+            mNumCalls++;
+
+            std::vector<gacommon::IOElement> inputs{gacommon::ValueIO{1.0}, gacommon::ValueIO{0.5}, gacommon::ValueIO{-1.0}};
+            std::vector<gacommon::IOElement> outputs{gacommon::ValueIO{}, gacommon::ValueIO{}};
+
+            agent.reset();
+            agent.run(inputs, outputs);
+
+            return 1 + static_cast<gacommon::Fitness>(
+                100 * std::abs(std::get<gacommon::ValueIO>(outputs[0]).value) +
+                100 * std::abs(std::get<gacommon::ValueIO>(outputs[1]).value));
+        }
+
+        std::optional<std::uint64_t> getChallengeSetId() const override
+        {
+            return mCacheable ? std::optional<std::uint64_t>(mChallengeSetId) : std::nullopt;
+        }
+
+        const bool mCacheable;
+        std::uint64_t mChallengeSetId = 0;
+        std::size_t mNumCalls = 0;
+    };
+
+    neat::Config mCfg;
+};
+
+BOOST_FIXTURE_TEST_CASE(TestCacheLifetime, FitnessCacheTest)
+{
+    gacommon::FitnessCache cache;
+    BOOST_CHECK(!cache.isEnabled());
+    cache.store(1, 10);
+    BOOST_CHECK(!cache.find(1));
+
+    cache.setChallengeSet(0);
+    BOOST_CHECK(cache.isEnabled());
+    cache.store(1, 10);
+    cache.store(2, 20);
+    BOOST_CHECK_EQUAL(10, cache.find(1).value());
+
+    //Entries survive the next generation, only the ones found there survive further
+    cache.endGeneration();
+    BOOST_CHECK_EQUAL(20, cache.find(2).value());
+    cache.endGeneration();
+    BOOST_CHECK(!cache.find(1));
+    BOOST_CHECK_EQUAL(20, cache.find(2).value());
+
+    //Same challenges keep entries, new ones drop them
+    cache.setChallengeSet(0);
+    BOOST_CHECK(cache.find(2));
+    cache.setChallengeSet(1);
+    BOOST_CHECK(!cache.find(2));
+    cache.store(3, 30);
+    cache.setChallengeSet(std::nullopt);
+    BOOST_CHECK(!cache.isEnabled());
+    cache.setChallengeSet(1);
+    BOOST_CHECK(!cache.find(3));
+}
+
+BOOST_FIXTURE_TEST_CASE(TestGenomHash, FitnessCacheTest)
+{
+    neat::InnovationHistory history;
+    auto a = neat::v2::Genom::createMinimal(3, 2, history, true);
+    auto b = a;
+    BOOST_CHECK_EQUAL(a.getStructuralHash(), b.getStructuralHash());
+
+    b.setWeight(0, a[0].weight + 0.5);
+    BOOST_CHECK(a.getStructuralHash() != b.getStructuralHash());
+
+    b.setWeight(0, a[0].weight);
+    BOOST_CHECK_EQUAL(a.getStructuralHash(), b.getStructuralHash());
+
+    auto c = neat::v2::Genom::createMinimal(3, 2, history, true);
+    BOOST_CHECK(a.getStructuralHash() != c.getStructuralHash());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestNeatCache, FitnessCacheTest)
+{
+    TestEvaluator eval(true);
+    neat::Neat n(mCfg, neat::EvolutionStrategyType::Blend, eval);
+
+    std::size_t numHits = 0;
+    for(int i = 0; i < 10; ++i)
+    {
+        const auto callsBefore = eval.mNumCalls;
+        n.step();
+
+        auto timings = n.getTimings().getLast();
+        BOOST_CHECK_EQUAL(timings.cacheLookups - timings.cacheHits, timings.numEvaluations);
+        BOOST_CHECK_EQUAL(timings.numEvaluations, eval.mNumCalls - callsBefore);
+        numHits += timings.cacheHits;
+    }
+    BOOST_CHECK(numHits > 0);
+
+    //Cached fitness is what the evaluator gives now
+    TestEvaluator fresh(false);
+    for(auto& s : n.getPopulation())
+    {
+        for(auto& p : s.population)
+        {
+            gacommon::NNAgent agent(mCfg.numInputs, mCfg.numOutputs, n.createAnn(p.genotype), false);
+            BOOST_CHECK_EQUAL(fresh.evaluate(agent), p.fitness);
+        }
+    }
+
+    //New challenges, nothing is found
+    eval.mChallengeSetId++;
+    n.step();
+    BOOST_CHECK_EQUAL(0, n.getTimings().getLast().cacheHits);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestNotCacheable, FitnessCacheTest)
+{
+    TestEvaluator eval(false);
+    neat::Neat n(mCfg, neat::EvolutionStrategyType::Blend, eval);
+
+    for(int i = 0; i < 3; ++i)
+    {
+        n.step();
+
+        auto timings = n.getTimings().getLast();
+        BOOST_CHECK_EQUAL(0, timings.cacheLookups);
+        BOOST_CHECK_EQUAL(timings.numEvaluations, n.getPopulation().size());
+    }
+}
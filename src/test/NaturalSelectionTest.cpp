@@ -103,3 +103,245 @@ BOOST_FIXTURE_TEST_CASE( TestConvergence, NaturalSelectionTest )
     BOOST_REQUIRE(converged);
 }
 
+//Same guess, cacheable by the guessed number
+class HashedTestPop
+{
+public:
+    HashedTestPop(int value)
+    {
+        mValue = value;
+    }
+
+    HashedTestPop cloneMutated(const gacommon::IODefinition& io) const
+    {
+        return HashedTestPop{Rng::genProbability(0.5) ? mValue + 1 : mValue - 1};
+    }
+
+    static HashedTestPop createMinimal(const gacommon::IODefinition& io)
+    {
+        return HashedTestPop{static_cast<int>(Rng::genChoise(10000)) - 5000};
+    }
+
+    std::unique_ptr<gacommon::IAgent> createAgent(const gacommon::IODefinition& io) const
+    {
+        return std::make_unique<TestAgent>(mValue);
+    }
+
+    std::uint64_t getStructuralHash() const
+    {
+        return gacommon::hashCombine(0, static_cast<std::uint64_t>(mValue));
+    }
+
+    int getValue() const
+    {
+        return mValue;
+    }
+
+    gacommon::Fitness fitness = 0;
+
+private:
+    int mValue = 0;
+};
+
+//Guesses the target of the current challenge set
+class CountingFitnessEvaluator : public gacommon::IFitnessEvaluator
+{
+public:
+    gacommon::Fitness evaluate(gacommon::IAgent& agent) override
+    {
+        mNumCalls++;
+
+        std::vector<gacommon::IOElement> inputs;
+        std::vector<gacommon::IOElement> outputs{
+            gacommon::ValueIO {0}
+        };
+
+        agent.run(inputs, outputs);
+
+        return score(static_cast<int>(std::get<0>(outputs[0]).value));
+    }
+
+    std::optional<std::uint64_t> getChallengeSetId() const override
+    {
+        return mChallengeSetId;
+    }
+
+    gacommon::Fitness score(const int value) const
+    {
+        return std::max(0, 5000 - std::abs(static_cast<int>(mChallengeSetId) - value));
+    }
+
+    std::size_t mNumCalls = 0;
+    std::uint64_t mChallengeSetId = 3500;
+};
+
+BOOST_FIXTURE_TEST_CASE( TestFitnessCache, NaturalSelectionTest )
+{
+    Rng::seed(1);
+
+    gacommon::Config cfg{20, 2, 0.25, 1};
+    CountingFitnessEvaluator eval;
+    gacommon::IODefinition def;
+    gacommon::NaturalSelection<HashedTestPop> algo(cfg, def, eval);
+
+    auto checkFitness = [&]()
+    {
+        for(auto& p : algo.getPopulation())
+        {
+            BOOST_CHECK_EQUAL(p.fitness, eval.score(p.getValue()));
+        }
+    };
+
+    //Nothing is cached yet
+    algo.step();
+    BOOST_CHECK_EQUAL(algo.getTimings().getLast().cacheLookups, cfg.populationSize);
+    BOOST_CHECK_EQUAL(algo.getTimings().getLast().cacheHits, 0);
+    BOOST_CHECK_EQUAL(eval.mNumCalls, cfg.populationSize);
+    checkFitness();
+
+    //Survivors are copies of scored pops, only the offspring not seen before are evaluated
+    for(int i = 0; i < 5; ++i)
+    {
+        eval.mNumCalls = 0;
+        algo.step();
+
+        auto last = algo.getTimings().getLast();
+        BOOST_CHECK_EQUAL(last.cacheLookups, cfg.populationSize);
+        BOOST_CHECK_GE(last.cacheHits, static_cast<std::size_t>(cfg.populationSize * cfg.survivalRate));
+        BOOST_CHECK_EQUAL(eval.mNumCalls, last.cacheLookups - last.cacheHits);
+        BOOST_CHECK_EQUAL(last.numEvaluations, eval.mNumCalls);
+        checkFitness();
+    }
+
+    //A new challenge set drops what was scored on the old one
+    eval.mChallengeSetId = 2000;
+    eval.mNumCalls = 0;
+    algo.step();
+    BOOST_CHECK_EQUAL(algo.getTimings().getLast().cacheHits, 0);
+    BOOST_CHECK_EQUAL(eval.mNumCalls, cfg.populationSize);
+    checkFitness();
+
+    eval.mNumCalls = 0;
+    algo.step();
+    BOOST_CHECK_GT(algo.getTimings().getLast().cacheHits, 0);
+    BOOST_CHECK_LT(eval.mNumCalls, cfg.populationSize);
+    checkFitness();
+}
+
+//Guess scored on challenges with targets around 3500, each worth up to 50. Guesses ending in 0 are broken
+//and score nothing, so there are pops that racing can tell from the first challenges
+class ChallengeFitnessEvaluator : public gacommon::IFitnessEvaluator
+{
+public:
+    gacommon::Fitness evaluate(gacommon::IAgent& agent) override
+    {
+        return evaluateChallenges(agent, 0, getNumChallenges());
+    }
+
+    std::size_t getNumChallenges() const override
+    {
+        return 40;
+    }
+
+    gacommon::Fitness evaluateChallenges(gacommon::IAgent& agent, const std::size_t first, const std::size_t last) override
+    {
+        std::vector<gacommon::IOElement> inputs;
+        std::vector<gacommon::IOElement> outputs{
+            gacommon::ValueIO {0}
+        };
+
+        agent.run(inputs, outputs);
+
+        const int value = static_cast<int>(std::get<0>(outputs[0]).value);
+        gacommon::Fitness result = 0;
+        if(value % 10 == 0)
+        {
+            return result;
+        }
+        for(std::size_t i = first; i < last; ++i)
+        {
+            result += std::max(0, 50 - std::abs(3500 + 20 * static_cast<int>(i % 5) - value) / 200);
+        }
+
+        return result;
+    }
+
+    gacommon::Fitness getMaxChallengesScore(const std::size_t first, const std::size_t last) const override
+    {
+        return static_cast<gacommon::Fitness>(50 * (last - first));
+    }
+
+    std::optional<std::uint64_t> getChallengeSetId() const override
+    {
+        return 0;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE( TestRacedOrder, NaturalSelectionTest )
+{
+    //Candidate 1 and 3 are unfinished, 3 can not reach the best two
+    gacommon::RacedOrder order({10, 4, 7, 2}, {10, 12, 7, 6}, {true, false, true, false});
+
+    BOOST_CHECK_EQUAL(order.getNumKnown(), 0);
+    BOOST_CHECK(order.getNextToFinish(1) == std::vector<std::size_t>{1});
+    BOOST_CHECK(order.getNextToFinish(3) == std::vector<std::size_t>{1});
+
+    order.finish(1, 7);
+    //Ties keep the order of the candidates
+    BOOST_CHECK_EQUAL(order.getNumKnown(), 3);
+    BOOST_CHECK_EQUAL(order.at(0), 0);
+    BOOST_CHECK_EQUAL(order.at(1), 1);
+    BOOST_CHECK_EQUAL(order.at(2), 2);
+    BOOST_CHECK(order.getNextToFinish(3).empty());
+    BOOST_CHECK(order.getNextToFinish(4) == std::vector<std::size_t>{3});
+    BOOST_CHECK(order.getOrder() == (std::vector<std::size_t>{0, 1, 2, 3}));
+}
+
+BOOST_FIXTURE_TEST_CASE( TestRacingSelection, NaturalSelectionTest )
+{
+    //Same seed with and without racing must breed the same pops, racing only skips challenges
+    gacommon::Config cfg{40, 2, 0.25, 2};
+    gacommon::Config racedCfg = cfg;
+    racedCfg.racingFirstStage = 0.25;
+    const int numGenerations = 30;
+
+    auto run = [&](const gacommon::Config& c)
+    {
+        Rng::seed(7);
+        ChallengeFitnessEvaluator eval;
+        gacommon::IODefinition def;
+        gacommon::NaturalSelection<HashedTestPop> algo(c, def, eval);
+
+        std::vector<std::vector<int>> values;
+        std::vector<gacommon::Fitness> best;
+        std::size_t skipped = 0;
+        for(int i = 0; i < numGenerations; ++i)
+        {
+            algo.step();
+            values.emplace_back();
+            for(auto& p : algo.getPopulation())
+            {
+                values.back().push_back(p.getValue());
+            }
+            best.push_back(algo.getPopulation()[0].fitness);
+            skipped += algo.getTimings().getLast().racingWorkSkipped;
+        }
+
+        return std::make_tuple(values, best, skipped);
+    };
+
+    auto [values, best, skipped] = run(cfg);
+    auto [racedValues, racedBest, racedSkipped] = run(racedCfg);
+
+    BOOST_CHECK_EQUAL(skipped, 0);
+    BOOST_CHECK_GT(racedSkipped, 0);
+    BOOST_CHECK(best == racedBest);
+    for(int i = 0; i < numGenerations; ++i)
+    {
+        //Pops racing left unfinished may sit in another order behind the ones selection saw
+        BOOST_CHECK_EQUAL(values[i][0], racedValues[i][0]);
+        std::sort(values[i].begin(), values[i].end());
+        std::sort(racedValues[i].begin(), racedValues[i].end());
+        BOOST_CHECK(values[i] == racedValues[i]);
+    }
+}
@@ -2,13 +2,17 @@
 #define TEST
 #include <boost/test/unit_test.hpp>
 #include "gacommon/neuro_net2.hpp"
+#include "gacommon/neuro_net_f32.hpp"
 #include "neat/genom.hpp"
+#include "gacommon/rng.hpp"
 
 class NeuroNetTest
 {
 public:
    NeuroNetTest()
    {
+       //Split mutations pick random connections, recurrent expectations rely on a fixed order
+       Rng::seed(1);
    }
 
 protected:
@@ -17,6 +21,34 @@ protected:
        return neat::v2::Genom::createMinimal(2, 1, mHistory, true);
    }
 
+   //Id based construction path, reference for createAnn2
+   std::unique_ptr<gacommon::NeuroNet2> createAnnById(const neat::v2::Genom& g)
+   {
+       std::vector<gacommon::NodeId> inputNodes;
+       std::vector<gacommon::NodeId> outputNodes;
+       std::vector<gacommon::NeuroNet2::HiddenNodeDef> hiddenNodes;
+       std::vector<gacommon::NeuroNet2::ConnectionDef> connections;
+
+       for(auto iter = g.beginNodes(neat::v2::Genom::NodeType::Input); iter != g.endNodes(neat::v2::Genom::NodeType::Input); ++iter)
+       {
+           inputNodes.push_back(iter->id);
+       }
+       for(auto iter = g.beginNodes(neat::v2::Genom::NodeType::Output); iter != g.endNodes(neat::v2::Genom::NodeType::Output); ++iter)
+       {
+           outputNodes.push_back(iter->id);
+       }
+       for(auto iter = g.beginNodes(neat::v2::Genom::NodeType::Hidden); iter != g.endNodes(neat::v2::Genom::NodeType::Hidden); ++iter)
+       {
+           hiddenNodes.push_back({iter->id, iter->acType, 0.0});
+       }
+       for(auto& c : g)
+       {
+           connections.push_back({c.srcNodeId, c.dstNodeId, c.weight});
+       }
+
+       return std::make_unique<gacommon::NeuroNet2>(inputNodes, outputNodes, hiddenNodes, connections);
+   }
+
    neat::InnovationHistory mHistory;
 };
 
@@ -84,6 +116,8 @@ BOOST_FIXTURE_TEST_CASE( TestOneHiddenNode, NeuroNetTest )
 
       auto n = neat::v2::createAnn2(a);
 
+      //Output and hidden node are a cycle now, the output sees the hidden node one activation late
+      BOOST_CHECK_EQUAL(5, gacommon::activate(*n, {10, 10})[0]);
       BOOST_CHECK_EQUAL(5.5, gacommon::activate(*n, {10, 10})[0]);
    }
 }
@@ -296,3 +330,243 @@ BOOST_FIXTURE_TEST_CASE( TestNNAgent, NeuroNetTest )
        BOOST_CHECK_EQUAL(std::get<gacommon::BitmapIO>(inputs[3]).map[i], std::get<gacommon::BitmapIO>(outputs[3]).map[i]);
    }
 }
+
+BOOST_FIXTURE_TEST_CASE( TestNNAgentFlat, NeuroNetTest )
+{
+   const std::vector<gacommon::IOElement> inputs = {
+       gacommon::ValueIO{0},
+       gacommon::ValueIO{1},
+       gacommon::ChoiceIO{3, 1},
+       gacommon::BitmapIO{3, 3, {1, 1, 1, 2, 2, 2, 3, 3, 3}},
+       gacommon::ValueIO{5},
+   };
+   const std::vector<gacommon::IOElement> outputs = {
+       gacommon::ValueIO{0},
+       gacommon::ValueIO{0},
+       gacommon::ChoiceIO{3, 0},
+       gacommon::BitmapIO{3, 3, {0, 0, 0, 0, 0, 0, 0, 0, 0}},
+       gacommon::ValueIO{0},
+   };
+   gacommon::IOSchema schema(inputs, outputs);
+   BOOST_REQUIRE_EQUAL(15, schema.getNumInputs());
+   BOOST_REQUIRE_EQUAL(15, schema.getNumOutputs());
+
+   //Agent without a flat path, goes through the element conversion
+   class ElementAgent : public gacommon::IAgent
+   {
+   public:
+      ElementAgent(gacommon::IAgent& agent) : mAgent(agent) {}
+      void reset() override {mAgent.reset();}
+      void run(const std::vector<gacommon::IOElement>& inputs, std::vector<gacommon::IOElement>& outputs) override {mAgent.run(inputs, outputs);}
+      void toBinaryStream(std::ofstream& stream) const override {}
+
+   private:
+      gacommon::IAgent& mAgent;
+   };
+
+   const std::vector<gacommon::NodeId> inputNodes = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
+   const std::vector<gacommon::NodeId> outputNodes = {15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29};
+   std::vector<gacommon::NeuroNet2::ConnectionDef> connections;
+   for(std::size_t i = 0; i < outputNodes.size(); ++i)
+   {
+       connections.push_back({inputNodes[i], outputNodes[i], 1});
+   }
+
+   //Second sample differs in every element
+   std::vector<double> flatInputs(2 * schema.getNumInputs());
+   gacommon::IOSchema::toFlat(inputs, flatInputs.data());
+   gacommon::IOSchema::toFlat(inputs, flatInputs.data() + schema.getNumInputs());
+   auto second = flatInputs.data() + schema.getNumInputs();
+   schema.setValue(second, 0, 3);
+   schema.setValue(second, 1, -2);
+   schema.setChoice(second, 2, 2);
+   std::fill(second + 5, second + 14, 7.0);
+   schema.setValue(second, 4, 0.5);
+
+   for(auto useFloat32 : {false, true})
+   {
+      auto nn = std::make_unique<gacommon::NeuroNet2>(inputNodes, outputNodes, std::vector<gacommon::NeuroNet2::HiddenNodeDef>{}, connections);
+      gacommon::NNAgent agent(schema.getNumInputs(), schema.getNumOutputs(), std::move(nn), useFloat32);
+      ElementAgent elementAgent(agent);
+
+      for(gacommon::IAgent* a : {static_cast<gacommon::IAgent*>(&agent), static_cast<gacommon::IAgent*>(&elementAgent)})
+      {
+         std::vector<double> flatOutputs(2 * schema.getNumOutputs());
+         a->runFlat(schema, flatInputs, flatOutputs, 2);
+
+         BOOST_CHECK_EQUAL(0, schema.getValue(flatOutputs.data(), 0));
+         BOOST_CHECK_EQUAL(1, schema.getValue(flatOutputs.data(), 1));
+         BOOST_CHECK_EQUAL(1, schema.getChoice(flatOutputs.data(), 2));
+         BOOST_CHECK_EQUAL(5, schema.getValue(flatOutputs.data(), 4));
+
+         auto secondOutputs = flatOutputs.data() + schema.getNumOutputs();
+         BOOST_CHECK_EQUAL(3, schema.getValue(secondOutputs, 0));
+         BOOST_CHECK_EQUAL(-2, schema.getValue(secondOutputs, 1));
+         BOOST_CHECK_EQUAL(2, schema.getChoice(secondOutputs, 2));
+         BOOST_CHECK_EQUAL(0.5, schema.getValue(secondOutputs, 4));
+         for(std::size_t i = 0; i < 9; ++i)
+         {
+             BOOST_CHECK_EQUAL(flatInputs[5 + i], flatOutputs[5 + i]);
+             BOOST_CHECK_EQUAL(7, secondOutputs[5 + i]);
+         }
+      }
+
+      std::vector<double> wrongSize(schema.getNumOutputs());
+      BOOST_CHECK_THROW(agent.runFlat(schema, flatInputs, wrongSize, 2), std::runtime_error);
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( TestActivateBatch, NeuroNetTest )
+{
+   neat::v2::Genom a = createSampleGenom();
+
+   neat::v2::MutationConfig cfg;
+   cfg.addNodeMutationChance = 1.0;
+   a.mutate(cfg, mHistory);
+   a.mutate(cfg, mHistory);
+   a.mutate(cfg, mHistory);
+
+   auto iter = a.beginNodes(neat::v2::Genom::NodeType::Hidden);
+   auto newNodeId1 = iter->id; ++iter;
+   auto newNodeId2 = iter->id;
+
+   a.connect(2, newNodeId2, mHistory, 0.75);
+   a.connect(newNodeId1, newNodeId2, mHistory, -0.5);
+   a.connect(newNodeId2, newNodeId2, mHistory, 0.3);
+
+   auto n = neat::v2::createAnn2(a);
+
+   const std::vector<std::vector<double>> samples = {{0, 0}, {0, 1}, {1, 0}, {1, 1}, {-3, 2.5}, {10, 10}, {0.25, -7}};
+
+   std::vector<double> batchInputs;
+   for(auto& s : samples)
+   {
+       batchInputs.insert(batchInputs.end(), s.begin(), s.end());
+   }
+
+   std::vector<double> batchOutputs(samples.size());
+   n->activateBatch(batchInputs, batchOutputs, samples.size());
+
+   BOOST_REQUIRE_EQUAL(samples.size(), batchOutputs.size());
+   for(std::size_t i = 0; i < samples.size(); ++i)
+   {
+       n->reset();
+       BOOST_CHECK_EQUAL(gacommon::activate(*n, samples[i])[0], batchOutputs[i]);
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( TestFloat32Accuracy, NeuroNetTest )
+{
+   //Two hidden layers with every activation type, inputs are positive so LOG stays defined
+   const std::vector<gacommon::NodeId> inputNodes = {0, 1, 2};
+   const std::vector<gacommon::NodeId> outputNodes = {3, 4};
+   std::vector<gacommon::NeuroNet2::HiddenNodeDef> hiddenNodes;
+   std::vector<gacommon::NeuroNet2::ConnectionDef> connections;
+
+   const gacommon::NodeId firstHidden = 5;
+   for(int i = 0; i < NUM_ACTIVATION_FUNCTION_TYPES; ++i)
+   {
+       const gacommon::NodeId id = firstHidden + i;
+       const auto type = static_cast<ActivationFunctionType>(i);
+       hiddenNodes.push_back({id, type, 0.0});
+
+       connections.push_back({static_cast<gacommon::NodeId>(i % 3), id, 0.3 + 0.05 * i});
+       connections.push_back({static_cast<gacommon::NodeId>((i + 1) % 3), id, 0.2});
+       if(type != ActivationFunctionType::LOG)
+       {
+           connections.push_back({firstHidden + (i + 5) % NUM_ACTIVATION_FUNCTION_TYPES, id, -0.4});
+       }
+       connections.push_back({id, outputNodes[i % 2], i % 2 ? 0.25 : -0.15});
+   }
+   connections.push_back({3, 4, 0.5});
+
+   gacommon::NeuroNet2 nn(inputNodes, outputNodes, hiddenNodes, connections);
+   gacommon::NeuroNetF32 fast(nn);
+
+   const std::vector<std::vector<double>> samples = {{0.1, 0.2, 0.3}, {1, 1, 1}, {2, 0.5, 1.5}, {0.01, 1.9, 0.7}};
+   for(auto& s : samples)
+   {
+       nn.reset();
+       auto expected = gacommon::activate(nn, s);
+
+       fast.reset();
+       auto actual = gacommon::activate(fast, std::vector<float>(s.begin(), s.end()));
+
+       BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+       for(std::size_t i = 0; i < expected.size(); ++i)
+       {
+           BOOST_CHECK_SMALL(expected[i] - actual[i], 1e-4 * std::max(1.0, std::abs(expected[i])));
+       }
+   }
+
+   //Every activation type on its own over a range of sums
+   for(int t = 0; t < NUM_ACTIVATION_FUNCTION_TYPES; ++t)
+   {
+       const auto type = static_cast<ActivationFunctionType>(t);
+       std::vector<float> values;
+       for(float x = 0.05f; x < 3.0f; x += 0.1f)
+       {
+           values.push_back(type == ActivationFunctionType::LOG ? x : x - 1.5f);
+       }
+
+       auto results = values;
+       activateSpan(type, results.data(), results.size());
+
+       for(std::size_t i = 0; i < values.size(); ++i)
+       {
+           const double expected = getPtr(type)(values[i]);
+           BOOST_CHECK_SMALL(expected - results[i], 1e-4 * std::max(1.0, std::abs(expected)));
+       }
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( TestDirectCompile, NeuroNetTest )
+{
+   neat::v2::MutationConfig cfg;
+   cfg.addNodeMutationChance = 0.3;
+   cfg.addConnectionMutationChance = 0.5;
+   cfg.changeNodeMutationChance = 0.3;
+   cfg.removeConnectionMutationChance = 0.1;
+   cfg.removeNodeMutationChance = 0.05;
+   cfg.weightsMutationChance = 0.5;
+   cfg.perturbationChance = 0.5;
+
+   neat::v2::Genom a = neat::v2::Genom::createMinimal(4, 2, mHistory, true);
+   for(int step = 0; step < 200; ++step)
+   {
+       a.mutate(cfg, mHistory);
+
+       auto direct = neat::v2::createAnn2(a);
+       auto byId = createAnnById(a);
+
+       BOOST_REQUIRE(direct->mCons.colInd == byId->mCons.colInd);
+       BOOST_REQUIRE(direct->mCons.rowInd == byId->mCons.rowInd);
+       BOOST_REQUIRE(direct->mCons.weights == byId->mCons.weights);
+       BOOST_REQUIRE_EQUAL(direct->mHiddenNodes.size(), byId->mHiddenNodes.size());
+       for(std::size_t i = 0; i < direct->mHiddenNodes.size(); ++i)
+       {
+           BOOST_CHECK_EQUAL(direct->mHiddenNodes[i]->id, byId->mHiddenNodes[i]->id);
+           BOOST_CHECK_EQUAL(direct->mHiddenNodes[i]->depth, byId->mHiddenNodes[i]->depth);
+           BOOST_CHECK(direct->mHiddenNodes[i]->func == byId->mHiddenNodes[i]->func);
+       }
+
+       const std::vector<double> input = {0.5, -1, 2, 0.25};
+       auto x = gacommon::activate(*direct, input);
+       auto y = gacommon::activate(*byId, input);
+       for(std::size_t i = 0; i < x.size(); ++i)
+       {
+           //LOG of a negative sum gives NaN in both
+           BOOST_CHECK(x[i] == y[i] || (std::isnan(x[i]) && std::isnan(y[i])));
+       }
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( TestDirectCompileRejectsInputDst, NeuroNetTest )
+{
+   //Same as the id based constructor, nothing may lead into an input
+   std::vector<gacommon::NeuroNet2::IndexedConnectionDef> connections = {{2, 1, 0.5}};
+   BOOST_CHECK_THROW(gacommon::NeuroNet2(2, 1, {}, connections), std::runtime_error);
+
+   connections = {{0, 2, 0.5}};
+   BOOST_CHECK_NO_THROW(gacommon::NeuroNet2(2, 1, {}, connections));
+}
@@ -1,7 +1,9 @@
-#define BOOST_TEST_MODULE a
+#define BOOST_TEST_DYN_LINK
 #define TEST
 #include <boost/test/unit_test.hpp>
 #include "gacommon/neuro_net2.hpp"
+#include "gacommon/neuro_net_f32.hpp"
+#include "gacommon/rng.hpp"
 #include "neat/genom.hpp"
 
 class RNNTest
@@ -9,6 +11,8 @@ class RNNTest
 public:
    RNNTest()
    {
+       //Split mutations pick random connections, node ids depend on them
+       Rng::seed(1);
    }
 
 protected:
@@ -17,6 +21,31 @@ protected:
        return neat::v2::Genom::createMinimal(2, 1, mHistory, true);
    }
 
+   //Input 0 and output 1 around a loop of identity nodes 2 and 3, 3 also feeds itself.
+   //Hidden nodes and connections are given in the order asked for
+   std::unique_ptr<gacommon::NeuroNet2> createLoop(const bool reversed)
+   {
+       std::vector<gacommon::NeuroNet2::HiddenNodeDef> hiddenNodes = {
+           {2, ActivationFunctionType::IDENTITY, 0},
+           {3, ActivationFunctionType::IDENTITY, 0}
+       };
+       std::vector<gacommon::NeuroNet2::ConnectionDef> connections = {
+           {0, 2, 1},
+           {3, 2, 0.5},
+           {2, 3, 1},
+           {3, 3, -0.25},
+           {3, 1, 1},
+           {0, 1, 0.1}
+       };
+       if(reversed)
+       {
+           std::reverse(hiddenNodes.begin(), hiddenNodes.end());
+           std::reverse(connections.begin(), connections.end());
+       }
+
+       return std::make_unique<gacommon::NeuroNet2>(std::vector<gacommon::NodeId>{0}, std::vector<gacommon::NodeId>{1}, hiddenNodes, connections);
+   }
+
    neat::InnovationHistory mHistory;
 };
 
@@ -31,7 +60,6 @@ BOOST_FIXTURE_TEST_CASE( TestRNN, RNNTest )
 
    auto iter = a.beginNodes(neat::v2::Genom::NodeType::Hidden);
    auto newNodeId1 = iter->id; ++iter;
-   std::cout << newNodeId1;
    auto newNodeId2 = iter->id; ++iter;
 
    a.disconnectAll();
@@ -43,6 +71,7 @@ BOOST_FIXTURE_TEST_CASE( TestRNN, RNNTest )
    a.connect(3, 3, mHistory, 1.0);
 
    auto n = neat::v2::createAnn2(a);
+   BOOST_CHECK(n->isRecurrent());
    BOOST_CHECK_EQUAL(0.92414181997875655, gacommon::activate(*n, {0, 0})[0]);
    BOOST_CHECK_EQUAL(1.8482836399575131, gacommon::activate(*n, {0, 0})[0]);
    BOOST_CHECK_EQUAL(2.7724254599362697, gacommon::activate(*n, {0, 0})[0]);
@@ -108,3 +137,95 @@ BOOST_FIXTURE_TEST_CASE( TestRNN1, RNNTest )
    }
    BOOST_CHECK_EQUAL(matrix.rowInd.size(), 7);
 }
+
+BOOST_FIXTURE_TEST_CASE( TestFeedForwardDetected, RNNTest )
+{
+   neat::v2::Genom a = createSampleGenom();
+
+   neat::v2::MutationConfig cfg;
+   cfg.addNodeMutationChance = 1.0;
+   a.mutate(cfg, mHistory);
+   a.mutate(cfg, mHistory);
+
+   BOOST_CHECK(!neat::v2::createAnn2(a)->isRecurrent());
+
+   a.connect(3, 3, mHistory, 1.0);
+   BOOST_CHECK(neat::v2::createAnn2(a)->isRecurrent());
+}
+
+BOOST_FIXTURE_TEST_CASE( TestDoubleBuffering, RNNTest )
+{
+   auto n = createLoop(false);
+   BOOST_REQUIRE(n->isRecurrent());
+
+   //Loop connections read the previous tick: 2 = in + 0.5 * 3', 3 = 2' - 0.25 * 3', out = 3 + 0.1 * in
+   const std::vector<double> expected = {0.2, 2.2, 1.7, 2.825, 2.29375};
+   for(auto e : expected)
+   {
+       BOOST_CHECK_CLOSE(e, gacommon::activate(*n, {2})[0], 1e-9);
+   }
+
+   n->reset();
+   BOOST_CHECK_CLOSE(expected[0], gacommon::activate(*n, {2})[0], 1e-9);
+}
+
+BOOST_FIXTURE_TEST_CASE( TestOrderIndependent, RNNTest )
+{
+   auto a = createLoop(false);
+   auto b = createLoop(true);
+
+   for(auto input : {2.0, -1.0, 0.5, 3.0, 0.0, 1.0})
+   {
+       BOOST_CHECK_EQUAL(gacommon::activate(*a, {input})[0], gacommon::activate(*b, {input})[0]);
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( TestTicks, RNNTest )
+{
+   auto stepped = createLoop(false);
+   auto single = createLoop(false);
+   stepped->setNumTicks(3);
+
+   for(auto input : {2.0, -1.0, 0.5})
+   {
+       gacommon::activate(*single, {input});
+       gacommon::activate(*single, {input});
+       BOOST_CHECK_EQUAL(gacommon::activate(*single, {input})[0], gacommon::activate(*stepped, {input})[0]);
+   }
+
+   BOOST_CHECK_THROW(stepped->setNumTicks(0), std::runtime_error);
+
+   //Feed forward nets take one pass whatever the ticks
+   neat::v2::Genom g = createSampleGenom();
+   g.setWeight(0, 0.5);
+   g.setWeight(1, 0.25);
+   auto ff = neat::v2::createAnn2(g);
+   ff->setNumTicks(4);
+   BOOST_CHECK_EQUAL(7.5, gacommon::activate(*ff, {10, 10})[0]);
+}
+
+BOOST_FIXTURE_TEST_CASE( TestBatchAndFloat32, RNNTest )
+{
+   auto n = createLoop(false);
+   n->setNumTicks(2);
+
+   const std::vector<double> samples = {2, -1, 0.5, 3};
+   std::vector<double> batchOutputs(samples.size());
+   n->activateBatch(samples, batchOutputs, samples.size());
+
+   for(std::size_t i = 0; i < samples.size(); ++i)
+   {
+       n->reset();
+       BOOST_CHECK_EQUAL(gacommon::activate(*n, {samples[i]})[0], batchOutputs[i]);
+   }
+
+   //State carries over activations in both
+   n->reset();
+   gacommon::NeuroNetF32 fast(*n);
+   for(auto s : samples)
+   {
+       auto expected = gacommon::activate(*n, {s})[0];
+       auto actual = gacommon::activate(fast, {static_cast<float>(s)})[0];
+       BOOST_CHECK_SMALL(expected - actual, 1e-4 * std::max(1.0, std::abs(expected)));
+   }
+}
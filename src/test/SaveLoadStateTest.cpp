@@ -1,6 +1,9 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 #include "neat/neat.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
 
 class SaveLoadStateTest
 {
@@ -110,3 +113,130 @@ BOOST_FIXTURE_TEST_CASE( SaveLoadTest3, SaveLoadStateTest )
 
     BOOST_CHECK(isNeatSame(n, n1));
 }
+
+BOOST_FIXTURE_TEST_CASE( SnapshotViewTest, SaveLoadStateTest ) 
+{  
+    SimpleFitnessEvaluator ev;
+    neat::Neat n(mCfg, neat::EvolutionStrategyType::Blend, ev);
+
+    n.step();
+    n.step();
+
+    n.saveState("test4.state");
+
+    BOOST_CHECK(neat::PopulationSnapshot::isSnapshot("test4.state"));
+
+    //Pops are read from the mapped file without loading the population
+    neat::PopulationSnapshot snapshot("test4.state");
+    BOOST_CHECK_EQUAL(snapshot.getNumInputs(), mCfg.numInputs);
+    BOOST_CHECK_EQUAL(snapshot.getNumOutputs(), mCfg.numOutputs);
+    BOOST_REQUIRE_EQUAL(snapshot.getSpecies().size(), n.getPopulation().numSpecies());
+
+    auto s = n.getPopulation().begin();
+    for(auto& specie : snapshot.getSpecies())
+    {
+        BOOST_CHECK_EQUAL(specie.id, s->id);
+        auto pops = snapshot.getPops(specie);
+        BOOST_REQUIRE_EQUAL(pops.size(), s->population.size());
+        for(std::size_t i = 0; i < pops.size(); ++i)
+        {
+            BOOST_CHECK_EQUAL(pops[i].fitness, s->population[i].fitness);
+            BOOST_CHECK_EQUAL(snapshot.getGenes(pops[i]).size(), s->population[i].genotype.getGenes().size());
+            BOOST_CHECK_EQUAL(snapshot.getHiddenNodes(pops[i]).size(), s->population[i].genotype.getHiddenNodes().size());
+        }
+        ++s;
+    }
+
+    //Saving again replaces the file, the mapped view keeps the old one
+    const auto numSpecies = snapshot.getSpecies().size();
+    n.step();
+    n.saveState("test4.state");
+    BOOST_CHECK_EQUAL(snapshot.getSpecies().size(), numSpecies);
+    BOOST_CHECK_EQUAL(snapshot.getGeneration(), n.getGenerationNumber() - 1);
+    BOOST_CHECK(!std::filesystem::exists("test4.state.tmp"));
+
+    std::filesystem::remove("test4.state");
+}
+
+BOOST_FIXTURE_TEST_CASE( SnapshotTruncatedTest, SaveLoadStateTest ) 
+{  
+    SimpleFitnessEvaluator ev;
+    neat::Neat n(mCfg, neat::EvolutionStrategyType::Blend, ev);
+
+    n.step();
+
+    n.saveState("test5.state");
+    std::filesystem::resize_file("test5.state", std::filesystem::file_size("test5.state") / 2);
+
+    neat::Neat n1(mCfg, neat::EvolutionStrategyType::Blend, ev);
+
+    BOOST_CHECK_THROW(n1.loadState("test5.state"), std::runtime_error);
+
+    std::filesystem::remove("test5.state");
+}
+
+void patchFirstGene(const std::string& fileName, const std::size_t fieldOffset, const neat::InnovationNumber value)
+{
+    neat::snapshot::Header header;
+    std::fstream f(fileName, std::ios::in | std::ios::out | std::ios::binary);
+    f.read(reinterpret_cast<char*>(&header), sizeof(header));
+    BOOST_REQUIRE(header.genes.count > 0);
+
+    f.seekp(header.genes.offset + fieldOffset);
+    f.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+BOOST_FIXTURE_TEST_CASE( SnapshotCorruptGeneTest, SaveLoadStateTest )
+{
+    SimpleFitnessEvaluator ev;
+    neat::Neat n(mCfg, neat::EvolutionStrategyType::Blend, ev);
+
+    n.step();
+    n.step();
+
+    n.saveState("test6.state");
+    const auto numInnovations = static_cast<neat::InnovationNumber>(neat::PopulationSnapshot("test6.state").getInnovations().size());
+
+    neat::Neat n1(mCfg, neat::EvolutionStrategyType::Blend, ev);
+
+    //Innovation number past the table
+    patchFirstGene("test6.state", offsetof(neat::v2::ConnectionGene, innovationNumber), numInnovations);
+    BOOST_CHECK_THROW(n1.loadState("test6.state"), std::runtime_error);
+
+    //Endpoints that are not the connection of the innovation
+    n.saveState("test6.state");
+    patchFirstGene("test6.state", offsetof(neat::v2::ConnectionGene, srcNodeId), 12345);
+    BOOST_CHECK_THROW(n1.loadState("test6.state"), std::runtime_error);
+
+    std::filesystem::remove("test6.state");
+}
+
+BOOST_FIXTURE_TEST_CASE( InnovationHistoryLookupTest, SaveLoadStateTest )
+{
+   neat::InnovationHistory history;
+   auto a = history.get(1, 4);
+   auto b = history.get(4, 1);
+   auto c = history.get(2, 7);
+
+   BOOST_CHECK_EQUAL(a, history.get(1, 4));
+   BOOST_CHECK(a != b && b != c);
+   BOOST_CHECK(history.get(b) == std::make_pair(4u, 1u));
+   BOOST_CHECK_THROW(history.get(c + 1), std::invalid_argument);
+
+   {
+      std::ofstream f("history.test.tmp", std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+      history.saveState(f);
+   }
+
+   neat::InnovationHistory restored;
+   {
+      std::ifstream f("history.test.tmp", std::ios_base::in | std::ios_base::binary);
+      restored.loadState(f);
+   }
+
+   BOOST_CHECK(restored.get(c) == std::make_pair(2u, 7u));
+   BOOST_CHECK_EQUAL(restored.get(4, 1), b);
+   BOOST_CHECK_EQUAL(restored.get(3, 3), c + 1);
+
+   std::filesystem::remove("history.test.tmp");
+}
@@ -3,6 +3,7 @@
 #define TEST
 #include <boost/test/unit_test.hpp>
 #include "dng/shape.hpp"
+#include "dng/drawing.hpp"
 
 class ShapeTest {};
 
@@ -57,3 +58,43 @@ BOOST_FIXTURE_TEST_CASE(ShapeTest4, ShapeTest)
     BOOST_CHECK(!sh.contains({70, 6}));
     BOOST_CHECK(!sh.contains({5, 5}));
 }
+
+template<class TShape>
+void checkProjectMatchesContains(const dng::Point& pos, const dng::Size& sz)
+{
+    dng::Image surface(pos.x + sz.x + 4, pos.y + sz.y + 4);
+    dng::fill(surface, dng::colors::Black);
+
+    TShape sh(pos, sz, dng::colors::Blue);
+    sh.project(surface);
+
+    auto v = boost::gil::const_view(surface);
+    for(int y = 0; y < v.height(); ++y)
+    {
+        for(int x = 0; x < v.width(); ++x)
+        {
+            dng::Point pt{static_cast<std::uint16_t>(x), static_cast<std::uint16_t>(y)};
+            BOOST_CHECK_MESSAGE((v(x, y) == dng::colors::Blue) == sh.contains(pt),
+                    "pixel " << x << " " << y << " of shape at " << pos.x << " " << pos.y << " sized " << sz.x << " " << sz.y);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(ShapeProjectParityTest, ShapeTest)
+{
+    for(std::uint16_t w = 3; w < 60; w += 7)
+    {
+        for(std::uint16_t h = 3; h < 60; h += 5)
+        {
+            dng::Point pos{static_cast<std::uint16_t>(1 + w % 4), static_cast<std::uint16_t>(1 + h % 3)};
+            checkProjectMatchesContains<dng::Hex>(pos, {w, h});
+            checkProjectMatchesContains<dng::Triangle>(pos, {w, h});
+        }
+    }
+
+    //Circle contains() rebuilds the polygon on every call, so fewer of them
+    for(std::uint16_t d : {5, 10, 17, 32, 45})
+    {
+        checkProjectMatchesContains<dng::Circle>({2, 3}, {d, static_cast<std::uint16_t>(d + 3)});
+    }
+}
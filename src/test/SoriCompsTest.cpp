@@ -29,6 +29,11 @@ public:
     {
     }
 
+    std::unique_ptr<sori::TaskContext> clone() const override
+    {
+        return std::make_unique<TestTaskContext>(*this);
+    }
+
     dng::Point mLastClickPos;
 };
 
@@ -239,6 +244,40 @@ BOOST_FIXTURE_TEST_CASE( ScreenReaderTest, SoriCompsTest )
     }
 }
 
+BOOST_FIXTURE_TEST_CASE( ScreenReaderPackedReadTest, SoriCompsTest )
+{
+    //Every pixel different, so any misplaced bit shows up
+    auto v = boost::gil::view(mSurface);
+    for(int y = 0; y < v.height(); ++y)
+    {
+        for(int x = 0; x < v.width(); ++x)
+        {
+            v(x, y) = boost::gil::rgb8_pixel_t(x * 7 + y, y * 13 + x, (x * y) & 0xFF);
+        }
+    }
+
+    sori::Context ctx(mSurface, mTaskCtx);
+    sori::CursorManipulator cursor(3);
+    cursor.activate(ctx);
+
+    for(auto [pos, sz] : {std::pair<dng::Point, dng::Size>{{0, 0}, {5, 5}}, {{3, 1}, {7, 4}}, {{91, 50}, {9, 9}}, {{0, 0}, {100, 100}}})
+    {
+        sori::Data expected;
+        sori::DataWritter<unsigned char> writter(expected);
+        auto img = ctx.read(pos, sz);
+        for(auto p : boost::gil::const_view(img))
+        {
+            writter(boost::gil::at_c<0>(p));
+            writter(boost::gil::at_c<1>(p));
+            writter(boost::gil::at_c<2>(p));
+        }
+
+        sori::Data actual;
+        ctx.readBits(pos, sz, actual);
+        BOOST_CHECK(expected == actual);
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE( ConstantGeneratorTest, SoriCompsTest )
 {
     auto unit = sori::ConstantGenerator::createRandom(0);
@@ -25,6 +25,11 @@ public:
 
     }
 
+    std::unique_ptr<sori::TaskContext> clone() const override
+    {
+        return std::make_unique<TestTask1Context>(*this);
+    }
+
 
     int getScore() const override
     {
@@ -130,6 +135,11 @@ public:
 
     }
 
+    std::unique_ptr<sori::TaskContext> clone() const override
+    {
+        return std::make_unique<TestTask2Context>(*this);
+    }
+
     int getScore() const override
     {
         return mPoints.size();
@@ -208,6 +218,11 @@ public:
 
     }
 
+    std::unique_ptr<sori::TaskContext> clone() const override
+    {
+        return std::make_unique<TestTask3Context>(*this);
+    }
+
     int getScore() const override
     {
         return mScore;
@@ -256,3 +271,137 @@ BOOST_FIXTURE_TEST_CASE(Test3, SoriConvergenceTest)
     sori::Sori s({true, 200, 0.4, 1}, tm);
     doConvergenceTest(s, 1000);
 }
+
+class TestTaskManagerBatch : public sori::ITaskManager
+{
+public:
+    sori::ITask& pickNextTask(const sori::TaskScores& scores) override
+    {
+        mNext = !mNext;
+        return mNext ? static_cast<sori::ITask&>(t1) : t2;
+    }
+
+private:
+    bool mNext = false;
+    Test1Task t1;
+    Test2Task t2;
+};
+
+class TestStatistics : public sori::IStatistics
+{
+public:
+    void onStepResult(const std::string& taskName, const std::size_t genNumber, const std::size_t energyLimit, const int maxScore, const int avgScore) override
+    {
+        numStepResults++;
+    }
+
+    void onGenerationTimings(const gacommon::GenerationTimings& timings) override
+    {
+    }
+
+    void onTaskResult(const std::string& taskName, const std::size_t genNumber, const sori::TaskResult& result) override
+    {
+        taskResults.push_back({taskName, result});
+    }
+
+    std::size_t numStepResults = 0;
+    std::vector<std::pair<std::string, sori::TaskResult>> taskResults;
+};
+
+BOOST_FIXTURE_TEST_CASE(BatchEvaluationTest, SoriConvergenceTest)
+{
+    Rng::seed(1);
+    TestTaskManagerBatch tm;
+    TestStatistics stats;
+
+    sori::Config cfg;
+    cfg.populationSize = 20;
+    cfg.numThreads = 1;
+    cfg.shareTaskInstances = true;
+    cfg.contextsPerTask = 3;
+    cfg.tasksPerGeneration = 2;
+    sori::Sori s(cfg, tm);
+    s.setStatistics(stats);
+
+    const std::size_t numGenerations = 5;
+    for(std::size_t i = 0; i < numGenerations; ++i)
+    {
+        s.step();
+    }
+
+    BOOST_CHECK_EQUAL(numGenerations, stats.numStepResults);
+    BOOST_REQUIRE_EQUAL(numGenerations * 2, stats.taskResults.size());
+    for(std::size_t i = 0; i < stats.taskResults.size(); ++i)
+    {
+        auto& [name, result] = stats.taskResults[i];
+        BOOST_CHECK_EQUAL(i % 2 == 0 ? "Task1" : "Task2", name);
+        BOOST_CHECK_EQUAL(3u, result.numContexts);
+        BOOST_CHECK(result.maxMinScore <= result.maxMeanScore);
+        BOOST_CHECK(result.avgMinScore <= result.avgMeanScore);
+        BOOST_CHECK(result.avgMeanScore <= result.maxMeanScore);
+    }
+}
+
+//Logs the instance of every run, a run works on a clone of the instance
+class TrackedTaskContext : public TestTask1Context
+{
+public:
+    TrackedTaskContext(const std::size_t instance, std::vector<std::size_t>& runs)
+        : mInstance(instance)
+        , mRuns(runs)
+    {
+    }
+
+    std::unique_ptr<sori::TaskContext> clone() const override
+    {
+        mRuns.push_back(mInstance);
+        return std::make_unique<TrackedTaskContext>(*this);
+    }
+
+    const std::size_t mInstance;
+    std::vector<std::size_t>& mRuns;
+};
+
+class TrackedTaskManager : public sori::ITaskManager, public Test1Task
+{
+public:
+    sori::ITask& pickNextTask(const sori::TaskScores& scores) override
+    {
+        return *this;
+    }
+
+    std::unique_ptr<sori::TaskContext> createContext(const dng::Size& envSize) const override
+    {
+        return std::make_unique<TrackedTaskContext>(mNumInstances++, runs);
+    }
+
+    mutable std::size_t mNumInstances = 0;
+    mutable std::vector<std::size_t> runs;
+};
+
+BOOST_FIXTURE_TEST_CASE(SharedInstancesTest, SoriConvergenceTest)
+{
+    Rng::seed(1);
+    TrackedTaskManager tm;
+
+    sori::Config cfg;
+    cfg.populationSize = 20;
+    cfg.numThreads = 1;
+    cfg.shareTaskInstances = true;
+    cfg.contextsPerTask = 3;
+    sori::Sori s(cfg, tm);
+
+    s.step();
+
+    //Pops run in order with one thread, each runs all its contexts before the next one starts
+    const std::size_t numPops = s.getPopulation().size();
+    BOOST_CHECK_EQUAL(cfg.contextsPerTask, tm.mNumInstances);
+    BOOST_REQUIRE_EQUAL(numPops * cfg.contextsPerTask, tm.runs.size());
+    const std::vector<std::size_t> first(tm.runs.begin(), tm.runs.begin() + cfg.contextsPerTask);
+    BOOST_CHECK_EQUAL(cfg.contextsPerTask, std::set<std::size_t>(first.begin(), first.end()).size());
+    for(std::size_t p = 1; p < numPops; ++p)
+    {
+        const std::vector<std::size_t> pop(tm.runs.begin() + p * cfg.contextsPerTask, tm.runs.begin() + (p + 1) * cfg.contextsPerTask);
+        BOOST_CHECK(first == pop);
+    }
+}
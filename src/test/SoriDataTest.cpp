@@ -113,3 +113,48 @@ BOOST_FIXTURE_TEST_CASE( Write2Test, SoriDataTest )
     BOOST_CHECK_EQUAL(2, values[3]);
     BOOST_CHECK_EQUAL(0, values[4]);
 }
+
+BOOST_FIXTURE_TEST_CASE( WordKernelsTest, SoriDataTest )
+{
+    auto makeBits = [](const std::size_t size, const std::size_t seed)
+    {
+        sori::Data result(size);
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            result[i] = ((i * 2654435761u + seed * 40503u) >> 7) & 1;
+        }
+        return result;
+    };
+
+    for(std::size_t sizeA : {1, 5, 63, 64, 65, 130, 700})
+    {
+        for(std::size_t sizeB : {1, 3, 64, 100, 257})
+        {
+            auto a = makeBits(sizeA, 1);
+            auto b = makeBits(sizeB, 2);
+
+            auto appended = a;
+            sori::appendBits(appended, b);
+            BOOST_REQUIRE_EQUAL(sizeA + sizeB, appended.size());
+            for(std::size_t i = 0; i < appended.size(); ++i)
+            {
+                BOOST_CHECK_EQUAL(appended[i], i < sizeA ? a[i] : b[i - sizeA]);
+            }
+
+            sori::Data tiled;
+            sori::tileBits(b, sizeA, tiled);
+            BOOST_REQUIRE_EQUAL(sizeA, tiled.size());
+            for(std::size_t i = 0; i < sizeA; ++i)
+            {
+                BOOST_CHECK_EQUAL(tiled[i], b[i % sizeB]);
+            }
+
+            std::size_t matches = 0;
+            for(std::size_t i = 0; i < std::min(sizeA, sizeB); ++i)
+            {
+                matches += a[i] == b[i] ? 1 : 0;
+            }
+            BOOST_CHECK_EQUAL(matches, sori::countMatchingBits(a, b));
+        }
+    }
+}
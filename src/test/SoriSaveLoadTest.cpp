@@ -6,6 +6,7 @@
 #include "SORI/pop.hpp"
 #include "SORI/sori.hpp"
 #include <iostream>
+#include <filesystem>
 #include "gacommon/rng.hpp"
 
 class TestTaskSLContext : public sori::TaskContext
@@ -16,10 +17,20 @@ public:
         return false;
     }
 
-    void onClick(const sori::Point& pos) const override
+    void onClick(const dng::Point& pos) override
     {
     }
 
+    void draw(dng::Image& surface) const override
+    {
+
+    }
+
+    std::unique_ptr<sori::TaskContext> clone() const override
+    {
+        return std::make_unique<TestTaskSLContext>(*this);
+    }
+
     int getScore() const override
     {
         int result = static_cast<int>(Rng::gen32());
@@ -35,17 +46,12 @@ public:
         return "Task";
     }
 
-    void draw(sori::Image& surface) const override
-    {
-
-    }
-
-    std::unique_ptr<sori::TaskContext> createContext() const override
+    std::unique_ptr<sori::TaskContext> createContext(const dng::Size& envSize) const override
     {
         return std::make_unique<TestTaskSLContext>();
     }
 
-    int getMaxScore() const override
+    int getSolvedScore() const override
     {
         return 10000;
     }
@@ -66,41 +72,43 @@ private:
 class SoriSaveLoadTest
 {
 protected:
-    sori::Image mSurface {100, 100};
+    dng::Image mSurface {100, 100};
 };
 
-struct cout_redirect {
-    cout_redirect( std::streambuf * new_buffer )
-        : old( std::cout.rdbuf( new_buffer ) )
-    { }
+//WAL mode leaves files next to the database, all of them go
+void removeDatabase(const std::string& filename)
+{
+    for(auto suffix : {"", "-wal", "-shm"})
+    {
+        std::filesystem::remove(filename + suffix);
+    }
+}
+
+//Each test starts from an empty database and leaves nothing behind
+struct DatabaseFile
+{
+    DatabaseFile(const std::string& filename)
+        : name(filename)
+    {
+        removeDatabase(name);
+    }
 
-    ~cout_redirect( ) {
-        std::cout.flush();
-        std::cout.rdbuf( old );
+    ~DatabaseFile()
+    {
+        removeDatabase(name);
     }
 
-private:
-    std::streambuf * old;
+    const std::string name;
 };
 
-
 BOOST_FIXTURE_TEST_CASE( SaveLoadSimpleTest, SoriSaveLoadTest )
 {
     Rng::seed(time(0));
-    std::stringstream before;
-    std::stringstream after;
     auto pop = sori::Pop::createMinimal();
-    {
-        cout_redirect(before.rdbuf());
-        pop.print();
-    }
+    const auto before = pop.print();
     sori::savePop("sltest.pop", pop);
     pop = sori::loadPop("sltest.pop");
-    {
-        cout_redirect(after.rdbuf());
-        pop.print();
-    }
-    BOOST_CHECK_EQUAL(before.str(), after.str());
+    BOOST_CHECK_EQUAL(before, pop.print());
 }
 
 BOOST_FIXTURE_TEST_CASE( SaveLoadTest, SoriSaveLoadTest )
@@ -113,7 +121,8 @@ BOOST_FIXTURE_TEST_CASE( SaveLoadTest, SoriSaveLoadTest )
         s.step();
     }
 
-    sori::Database db("test.db");
+    DatabaseFile file("test.db");
+    sori::Database db(file.name);
     s.checkpoint(db);
 
     sori::Sori s2(tm, db);
@@ -129,22 +138,213 @@ BOOST_FIXTURE_TEST_CASE( SaveLoadTest, SoriSaveLoadTest )
     BOOST_CHECK_EQUAL(s.getEnergyLimit(), s2.getEnergyLimit());
     BOOST_CHECK_EQUAL(s.getGeneration(), s2.getGeneration());
 
+    BOOST_REQUIRE_EQUAL(s.getPopulation().size(), s2.getPopulation().size());
     auto i2 = s2.getPopulation().begin();
-
     for(auto i1 = s.getPopulation().begin(); i1 != s.getPopulation().end(); ++i1, ++i2)
     {
-        std::stringstream before;
-        std::stringstream after;
+        BOOST_CHECK_EQUAL(i1->getId(), i2->getId());
+        BOOST_CHECK_EQUAL((*i1).print(), (*i2).print());
+    }
+    BOOST_CHECK_EQUAL(s.getLastTaskScore("Task"), s2.getLastTaskScore("Task"));
+}
+
+BOOST_FIXTURE_TEST_CASE( SnapshotCheckpointTest, SoriSaveLoadTest )
+{
+    Rng::seed(time(0));
+    TestTaskManager tm;
+    sori::Sori s({true, 20, 0.4, 1}, tm);
+    s.step();
+
+    DatabaseFile file("checkpoint.db");
+    sori::Database db(file.name);
+    s.checkpoint(db);
+
+    //A snapshot is not affected by the generations run after it
+    auto snapshot = s.makeSnapshot();
+    std::vector<std::string> expected;
+    for(const auto& p : snapshot.population)
+    {
+        expected.push_back(p.print());
+    }
+    s.step();
+    s.step();
+    sori::Sori::writeSnapshot(snapshot, db);
+
+    sori::Database loadedDb(file.name);
+    sori::Sori loaded(tm, loadedDb);
+    BOOST_CHECK_EQUAL(loaded.getGeneration(), snapshot.generation);
+    BOOST_REQUIRE_EQUAL(loaded.getPopulation().size(), expected.size());
+    for(std::size_t i = 0; i < expected.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(loaded.getPopulation()[i].getId(), snapshot.population[i].getId());
+        BOOST_CHECK_EQUAL(loaded.getPopulation()[i].print(), expected[i]);
+    }
+
+    //New pops get ids not used before
+    loaded.step();
+    BOOST_CHECK_NO_THROW(loaded.checkpoint(loadedDb));
+}
+
+BOOST_FIXTURE_TEST_CASE( IncrementalCheckpointTest, SoriSaveLoadTest )
+{
+    Rng::seed(time(0));
+    TestTaskManager tm;
+    sori::Sori s({true, 20, 0.4, 1}, tm);
+    s.step();
+
+    DatabaseFile file("incremental.db");
+    sori::Database db(file.name);
+    s.checkpoint(db);
+    for(int i = 0; i < 3; ++i)
+    {
+        s.step();
+        s.checkpoint(db);
+    }
+
+    //Graphs of the pops gone are removed with their states
+    sqlite::database raw(file.name);
+    int numGraphs = 0;
+    raw << "SELECT count(*) FROM pop_graphs" >> numGraphs;
+    BOOST_CHECK_EQUAL(numGraphs, s.getPopulation().size());
+
+    sori::Database loadedDb(file.name);
+    sori::Sori loaded(tm, loadedDb);
+    BOOST_REQUIRE_EQUAL(loaded.getPopulation().size(), s.getPopulation().size());
+    for(std::size_t i = 0; i < s.getPopulation().size(); ++i)
+    {
+        const auto& expected = s.getPopulation()[i];
+        const auto& actual = loaded.getPopulation()[i];
+        BOOST_CHECK_EQUAL(actual.getId(), expected.getId());
+        BOOST_CHECK_EQUAL(actual.getFitness().score, expected.getFitness().score);
+        BOOST_CHECK_EQUAL(actual.print(), expected.print());
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE( LegacyPopsTest, SoriSaveLoadTest )
+{
+    Rng::seed(time(0));
+    DatabaseFile file("legacy.db");
+
+    //Whole pops by position, as checkpoints wrote them before pops had ids
+    std::vector<std::string> expected;
+    {
+        sqlite::database raw(file.name);
+        raw << "CREATE TABLE pops(id integer, pop blob)";
+        auto ins = raw << "INSERT INTO pops VALUES(?, ?)";
+        for(int i = 0; i < 5; ++i)
         {
-            cout_redirect(before.rdbuf());
-            (*i1).print();
+            auto pop = sori::Pop::createMinimal();
+            expected.push_back(pop.print());
+            ins << i << sori::popToBinary(pop);
+            ins++;
         }
+    }
+
+    sori::Database db(file.name);
+    auto pops = db.loadPops();
+    BOOST_REQUIRE_EQUAL(pops.size(), expected.size());
+    for(std::size_t i = 0; i < pops.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(pops[i].getId(), i);
+        BOOST_CHECK_EQUAL(pops[i].print(), expected[i]);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE( PopStateTest, SoriSaveLoadTest )
+{
+    Rng::seed(time(0));
+    TestTask task;
+    for(int i = 0; i < 20; ++i)
+    {
+        auto pop = sori::Pop::createMinimal().cloneMutated();
+        const auto graph = sori::popToBinary(pop);
+
+        //The state of a run applied to the units written before it gives the pop after the run
+        auto ctx = task.createContext({100, 100});
+        pop.run(500, mSurface, *ctx);
+        std::vector<std::uint8_t> state;
+        sori::PopFormat::writeState(pop, state);
+
+        auto restored = sori::popFromBinary(graph);
+        sori::PopFormat::readState(restored, state);
+        BOOST_CHECK_EQUAL(restored.print(), pop.print());
+        BOOST_CHECK_EQUAL(restored.getFitness().score, pop.getFitness().score);
+        BOOST_CHECK(sori::popToBinary(restored) == sori::popToBinary(pop));
+    }
+
+    auto other = sori::popFromBinary(sori::popToBinary(sori::Pop::createMinimal()));
+    std::vector<std::uint8_t> state;
+    sori::PopFormat::writeState(sori::Pop::createMinimal(), state);
+    state.resize(state.size() / 2);
+    BOOST_CHECK_THROW(sori::PopFormat::readState(other, state), std::runtime_error);
+
+    //A state archived by boost before the compact format, here one with no stateful units
+    std::stringstream stream;
+    {
+        boost::archive::binary_oarchive ar(stream);
+        int score = 42;
+        std::size_t energyLeft = 7;
+        std::size_t unitPos = 0;
+        std::vector<std::vector<sori::Data>> pendingMessages;
+        std::vector<std::size_t> positions;
+        std::vector<std::shared_ptr<sori::Unit>> units;
+        ar & score & energyLeft & unitPos & pendingMessages & positions & units;
+    }
+    const auto str = stream.str();
+    const std::vector<std::uint8_t> archived(str.begin(), str.end());
+    sori::popStateFromBinary(other, archived);
+    BOOST_CHECK_EQUAL(other.getFitness().score, 42);
+    BOOST_CHECK_EQUAL(other.getFitness().energyLeft, 7);
+}
+
+//Pop as the boost archive that popToBinary wrote before the compact format
+std::vector<std::uint8_t> toArchive(const sori::Pop& pop)
+{
+    std::stringstream stream;
+    {
+        boost::archive::binary_oarchive ar(stream);
+        ar & pop;
+    }
+    auto str = stream.str();
+    return {str.begin(), str.end()};
+}
+
+BOOST_FIXTURE_TEST_CASE( PopFormatRoundTripTest, SoriSaveLoadTest )
+{
+    Rng::seed(time(0));
+    TestTask task;
+    std::vector<sori::Pop> pops;
+    for(int i = 0; i < 50; ++i)
+    {
+        auto pop = sori::Pop::createMinimal();
+        for(int j = 0; j < i % 10; ++j)
         {
-            cout_redirect(after.rdbuf());
-            (*i2).print();
+            pop = pop.cloneMutated();
         }
+        //Leaves state behind in the units and a fitness
+        auto ctx = task.createContext({100, 100});
+        pop.run(500, mSurface, *ctx);
+        pops.push_back(pop);
+    }
+
+    for(const auto& pop : pops)
+    {
+        const auto archive = toArchive(pop);
+        const auto compact = sori::popToBinary(pop);
+        BOOST_CHECK(!sori::PopFormat::isCompact(archive));
+        BOOST_CHECK(sori::PopFormat::isCompact(compact));
+        BOOST_CHECK_LT(compact.size(), archive.size());
 
-        BOOST_CHECK_EQUAL(before.str(), after.str());
+        //Both formats load to the same pop, which archives back to the same bytes
+        auto fromArchive = sori::popFromBinary(archive);
+        auto fromCompact = sori::popFromBinary(compact);
+        BOOST_CHECK(toArchive(fromArchive) == archive);
+        BOOST_CHECK(toArchive(fromCompact) == archive);
+        BOOST_CHECK(sori::popToBinary(fromArchive) == compact);
+        BOOST_CHECK_EQUAL(fromCompact.print(), pop.print());
     }
-    BOOST_CHECK_EQUAL(s.getLastTaskScore("Task"), s2.getLastTaskScore("Task"));
+
+    auto truncated = sori::popToBinary(pops.back());
+    truncated.resize(truncated.size() / 2);
+    BOOST_CHECK_THROW(sori::popFromBinary(truncated), std::runtime_error);
 }
@@ -56,6 +56,28 @@ BOOST_FIXTURE_TEST_CASE(StaticObjectDetectionTest3, TaskLibTest)
     BOOST_CHECK_EQUAL(1000, sub.getScore());
 }
 
+BOOST_FIXTURE_TEST_CASE(StaticObjectDetectionCloneTest, TaskLibTest)
+{
+    tlib::StaticObjectDetection prototype({
+            std::make_shared<dng::Rectangle>(dng::Point{5, 5}, dng::Size{5, 5}, dng::colors::Blue),
+            std::make_shared<dng::Rectangle>(dng::Point{15, 15}, dng::Size{5, 5}, dng::colors::Blue)
+            }, dng::colors::Black);
+
+    auto first = prototype.clone();
+    auto second = prototype.clone();
+
+    first->onClick({6, 6});
+    first->onClick({16, 16});
+
+    //Clicks on a clone do not leak into the prototype or its other clones
+    BOOST_CHECK(first->isDone());
+    BOOST_CHECK(!second->isDone());
+    BOOST_CHECK(!prototype.isDone());
+
+    second->onClick({6, 6});
+    BOOST_CHECK(!second->isDone());
+}
+
 BOOST_FIXTURE_TEST_CASE(StaticObjectDetectionTest4, TaskLibTest)
 {
     tlib::StaticObjectDetection sub({
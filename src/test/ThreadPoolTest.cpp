@@ -0,0 +1,93 @@
+#include <boost/test/unit_test.hpp>
+#include "gacommon/thread_pool.hpp"
+#include "gacommon/timings.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+class ThreadPoolTest {};
+
+BOOST_FIXTURE_TEST_CASE(ThreadPoolRunsEachIndexOnce, ThreadPoolTest)
+{
+    gacommon::ThreadPool pool(4);
+
+    for(std::size_t count : {0, 1, 3, 100})
+    {
+        std::vector<std::atomic<int>> hits(count);
+        pool.parallelFor(count, [&](const std::size_t i){hits[i]++;});
+
+        for(auto& h : hits)
+        {
+            BOOST_CHECK_EQUAL(1, h.load());
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(ThreadPoolStealsFromSlowWorker, ThreadPoolTest)
+{
+    gacommon::ThreadPool pool(2);
+
+    //Index 0 blocks its worker, everything else dealt to that worker must be stolen
+    std::atomic<int> done = 0;
+    pool.parallelFor(20, [&](const std::size_t i){
+        if(i == 0)
+        {
+            while(done < 19)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        else
+        {
+            done++;
+        }
+    });
+
+    BOOST_CHECK_EQUAL(19, done.load());
+}
+
+BOOST_FIXTURE_TEST_CASE(ThreadPoolRethrows, ThreadPoolTest)
+{
+    gacommon::ThreadPool pool(3);
+
+    BOOST_CHECK_THROW(pool.parallelFor(10, [](const std::size_t i){
+        if(i == 7)
+        {
+            throw std::runtime_error("fail");
+        }
+    }), std::runtime_error);
+
+    //Pool stays usable
+    std::atomic<int> count = 0;
+    pool.parallelFor(10, [&](const std::size_t){count++;});
+    BOOST_CHECK_EQUAL(10, count.load());
+}
+
+BOOST_FIXTURE_TEST_CASE(ThreadPoolReportsBusyTime, ThreadPoolTest)
+{
+    gacommon::ThreadPool pool(2);
+    gacommon::Timings timings;
+
+    timings.beginGeneration();
+    {
+        auto scope = timings.measure(gacommon::Phase::Evaluate);
+        pool.parallelFor(4, [](const std::size_t){std::this_thread::sleep_for(std::chrono::milliseconds(5));});
+        timings.addEvaluations(4);
+    }
+    timings.endGeneration(7, &pool);
+
+    auto last = timings.getLast();
+    BOOST_CHECK_EQUAL(7, last.generation);
+    BOOST_CHECK_EQUAL(4, last.numEvaluations);
+    BOOST_CHECK(last.get(gacommon::Phase::Evaluate) >= std::chrono::milliseconds(10));
+    BOOST_CHECK(last.get(gacommon::Phase::Select) == std::chrono::nanoseconds(0));
+    BOOST_CHECK(last.getEvaluationsPerSecond() > 0);
+    BOOST_REQUIRE_EQUAL(2, last.threadBusy.size());
+    BOOST_CHECK(last.threadBusy[0] + last.threadBusy[1] >= std::chrono::milliseconds(20));
+
+    //Counters start over for the next generation
+    timings.beginGeneration();
+    timings.endGeneration(8, &pool);
+    BOOST_CHECK(timings.getLast().get(gacommon::Phase::Evaluate) == std::chrono::nanoseconds(0));
+    BOOST_CHECK(timings.getLast().threadBusy[0] == std::chrono::nanoseconds(0));
+}